@@ -8,109 +8,602 @@
 #include "APU.h"
 #include "Bus.h"
 #include "log.h"
+#include "Profiler.h"
 #include <string.h>
 
+#define APU_AMPLITUDE   (20000)     // Blip amplitude of the mixer at full output
+#define DMC_STALL_CYCLES  (4)         // CPU cycles halted by a DMC sample fetch, fewer in rare cases
+#define FRAME_RESET_DELAY_EVEN    (2)   // Cycles after a $4017 write the frame sequence restarts,
+#define FRAME_RESET_DELAY_ODD     (3)   // counted from the cycle after the write (3 or 4 from the write itself)
+
+static const u8_t LENGTH_TABLE[32] =
+{
+    10, 254, 20,  2, 40,  4, 80,  6, 160,  8, 60, 10, 14, 12, 26, 14,
+    12,  16, 24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30
+};
+
+static const u8_t DUTY_TABLE[4][8] =
+{
+    { 0, 0, 0, 0, 0, 0, 0, 1 },
+    { 0, 0, 0, 0, 0, 0, 1, 1 },
+    { 0, 0, 0, 0, 1, 1, 1, 1 },
+    { 1, 1, 1, 1, 1, 1, 0, 0 }
+};
+
+static const u8_t TRIANGLE_TABLE[32] =
+{
+    15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1,  0,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15
+};
+
+// In CPU cycles
+static const u16_t NOISE_PERIOD_TABLE[16] =
+{
+    4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068
+};
+
+// In CPU cycles
+static const u16_t DMC_RATE_TABLE[16] =
+{
+    428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54
+};
+
+// Non-linear mixer, indexed by pulse1 + pulse2 and 3 * triangle + 2 * noise + dmc
+static int32_t _pulseMixTable[31];
+static int32_t _tndMixTable[203];
+
+typedef enum
+{
+  FRAME_ACTION_QUARTER = 0x01,    // Clock envelopes and the linear counter
+  FRAME_ACTION_HALF = 0x02,       // Clock length counters and sweeps
+  FRAME_ACTION_IRQ = 0x04,        // Set the frame interrupt flag
+  FRAME_ACTION_RESTART = 0x08,    // Start the sequence over from this cycle
+} FrameAction_t;
+
+typedef struct
+{
+  u16_t Cycle;                    // CPU cycles after the start of the sequence
+  u8_t Actions;
+} FrameStep_t;
+
+static const FrameStep_t FOUR_STEP_SEQUENCE[] =
+{
+    { 7457,  FRAME_ACTION_QUARTER },
+    { 14913, FRAME_ACTION_QUARTER | FRAME_ACTION_HALF },
+    { 22371, FRAME_ACTION_QUARTER },
+    { 29828, FRAME_ACTION_IRQ },
+    { 29829, FRAME_ACTION_QUARTER | FRAME_ACTION_HALF | FRAME_ACTION_IRQ },
+    { 29830, FRAME_ACTION_IRQ | FRAME_ACTION_RESTART },
+};
+
+static const FrameStep_t FIVE_STEP_SEQUENCE[] =
+{
+    { 7457,  FRAME_ACTION_QUARTER },
+    { 14913, FRAME_ACTION_QUARTER | FRAME_ACTION_HALF },
+    { 22371, FRAME_ACTION_QUARTER },
+    { 37281, FRAME_ACTION_QUARTER | FRAME_ACTION_HALF },
+    { 37282, FRAME_ACTION_RESTART },
+};
+
 static inline void SetFrameInterruptFlag(APU_t *apu)
 {
-  if (!CR8_IsBitSet(apu->FrameCounter, APU_FRAME_FLAG_IRQ_INHIBIT))
+  if (!(apu->FrameCounter & APU_FRAME_FLAG_IRQ_INHIBIT))
   {
-    CR8_SetBits(&apu->Status, APU_STATUS_FLAG_FRAME_INT);
+    apu->Status |= APU_STATUS_FLAG_FRAME_INT;
   }
 }
 
-static void ClockEnvelopes(APU_t *apu)
+static inline void UpdateIrqLine(APU_t *apu)
 {
+  // IRQ line is tied to the frame and DMC interrupt bits
+  Bus_IRQ(apu->Bus, IRQ_SOURCE_APU, (apu->Status & (APU_STATUS_FLAG_FRAME_INT | APU_STATUS_FLAG_DMC_INT)) != 0);
+}
 
+static inline u8_t GetEnvelopeVolume(const APU_Envelope_t *envelope)
+{
+  return envelope->IsConstant ? envelope->Volume : envelope->Decay;
 }
 
-static void ClockLengthCounters(APU_t *apu)
+static u16_t GetSweepTarget(const APU_Pulse_t *pulse)
 {
+  u16_t change = pulse->Period >> pulse->SweepShift;
+  if (pulse->IsSweepNegated)
+  {
+    // Pulse 1 adds the ones' complement
+    change = pulse->IsSecond ? change : change + 1;
+    return change > pulse->Period ? 0 : pulse->Period - change;
+  }
+  return pulse->Period + change;
+}
 
+static inline bool IsPulseMuted(const APU_Pulse_t *pulse)
+{
+  return pulse->Period < 8 || (!pulse->IsSweepNegated && GetSweepTarget(pulse) > 0x7FF);
 }
 
-void APU_Initialize(APU_t *apu)
+static inline u8_t GetPulseOutput(const APU_Pulse_t *pulse)
 {
-  memset(apu, 0, sizeof(APU_t));
+  if (pulse->Length == 0 || !DUTY_TABLE[pulse->Duty][pulse->Step] || IsPulseMuted(pulse))
+  {
+    return 0;
+  }
+  return GetEnvelopeVolume(&pulse->Envelope);
 }
 
-void APU_Tick(APU_t *apu)
+static inline u8_t GetNoiseOutput(const APU_Noise_t *noise)
 {
-  // Frame counter implementation
-  if (apu->HalfClockCounter == 7457)
+  if (noise->Length == 0 || (noise->Shift & 0x01))
   {
-    // Quarter clock
-    ClockEnvelopes(apu);
+    return 0;
   }
-  else if (apu->HalfClockCounter == 14913)
+  return GetEnvelopeVolume(&noise->Envelope);
+}
+
+static void UpdateAmplitude(APU_t *apu, u32_t cycle)
+{
+  u8_t pulse = GetPulseOutput(&apu->Pulse[0]) + GetPulseOutput(&apu->Pulse[1]);
+  u8_t tnd = 3 * TRIANGLE_TABLE[apu->Triangle.Step] + 2 * GetNoiseOutput(&apu->Noise) + apu->Dmc.Level;
+  int32_t amplitude = _pulseMixTable[pulse] + _tndMixTable[tnd];
+
+  if (amplitude != apu->Amplitude)
   {
-    // Half clock
-    ClockEnvelopes(apu);
-    ClockLengthCounters(apu);
+    BlipBuffer_AddDelta(&apu->Blip, cycle, amplitude - apu->Amplitude);
+    apu->Amplitude = amplitude;
   }
-  else if (apu->HalfClockCounter == 22371)
+}
+
+static inline void Schedule(u32_t *nextStep, bool isActive, u32_t cycle, u32_t period)
+{
+  if (!isActive)
   {
-    // 3/4 clock
-    ClockEnvelopes(apu);
+    *nextStep = APU_NEVER;
+  }
+  else if (*nextStep == APU_NEVER)
+  {
+    *nextStep = cycle + period;
   }
+}
 
-  if (CR8_IsBitSet(apu->FrameCounter, APU_FRAME_FLAG_5STEP))
+// Channels that can't change their output are not stepped at all until they can again
+static void ScheduleChannels(APU_t *apu)
+{
+  for (u8f_t i = 0; i < 2; i++)
   {
-    // 5 step
-    if (apu->HalfClockCounter == 37281)
+    APU_Pulse_t *pulse = &apu->Pulse[i];
+    Schedule(&pulse->NextStep,
+             pulse->Length > 0 && !IsPulseMuted(pulse) && GetEnvelopeVolume(&pulse->Envelope) > 0,
+             apu->Cycle,
+             (pulse->Period + 1) * 2);
+  }
+
+  // Ultrasonic periods are left out, they would only produce aliasing
+  APU_Triangle_t *triangle = &apu->Triangle;
+  Schedule(&triangle->NextStep,
+           triangle->Length > 0 && triangle->Linear > 0 && triangle->Period >= 2,
+           apu->Cycle,
+           triangle->Period + 1);
+
+  APU_Noise_t *noise = &apu->Noise;
+  Schedule(&noise->NextStep,
+           noise->Length > 0 && GetEnvelopeVolume(&noise->Envelope) > 0,
+           apu->Cycle,
+           NOISE_PERIOD_TABLE[noise->PeriodIndex]);
+
+  APU_Dmc_t *dmc = &apu->Dmc;
+  Schedule(&dmc->NextStep,
+           !dmc->IsSilent || dmc->IsBufferFull || dmc->BytesRemaining > 0,
+           apu->Cycle,
+           DMC_RATE_TABLE[dmc->RateIndex]);
+}
+
+static void RestartDmc(APU_Dmc_t *dmc)
+{
+  dmc->Address = dmc->SampleAddress;
+  dmc->BytesRemaining = dmc->SampleLength;
+}
+
+static void FillDmcBuffer(APU_t *apu)
+{
+  APU_Dmc_t *dmc = &apu->Dmc;
+  if (dmc->IsBufferFull || dmc->BytesRemaining == 0)
+  {
+    return;
+  }
+
+  // The fetch halts the CPU, usually for 4 cycles
+  apu->Bus->DMA.DmcStallCycles += DMC_STALL_CYCLES;
+  dmc->Buffer = Bus_ReadFromCPU(apu->Bus, dmc->Address);
+  dmc->IsBufferFull = true;
+  dmc->Address = (dmc->Address == 0xFFFF) ? 0x8000 : dmc->Address + 1;
+  dmc->BytesRemaining--;
+
+  if (dmc->BytesRemaining == 0)
+  {
+    if (dmc->IsLooping)
     {
-      // 5/4 clock
-      ClockEnvelopes(apu);
-      ClockLengthCounters(apu);
+      RestartDmc(dmc);
     }
+    else if (dmc->IsIrqEnabled)
+    {
+      apu->Status |= APU_STATUS_FLAG_DMC_INT;
+    }
+  }
+}
+
+static void StepDmc(APU_t *apu)
+{
+  APU_Dmc_t *dmc = &apu->Dmc;
 
-    apu->HalfClockCounter = (apu->HalfClockCounter + 1) % 37282;
+  if (!dmc->IsSilent)
+  {
+    if (dmc->Shift & 0x01)
+    {
+      if (dmc->Level <= 125)
+      {
+        dmc->Level += 2;
+      }
+    }
+    else if (dmc->Level >= 2)
+    {
+      dmc->Level -= 2;
+    }
   }
-  else
+  dmc->Shift >>= 1;
+
+  if (dmc->BitsRemaining > 0)
+  {
+    dmc->BitsRemaining--;
+  }
+  if (dmc->BitsRemaining == 0)
   {
-    // 4 step
-    if (apu->HalfClockCounter == 29828)
+    // Start a new output cycle with whatever the memory reader has
+    dmc->BitsRemaining = 8;
+    dmc->IsSilent = !dmc->IsBufferFull;
+    if (dmc->IsBufferFull)
     {
-      // Set frame interrupt
-      SetFrameInterruptFlag(apu);
+      dmc->Shift = dmc->Buffer;
+      dmc->IsBufferFull = false;
+      FillDmcBuffer(apu);
     }
-    else if (apu->HalfClockCounter == 29829)
+  }
+}
+
+// Runs all channels up to (not including) the given cycle. Instead of clocking every
+// cycle we jump from one channel step to the next, only those can change the output.
+static void Synthesize(APU_t *apu, u32_t cycle)
+{
+  for (;;)
+  {
+    u32_t next = apu->Pulse[0].NextStep;
+    next = apu->Pulse[1].NextStep < next ? apu->Pulse[1].NextStep : next;
+    next = apu->Triangle.NextStep < next ? apu->Triangle.NextStep : next;
+    next = apu->Noise.NextStep < next ? apu->Noise.NextStep : next;
+    next = apu->Dmc.NextStep < next ? apu->Dmc.NextStep : next;
+
+    if (next >= cycle)
     {
-      // Set frame interrupt + Clock
-      SetFrameInterruptFlag(apu);
+      break;
+    }
 
-      ClockEnvelopes(apu);
-      ClockLengthCounters(apu);
+    for (u8f_t i = 0; i < 2; i++)
+    {
+      APU_Pulse_t *pulse = &apu->Pulse[i];
+      if (pulse->NextStep == next)
+      {
+        pulse->Step = (pulse->Step + 1) & 0x07;
+        pulse->NextStep += (pulse->Period + 1) * 2;
+      }
+    }
+
+    if (apu->Triangle.NextStep == next)
+    {
+      apu->Triangle.Step = (apu->Triangle.Step + 1) & 0x1F;
+      apu->Triangle.NextStep += apu->Triangle.Period + 1;
+    }
+
+    if (apu->Noise.NextStep == next)
+    {
+      APU_Noise_t *noise = &apu->Noise;
+      u16_t feedback = (noise->Shift ^ (noise->Shift >> (noise->IsShortMode ? 6 : 1))) & 0x01;
+      noise->Shift = (noise->Shift >> 1) | (feedback << 14);
+      noise->NextStep += NOISE_PERIOD_TABLE[noise->PeriodIndex];
     }
-    else if (apu->HalfClockCounter == 0)
+
+    if (apu->Dmc.NextStep == next)
     {
-      // Set frame interrupt?
-      SetFrameInterruptFlag(apu);
+      StepDmc(apu);
+      apu->Dmc.NextStep += DMC_RATE_TABLE[apu->Dmc.RateIndex];
     }
 
-    apu->HalfClockCounter = (apu->HalfClockCounter + 1) % 29830;
+    UpdateAmplitude(apu, next);
   }
 
-  // IRQ line is tied to the frame interrupt bit
-  Bus_IRQ(apu->Bus, CR8_IsBitSet(apu->Status, APU_STATUS_FLAG_FRAME_INT));
+  apu->SynthesizedCycle = cycle;
+}
 
-  // Clock registers here instead of a separate function
-  CR8_Clock(&apu->FrameCounter);
-  CR8_Clock(&apu->Status);
+static void ClockEnvelope(APU_Envelope_t *envelope)
+{
+  if (envelope->IsStarted)
+  {
+    envelope->IsStarted = false;
+    envelope->Decay = 15;
+    envelope->Divider = envelope->Volume;
+  }
+  else if (envelope->Divider == 0)
+  {
+    envelope->Divider = envelope->Volume;
+    if (envelope->Decay > 0)
+    {
+      envelope->Decay--;
+    }
+    else if (envelope->IsLooping)
+    {
+      envelope->Decay = 15;
+    }
+  }
+  else
+  {
+    envelope->Divider--;
+  }
+}
+
+static void ClockSweep(APU_Pulse_t *pulse)
+{
+  if (pulse->SweepDivider == 0 && pulse->IsSweepEnabled && pulse->SweepShift > 0 && !IsPulseMuted(pulse))
+  {
+    pulse->Period = GetSweepTarget(pulse);
+  }
+
+  if (pulse->SweepDivider == 0 || pulse->IsSweepReloaded)
+  {
+    pulse->SweepDivider = pulse->SweepPeriod;
+    pulse->IsSweepReloaded = false;
+  }
+  else
+  {
+    pulse->SweepDivider--;
+  }
+}
+
+static void ClockEnvelopes(APU_t *apu)
+{
+  // Quarter frame: envelopes and the triangle's linear counter
+  Synthesize(apu, apu->Cycle);
+
+  ClockEnvelope(&apu->Pulse[0].Envelope);
+  ClockEnvelope(&apu->Pulse[1].Envelope);
+  ClockEnvelope(&apu->Noise.Envelope);
+
+  APU_Triangle_t *triangle = &apu->Triangle;
+  if (triangle->IsLinearReloaded)
+  {
+    triangle->Linear = triangle->LinearReload;
+  }
+  else if (triangle->Linear > 0)
+  {
+    triangle->Linear--;
+  }
+  if (!triangle->IsControlled)
+  {
+    triangle->IsLinearReloaded = false;
+  }
+
+  ScheduleChannels(apu);
+  UpdateAmplitude(apu, apu->Cycle);
+}
+
+static void ClockLengthCounters(APU_t *apu)
+{
+  // Half frame: length counters and sweeps
+  Synthesize(apu, apu->Cycle);
+
+  for (u8f_t i = 0; i < 2; i++)
+  {
+    APU_Pulse_t *pulse = &apu->Pulse[i];
+    if (pulse->Length > 0 && !pulse->Envelope.IsLooping)
+    {
+      pulse->Length--;
+    }
+    ClockSweep(pulse);
+  }
+  if (apu->Triangle.Length > 0 && !apu->Triangle.IsControlled)
+  {
+    apu->Triangle.Length--;
+  }
+  if (apu->Noise.Length > 0 && !apu->Noise.Envelope.IsLooping)
+  {
+    apu->Noise.Length--;
+  }
+
+  ScheduleChannels(apu);
+  UpdateAmplitude(apu, apu->Cycle);
+}
+
+static void EndAudioFrame(APU_t *apu)
+{
+  int16_t samples[BLIP_BUFFER_SIZE];
+
+  Synthesize(apu, apu->Cycle);
+  BlipBuffer_EndFrame(&apu->Blip, apu->Cycle);
+
+  // Step times are relative to the start of the audio frame
+  u32_t *nextSteps[] = { &apu->Pulse[0].NextStep, &apu->Pulse[1].NextStep, &apu->Triangle.NextStep, &apu->Noise.NextStep, &apu->Dmc.NextStep, &apu->FrameResetCycle };
+  for (u8f_t i = 0; i < sizeof(nextSteps) / sizeof(nextSteps[0]); i++)
+  {
+    if (*nextSteps[i] != APU_NEVER)
+    {
+      *nextSteps[i] -= apu->Cycle;
+    }
+  }
+  apu->FrameSequenceStart -= (int32_t) apu->Cycle;
+  apu->FrameStartClock += apu->Cycle;
+  apu->Cycle = 0;
+  apu->SynthesizedCycle = 0;
+
+  u32_t numSamples = BlipBuffer_ReadSamples(&apu->Blip, samples, BLIP_BUFFER_SIZE);
+  if (apu->SampleHandler != NULL && numSamples > 0)
+  {
+    apu->SampleHandler(samples, numSamples);
+  }
+}
+
+void APU_Initialize(APU_t *apu, const uint64_t *clock)
+{
+  memset(apu, 0, sizeof(APU_t));
+  apu->Clock = clock;
+  apu->FrameStartClock = *clock;
+
+  for (u8f_t i = 1; i < sizeof(_pulseMixTable) / sizeof(_pulseMixTable[0]); i++)
+  {
+    _pulseMixTable[i] = (int32_t) (APU_AMPLITUDE * 95.52 / (8128.0 / i + 100));
+  }
+  for (u8f_t i = 1; i < sizeof(_tndMixTable) / sizeof(_tndMixTable[0]); i++)
+  {
+    _tndMixTable[i] = (int32_t) (APU_AMPLITUDE * 163.67 / (24329.0 / i + 100));
+  }
+
+  apu->Pulse[1].IsSecond = true;
+  apu->Noise.Shift = 0x0001;
+  apu->Dmc.IsSilent = true;
+  apu->Dmc.BitsRemaining = 8;
+  apu->Dmc.SampleAddress = 0xC000;
+  apu->Dmc.SampleLength = 1;
+  apu->Pulse[0].NextStep = APU_NEVER;
+  apu->Pulse[1].NextStep = APU_NEVER;
+  apu->Triangle.NextStep = APU_NEVER;
+  apu->Noise.NextStep = APU_NEVER;
+  apu->Dmc.NextStep = APU_NEVER;
+  apu->FrameResetCycle = APU_NEVER;
+  apu->NextEventCycle = FOUR_STEP_SEQUENCE[0].Cycle;
+  apu->NextEventClock = apu->FrameStartClock + apu->NextEventCycle;
+
+  BlipBuffer_Initialize(&apu->Blip);
+  APU_SetSampleRate(apu, 44100);
+}
+
+void APU_SetSampleRate(APU_t *apu, double sampleRate)
+{
+  BlipBuffer_SetRates(&apu->Blip, APU_CPU_CLOCK_RATE, sampleRate);
+}
+
+void APU_SetSampleHandler(APU_t *apu, APU_SampleHandler_t handler)
+{
+  apu->SampleHandler = handler;
+}
+
+static void RunFrameSequence(APU_t *apu)
+{
+  if (apu->Cycle >= apu->FrameResetCycle)
+  {
+    // Delayed effect of a $4017 write, the sequence starts over in the new mode
+    apu->FrameResetCycle = APU_NEVER;
+    apu->FrameSequenceStart = (int32_t) apu->Cycle;
+    apu->FrameStep = 0;
+    apu->IsFiveStepMode = (apu->FrameCounter & APU_FRAME_FLAG_5STEP) != 0;
+  }
+
+  const FrameStep_t *step = &(apu->IsFiveStepMode ? FIVE_STEP_SEQUENCE : FOUR_STEP_SEQUENCE)[apu->FrameStep];
+  if ((int32_t) apu->Cycle < apu->FrameSequenceStart + step->Cycle)
+  {
+    return;
+  }
+
+  if (step->Actions & FRAME_ACTION_QUARTER)
+  {
+    ClockEnvelopes(apu);
+  }
+  if (step->Actions & FRAME_ACTION_HALF)
+  {
+    ClockLengthCounters(apu);
+  }
+  if (step->Actions & FRAME_ACTION_IRQ)
+  {
+    SetFrameInterruptFlag(apu);
+  }
+
+  if (step->Actions & FRAME_ACTION_RESTART)
+  {
+    apu->FrameSequenceStart = (int32_t) apu->Cycle;
+    apu->FrameStep = 0;
+  }
+  else
+  {
+    apu->FrameStep++;
+  }
+}
+
+static void ScheduleNextEvent(APU_t *apu)
+{
+  const FrameStep_t *step = &(apu->IsFiveStepMode ? FIVE_STEP_SEQUENCE : FOUR_STEP_SEQUENCE)[apu->FrameStep];
+  u32_t next = (u32_t) (apu->FrameSequenceStart + step->Cycle);
+
+  next = apu->FrameResetCycle < next ? apu->FrameResetCycle : next;
+  next = APU_AUDIO_FRAME_CYCLES < next ? APU_AUDIO_FRAME_CYCLES : next;
+
+  // The memory reader refills the buffer at the step that ends the output cycle. That
+  // fetch stalls the CPU, reads through the current mapping and can raise the interrupt,
+  // so it has to happen on time. Other DMC steps only change the output and stay lazy.
+  const APU_Dmc_t *dmc = &apu->Dmc;
+  if (dmc->IsBufferFull && dmc->BytesRemaining > 0 && dmc->NextStep != APU_NEVER)
+  {
+    u32_t bits = dmc->BitsRemaining > 0 ? dmc->BitsRemaining : 1;
+    u32_t fetch = dmc->NextStep + (bits - 1) * DMC_RATE_TABLE[dmc->RateIndex] + 1;
+    next = fetch < next ? fetch : next;
+  }
+
+  apu->NextEventCycle = next;
+  apu->NextEventClock = apu->FrameStartClock + next;
+}
+
+// Nothing is done for the cycles that passed, that happens at the next event or access
+static void CatchUp(APU_t *apu)
+{
+  apu->Cycle = (u32_t) (*apu->Clock - apu->FrameStartClock);
+}
+
+void APU_RunEvents(APU_t *apu)
+{
+  Profiler_Begin(PROFILER_SECTION_APU);
+  CatchUp(apu);
+
+  // Catch up on channel steps, the last DMC step can be the one setting the interrupt
+  Synthesize(apu, apu->Cycle);
+
+  RunFrameSequence(apu);
+  apu->FrameSequenceCycle = (int32_t) apu->Cycle - apu->FrameSequenceStart;
+
+  if (apu->Cycle >= APU_AUDIO_FRAME_CYCLES)
+  {
+    EndAudioFrame(apu);
+  }
+
+  UpdateIrqLine(apu);
+  ScheduleNextEvent(apu);
+  Profiler_End(PROFILER_SECTION_APU);
 }
 
 u8_t APU_ReadFromCpu(APU_t *apu, u16_t address)
 {
   u8_t addressByte = (u8_t) address;
 
+  CatchUp(apu);
+
   switch (addressByte)
   {
   case 0x15:
   {
     // STATUS: Reading clears the frame interrupt flag
     // TODO: DNT21 behavior
-    u8_t value = CR8_Read(apu->Status) & (APU_STATUS_FLAG_DMC_INT | APU_STATUS_FLAG_FRAME_INT);
+    Synthesize(apu, apu->Cycle);
+    u8_t value = apu->Status & (APU_STATUS_FLAG_DMC_INT | APU_STATUS_FLAG_FRAME_INT);
+    value |= (apu->Pulse[0].Length > 0)     ? APU_STATUS_FLAG_PC1_ENABLE : 0;
+    value |= (apu->Pulse[1].Length > 0)     ? APU_STATUS_FLAG_PC2_ENABLE : 0;
+    value |= (apu->Triangle.Length > 0)     ? APU_STATUS_FLAG_T_ENABLE : 0;
+    value |= (apu->Noise.Length > 0)        ? APU_STATUS_FLAG_N_ENABLE : 0;
+    value |= (apu->Dmc.BytesRemaining > 0)  ? APU_STATUS_FLAG_D_ENABLE : 0;
     // TODO: If flag was set at the same moment as the read then it should not be cleared
-    CR8_ClearBits(&apu->Status, APU_STATUS_FLAG_FRAME_INT);
+    apu->Status &= ~APU_STATUS_FLAG_FRAME_INT;
+    UpdateIrqLine(apu);
     return value;
   }
   default:
@@ -119,29 +612,153 @@ u8_t APU_ReadFromCpu(APU_t *apu, u16_t address)
   }
 }
 
+static void WritePulse(APU_Pulse_t *pulse, u8_t reg, u8_t data)
+{
+  switch (reg)
+  {
+  case 0:
+    pulse->Duty = data >> 6;
+    pulse->Envelope.IsLooping = (data & 0x20) != 0;
+    pulse->Envelope.IsConstant = (data & 0x10) != 0;
+    pulse->Envelope.Volume = data & 0x0F;
+    break;
+  case 1:
+    pulse->IsSweepEnabled = (data & 0x80) != 0;
+    pulse->SweepPeriod = (data >> 4) & 0x07;
+    pulse->IsSweepNegated = (data & 0x08) != 0;
+    pulse->SweepShift = data & 0x07;
+    pulse->IsSweepReloaded = true;
+    break;
+  case 2:
+    pulse->Period = (pulse->Period & 0x0700) | data;
+    break;
+  case 3:
+    pulse->Period = (pulse->Period & 0x00FF) | ((data & 0x07) << 8);
+    if (pulse->IsEnabled)
+    {
+      pulse->Length = LENGTH_TABLE[data >> 3];
+    }
+    // Restarts the sequence and the envelope
+    pulse->Step = 0;
+    pulse->Envelope.IsStarted = true;
+    break;
+  }
+}
+
 void APU_WriteFromCpu(APU_t *apu, u16_t address, u8_t data)
 {
   u8_t addressByte = (u8_t) address;
 
+  // Everything before this write still uses the old register values
+  CatchUp(apu);
+  Synthesize(apu, apu->Cycle);
+
   switch (addressByte)
   {
+  case 0x00:
+  case 0x01:
+  case 0x02:
+  case 0x03:
+  case 0x04:
+  case 0x05:
+  case 0x06:
+  case 0x07:
+    WritePulse(&apu->Pulse[addressByte >> 2], addressByte & 0x03, data);
+    break;
+  case 0x08:
+    apu->Triangle.IsControlled = (data & 0x80) != 0;
+    apu->Triangle.LinearReload = data & 0x7F;
+    break;
+  case 0x0A:
+    apu->Triangle.Period = (apu->Triangle.Period & 0x0700) | data;
+    break;
+  case 0x0B:
+    apu->Triangle.Period = (apu->Triangle.Period & 0x00FF) | ((data & 0x07) << 8);
+    if (apu->Triangle.IsEnabled)
+    {
+      apu->Triangle.Length = LENGTH_TABLE[data >> 3];
+    }
+    apu->Triangle.IsLinearReloaded = true;
+    break;
+  case 0x0C:
+    apu->Noise.Envelope.IsLooping = (data & 0x20) != 0;
+    apu->Noise.Envelope.IsConstant = (data & 0x10) != 0;
+    apu->Noise.Envelope.Volume = data & 0x0F;
+    break;
+  case 0x0E:
+    apu->Noise.IsShortMode = (data & 0x80) != 0;
+    apu->Noise.PeriodIndex = data & 0x0F;
+    break;
+  case 0x0F:
+    if (apu->Noise.IsEnabled)
+    {
+      apu->Noise.Length = LENGTH_TABLE[data >> 3];
+    }
+    apu->Noise.Envelope.IsStarted = true;
+    break;
+  case 0x10:
+    apu->Dmc.IsIrqEnabled = (data & 0x80) != 0;
+    apu->Dmc.IsLooping = (data & 0x40) != 0;
+    apu->Dmc.RateIndex = data & 0x0F;
+    if (!apu->Dmc.IsIrqEnabled)
+    {
+      apu->Status &= ~APU_STATUS_FLAG_DMC_INT;
+    }
+    break;
+  case 0x11:
+    apu->Dmc.Level = data & 0x7F;
+    break;
+  case 0x12:
+    apu->Dmc.SampleAddress = 0xC000 | ((u16_t) data << 6);
+    break;
+  case 0x13:
+    apu->Dmc.SampleLength = ((u16_t) data << 4) | 0x0001;
+    break;
   case 0x15:
   {
     // STATUS
     // Writing clears the DMC interrupt flag
     // What we do here should preserve the value of the Frame interrupt flag
-    apu->Status.newValue &= ~(APU_STATUS_FLAGS_WRITABLE | APU_STATUS_FLAG_DMC_INT);
-    apu->Status.newValue |= data & APU_STATUS_FLAGS_WRITABLE;
+    apu->Status &= ~(APU_STATUS_FLAGS_WRITABLE | APU_STATUS_FLAG_DMC_INT);
+    apu->Status |= data & APU_STATUS_FLAGS_WRITABLE;
+
+    // Disabling a channel silences it right away
+    apu->Pulse[0].IsEnabled = (data & APU_STATUS_FLAG_PC1_ENABLE) != 0;
+    apu->Pulse[1].IsEnabled = (data & APU_STATUS_FLAG_PC2_ENABLE) != 0;
+    apu->Triangle.IsEnabled = (data & APU_STATUS_FLAG_T_ENABLE) != 0;
+    apu->Noise.IsEnabled = (data & APU_STATUS_FLAG_N_ENABLE) != 0;
+    apu->Pulse[0].Length = apu->Pulse[0].IsEnabled ? apu->Pulse[0].Length : 0;
+    apu->Pulse[1].Length = apu->Pulse[1].IsEnabled ? apu->Pulse[1].Length : 0;
+    apu->Triangle.Length = apu->Triangle.IsEnabled ? apu->Triangle.Length : 0;
+    apu->Noise.Length = apu->Noise.IsEnabled ? apu->Noise.Length : 0;
+
+    if (!(data & APU_STATUS_FLAG_D_ENABLE))
+    {
+      apu->Dmc.BytesRemaining = 0;
+    }
+    else if (apu->Dmc.BytesRemaining == 0)
+    {
+      RestartDmc(&apu->Dmc);
+      FillDmcBuffer(apu);
+    }
     break;
   }
   case 0x17:
   {
     // FRAME COUNTER
     // Has some flags
-    CR8_Write(&apu->FrameCounter, data & APU_FRAME_FLAG_MASK);
+    apu->FrameCounter = data & APU_FRAME_FLAG_MASK;
     if (data & APU_FRAME_FLAG_IRQ_INHIBIT)
     {
-      CR8_ClearBits(&apu->Status, APU_STATUS_FLAG_FRAME_INT);
+      apu->Status &= ~APU_STATUS_FLAG_FRAME_INT;
+    }
+    // The sequence restarts 3 or 4 cycles later, depending on where in the APU cycle we are
+    apu->FrameResetCycle = apu->Cycle + ((apu->Cycle & 1) ? FRAME_RESET_DELAY_ODD : FRAME_RESET_DELAY_EVEN);
+    if (data & APU_FRAME_FLAG_5STEP)
+    {
+      // Selecting 5 step mode also clocks everything right away
+      ClockEnvelopes(apu);
+      ClockLengthCounters(apu);
     }
     break;
   }
@@ -149,4 +766,9 @@ void APU_WriteFromCpu(APU_t *apu, u16_t address, u8_t data)
     //LogError("Not implemented APU write address 0x%04X", address);
     break;
   }
+
+  ScheduleChannels(apu);
+  UpdateAmplitude(apu, apu->Cycle);
+  UpdateIrqLine(apu);
+  ScheduleNextEvent(apu);
 }
@@ -9,7 +9,11 @@
 #define SRC_NES_APU_H_
 
 #include "Types.h"
-#include "ClockedRegister.h"
+#include "BlipBuffer.h"
+
+#define APU_CPU_CLOCK_RATE      (1789773.0)   // NTSC CPU clock, the APU runs off of this
+#define APU_AUDIO_FRAME_CYCLES  (4096)        // CPU cycles after which synthesized samples are handed out
+#define APU_NEVER               (UINT32_MAX)  // Cycle for channels that won't step
 
 typedef struct _Bus_t Bus_t;
 
@@ -34,22 +38,115 @@ typedef enum
   APU_FRAME_FLAG_IRQ_INHIBIT = 0x40,    // Inhibit IRQ generation
 } APU_FrameFlags_t;
 
+typedef void (*APU_SampleHandler_t)(const int16_t *samples, u32_t numSamples);
+
+typedef struct
+{
+  bool IsStarted;           // Restart on the next quarter frame
+  bool IsLooping;           // Loop the decay, same bit as the length counter halt
+  bool IsConstant;          // Output Volume instead of Decay
+  u8_t Volume;              // Constant volume or the divider period
+  u8_t Divider;
+  u8_t Decay;
+} APU_Envelope_t;
+
+typedef struct
+{
+  bool IsEnabled;           // Enabled through the status register
+  bool IsSecond;            // Pulse 2 negates its sweep in two's complement
+  u8_t Duty;
+  u8_t Step;                // Position in the duty sequence
+  u16_t Period;             // 11 bit timer period
+  u8_t Length;
+  APU_Envelope_t Envelope;
+  bool IsSweepEnabled;
+  bool IsSweepNegated;
+  bool IsSweepReloaded;
+  u8_t SweepPeriod;
+  u8_t SweepShift;
+  u8_t SweepDivider;
+  u32_t NextStep;           // Cycle the sequencer steps next
+} APU_Pulse_t;
+
+typedef struct
+{
+  bool IsEnabled;
+  bool IsControlled;        // Linear counter control, same bit as the length counter halt
+  bool IsLinearReloaded;
+  u8_t LinearReload;
+  u8_t Linear;
+  u8_t Step;                // Position in the 32 step triangle
+  u16_t Period;
+  u8_t Length;
+  u32_t NextStep;
+} APU_Triangle_t;
+
+typedef struct
+{
+  bool IsEnabled;
+  bool IsShortMode;         // Feedback from bit 6 instead of bit 1
+  u8_t PeriodIndex;
+  u16_t Shift;              // 15 bit shift register
+  u8_t Length;
+  APU_Envelope_t Envelope;
+  u32_t NextStep;
+} APU_Noise_t;
+
+typedef struct
+{
+  bool IsIrqEnabled;
+  bool IsLooping;
+  bool IsSilent;            // Output unit has no sample byte
+  bool IsBufferFull;
+  u8_t RateIndex;
+  u8_t Level;               // 7 bit output level
+  u8_t Shift;               // Output shift register
+  u8_t BitsRemaining;
+  u8_t Buffer;              // Sample buffer filled by the memory reader
+  u16_t SampleAddress;
+  u16_t SampleLength;
+  u16_t Address;            // Current address of the memory reader
+  u16_t BytesRemaining;
+  u32_t NextStep;
+} APU_Dmc_t;
+
 typedef struct _APU_t
 {
   Bus_t *Bus;       // The bus we are attached to
 
-  uint_fast16_t HalfClockCounter;   // Counts half APU clock cycles (1 APU clock = 2 CPU clock)
-
+  // All cycles are CPU cycles relative to the start of the audio frame. The APU only
+  // does work when the console clock reaches NextEventClock or when the CPU accesses
+  // it, Cycle is caught up from the clock at those moments.
+  const uint64_t *Clock;    // CPU cycles counted by the console
+  uint64_t FrameStartClock; // Clock at the start of the audio frame
+  uint64_t NextEventClock;  // Clock at NextEventCycle, checked by the console every CPU cycle
+  u32_t Cycle;              // CPU cycles completed in this audio frame
+  u32_t NextEventCycle;     // First cycle at which something has to happen
+  u32_t SynthesizedCycle;   // Channels have been synthesized up to this cycle
+  int32_t FrameSequenceStart;   // Cycle the frame sequence (re)started
+  int32_t FrameSequenceCycle;   // CPU cycles since the sequence (re)started, updated at events
+  u32_t FrameResetCycle;    // Cycle a $4017 write restarts the frame sequence, or APU_NEVER
+  u8_t FrameStep;           // Next step of the frame sequence
+  bool IsFiveStepMode;      // Mode of the running frame sequence
+  int32_t Amplitude;        // Mixed output level that was last added to Blip
+  BlipBuffer_t Blip;
+  APU_SampleHandler_t SampleHandler;
 
+  APU_Pulse_t Pulse[2];
+  APU_Triangle_t Triangle;
+  APU_Noise_t Noise;
+  APU_Dmc_t Dmc;
 
-  cr8_t Status;             // The status register at 0x4015
-  cr8_t FrameCounter;       // Frame counter register at 0x4017
-  cr1_t FrameCounterWritten;    // ??
+  u8_t Status;              // The status register at 0x4015
+  u8_t FrameCounter;        // Frame counter register at 0x4017
 } APU_t;
 
-void APU_Initialize(APU_t *apu);
-void APU_Tick(APU_t *apu);
+// The clock is incremented after every CPU cycle, call APU_RunEvents when it reaches NextEventClock
+void APU_Initialize(APU_t *apu, const uint64_t *clock);
+void APU_RunEvents(APU_t *apu);
 u8_t APU_ReadFromCpu(APU_t *apu, u16_t address);
 void APU_WriteFromCpu(APU_t *apu, u16_t address, u8_t data);
+void APU_SetSampleRate(APU_t *apu, double sampleRate);
+void APU_SetSampleHandler(APU_t *apu, APU_SampleHandler_t handler);
 
 #endif /* SRC_NES_APU_H_ */
@@ -0,0 +1,140 @@
+/*
+ * BlipBuffer.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "BlipBuffer.h"
+#include <math.h>
+#include <string.h>
+
+#define NUM_PHASES        (1 << BLIP_PHASE_BITS)
+#define KERNEL_UNIT_BITS  (15)      // A full step sums to 1 << KERNEL_UNIT_BITS
+#define CUTOFF            (0.9)     // Fraction of the Nyquist frequency that is passed
+#define BASS_SHIFT        (9)       // DC removal, roughly 14 Hz at 44.1 kHz
+#define PI                (3.14159265358979323846)
+
+static int16_t _kernel[NUM_PHASES][BLIP_KERNEL_WIDTH];
+static bool _isKernelInitialized;
+
+static void InitializeKernel(void)
+{
+  const int halfWidth = BLIP_KERNEL_WIDTH / 2;
+
+  for (int phase = 0; phase < NUM_PHASES; phase++)
+  {
+    double taps[BLIP_KERNEL_WIDTH];
+    double sum = 0;
+
+    for (int i = 0; i < BLIP_KERNEL_WIDTH; i++)
+    {
+      // Distance in samples from the step, Blackman windowed sinc around it
+      double distance = i - (halfWidth - 1) - (double) phase / NUM_PHASES;
+      double x = CUTOFF * distance;
+      double sinc = (x == 0) ? 1.0 : sin(PI * x) / (PI * x);
+      double window = 0.42 + 0.5 * cos(PI * distance / halfWidth) + 0.08 * cos(2 * PI * distance / halfWidth);
+      taps[i] = sinc * window;
+      sum += taps[i];
+    }
+
+    // Normalize so every phase adds exactly one full step, the center tap absorbs rounding
+    int32_t total = 0;
+    for (int i = 0; i < BLIP_KERNEL_WIDTH; i++)
+    {
+      _kernel[phase][i] = (int16_t) lround(taps[i] / sum * (1 << KERNEL_UNIT_BITS));
+      total += _kernel[phase][i];
+    }
+    _kernel[phase][halfWidth - 1] += (1 << KERNEL_UNIT_BITS) - total;
+  }
+
+  _isKernelInitialized = true;
+}
+
+void BlipBuffer_Initialize(BlipBuffer_t *buffer)
+{
+  if (!_isKernelInitialized)
+  {
+    InitializeKernel();
+  }
+
+  BlipBuffer_Clear(buffer);
+}
+
+void BlipBuffer_SetRates(BlipBuffer_t *buffer, double clockRate, double sampleRate)
+{
+  buffer->Factor = (uint64_t) (sampleRate / clockRate * ((uint64_t) 1 << BLIP_FRACTION_BITS) + 0.5);
+}
+
+void BlipBuffer_Clear(BlipBuffer_t *buffer)
+{
+  buffer->Offset = 0;
+  buffer->Integrator = 0;
+  buffer->AvailableSamples = 0;
+  memset(buffer->Samples, 0, sizeof(buffer->Samples));
+}
+
+void BlipBuffer_AddDelta(BlipBuffer_t *buffer, u32_t clockTime, int32_t delta)
+{
+  uint64_t position = buffer->Offset + clockTime * buffer->Factor;
+  u32_t index = (u32_t) (position >> BLIP_FRACTION_BITS);
+  u32_t phase = (u32_t) (position >> (BLIP_FRACTION_BITS - BLIP_PHASE_BITS)) & (NUM_PHASES - 1);
+
+  if (index >= BLIP_BUFFER_SIZE)
+  {
+    // Nobody is reading, drop it
+    return;
+  }
+
+  int32_t *out = &buffer->Samples[index];
+  const int16_t *kernel = _kernel[phase];
+  for (int i = 0; i < BLIP_KERNEL_WIDTH; i++)
+  {
+    out[i] += kernel[i] * delta;
+  }
+}
+
+void BlipBuffer_EndFrame(BlipBuffer_t *buffer, u32_t clockDuration)
+{
+  buffer->Offset += clockDuration * buffer->Factor;
+  buffer->AvailableSamples = (u32_t) (buffer->Offset >> BLIP_FRACTION_BITS);
+
+  if (buffer->AvailableSamples > BLIP_BUFFER_SIZE)
+  {
+    buffer->AvailableSamples = BLIP_BUFFER_SIZE;
+  }
+}
+
+u32_t BlipBuffer_ReadSamples(BlipBuffer_t *buffer, int16_t *samples, u32_t maxSamples)
+{
+  u32_t count = maxSamples < buffer->AvailableSamples ? maxSamples : buffer->AvailableSamples;
+  int32_t sum = buffer->Integrator;
+
+  for (u32_t i = 0; i < count; i++)
+  {
+    sum += buffer->Samples[i];
+    int32_t sample = sum >> KERNEL_UNIT_BITS;
+    // Leak a little of the sum so DC drifts back to 0
+    sum -= sample << (KERNEL_UNIT_BITS - BASS_SHIFT);
+
+    if (sample > INT16_MAX)
+    {
+      sample = INT16_MAX;
+    }
+    else if (sample < INT16_MIN)
+    {
+      sample = INT16_MIN;
+    }
+    samples[i] = (int16_t) sample;
+  }
+  buffer->Integrator = sum;
+
+  // Move the partially added deltas to the front
+  u32_t remaining = BLIP_BUFFER_SIZE + BLIP_KERNEL_WIDTH - count;
+  memmove(buffer->Samples, &buffer->Samples[count], remaining * sizeof(buffer->Samples[0]));
+  memset(&buffer->Samples[remaining], 0, count * sizeof(buffer->Samples[0]));
+
+  buffer->Offset -= (uint64_t) count << BLIP_FRACTION_BITS;
+  buffer->AvailableSamples -= count;
+  return count;
+}
@@ -0,0 +1,38 @@
+/*
+ * BlipBuffer.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_NES_BLIPBUFFER_H_
+#define SRC_NES_BLIPBUFFER_H_
+
+#include "Types.h"
+
+// Band-limited step synthesis. Amplitude changes are added as deltas at a clock
+// time, each delta is spread over a few output samples with a windowed sinc so
+// the steps don't alias. Reading integrates the deltas back into samples.
+
+#define BLIP_BUFFER_SIZE        (1024)    // Max samples that can be buffered between reads
+#define BLIP_KERNEL_WIDTH       (16)      // Output samples a single delta is spread over
+#define BLIP_PHASE_BITS         (5)       // Sub-sample resolution of a delta
+#define BLIP_FRACTION_BITS      (32)      // Fraction bits of sample positions
+
+typedef struct
+{
+  uint64_t Factor;          // Output samples per clock, BLIP_FRACTION_BITS fixed point
+  uint64_t Offset;          // Sample position of clock 0 of the current frame
+  int32_t Integrator;       // Running sum of the deltas read so far
+  u32_t AvailableSamples;   // Samples that are complete and can be read
+  int32_t Samples[BLIP_BUFFER_SIZE + BLIP_KERNEL_WIDTH];
+} BlipBuffer_t;
+
+void BlipBuffer_Initialize(BlipBuffer_t *buffer);
+void BlipBuffer_SetRates(BlipBuffer_t *buffer, double clockRate, double sampleRate);
+void BlipBuffer_Clear(BlipBuffer_t *buffer);
+void BlipBuffer_AddDelta(BlipBuffer_t *buffer, u32_t clockTime, int32_t delta);
+void BlipBuffer_EndFrame(BlipBuffer_t *buffer, u32_t clockDuration);
+u32_t BlipBuffer_ReadSamples(BlipBuffer_t *buffer, int16_t *samples, u32_t maxSamples);
+
+#endif /* SRC_NES_BLIPBUFFER_H_ */
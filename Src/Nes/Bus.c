@@ -16,18 +16,18 @@
 #include <string.h>
 
 // TODO: RAM?
-static u8_t _testRam[0x800];
+static u8_t _testRam[BUS_CPU_RAM_SIZE];
 static u8_t _palette[256];
-static u8_t _vram[2048];
-static u8_t _pattern[8192];
-
-static u8_t ReadNametableDefault(const Bus_t *bus, u16_t address);
-
-static void WriteNametableDefault(const Bus_t *bus, u16_t address, u8_t data);
+static u8_t _vram[BUS_NAMETABLE_RAM_SIZE];
+static u8_t _pattern[8192];   // Pattern table used when no cartridge is inserted
 
 void Bus_Initialize(Bus_t *bus, CPU_t *cpu, PPU_t *ppu, APU_t *apu)
 {
   memset(bus, 0, sizeof(*bus));
+  // Same power on state every time, replays depend on it
+  memset(_testRam, 0, sizeof(_testRam));
+  memset(_palette, 0, sizeof(_palette));
+  memset(_vram, 0, sizeof(_vram));
   // Link CPU and bus together
   bus->CPU = cpu;
   cpu->Bus = bus;
@@ -38,12 +38,96 @@ void Bus_Initialize(Bus_t *bus, CPU_t *cpu, PPU_t *ppu, APU_t *apu)
   // Link APU and bus together
   bus->APU = apu;
   apu->Bus = bus;
+  // No mapper yet, use the default pattern table and mirroring
+  Bus_UpdateChrPages(bus);
+  Bus_UpdateMirroring(bus);
 }
 
 void Bus_SetMapper(Bus_t *bus, Mapper_t *mapper)
 {
   bus->Mapper = mapper;
   mapper->Bus = bus;
+  Bus_UpdateChrPages(bus);
+  Bus_UpdatePrgPages(bus);
+  Bus_UpdateMirroring(bus);
+}
+
+void Bus_UpdateChrPages(Bus_t *bus)
+{
+  for (u8_t i = 0; i < 8; i++)
+  {
+    if (bus->Mapper != NULL)
+    {
+      bus->PpuPages[i] = bus->Mapper->ChrPages[i];
+    }
+    else
+    {
+      bus->PpuPages[i] = &_pattern[i * 0x400];
+    }
+  }
+
+  bus->ChrIsWritable = bus->Mapper == NULL || bus->Mapper->ChrRam != NULL;
+}
+
+void Bus_UpdatePrgPages(Bus_t *bus)
+{
+  for (u8_t i = 0; i < 4; i++)
+  {
+    bus->PrgPages[i] = bus->Mapper != NULL ? bus->Mapper->PrgPages[i] : NULL;
+  }
+}
+
+static inline void SetNametablePage(Bus_t *bus, u8_t page, u8_t *memory)
+{
+  // 0x3000 - 0x3EFF mirrors the nametables at 0x2000 - 0x2EFF
+  bus->PpuPages[8 + page] = memory;
+  bus->PpuPages[12 + page] = memory;
+}
+
+void Bus_UpdateMirroring(Bus_t *bus)
+{
+  MirrorMode_t mirror = bus->Mapper != NULL ? bus->Mapper->Mirror : MIRROR_MODE_HORIZONTAL;
+
+  if (mirror == MIRROR_MODE_FOUR && bus->Mapper->FourScreenRam == NULL)
+  {
+    LogError("Four screen mirroring without cartridge VRAM, using horizontal mirroring");
+    mirror = MIRROR_MODE_HORIZONTAL;
+  }
+
+  switch (mirror)
+  {
+  case MIRROR_MODE_HORIZONTAL:
+    SetNametablePage(bus, 0, &_vram[0x000]);
+    SetNametablePage(bus, 1, &_vram[0x000]);
+    SetNametablePage(bus, 2, &_vram[0x400]);
+    SetNametablePage(bus, 3, &_vram[0x400]);
+    break;
+  case MIRROR_MODE_VERTICAL:
+    SetNametablePage(bus, 0, &_vram[0x000]);
+    SetNametablePage(bus, 1, &_vram[0x400]);
+    SetNametablePage(bus, 2, &_vram[0x000]);
+    SetNametablePage(bus, 3, &_vram[0x400]);
+    break;
+  case MIRROR_MODE_SINGLE_LOWER:
+    SetNametablePage(bus, 0, &_vram[0x000]);
+    SetNametablePage(bus, 1, &_vram[0x000]);
+    SetNametablePage(bus, 2, &_vram[0x000]);
+    SetNametablePage(bus, 3, &_vram[0x000]);
+    break;
+  case MIRROR_MODE_SINGLE_UPPER:
+    SetNametablePage(bus, 0, &_vram[0x400]);
+    SetNametablePage(bus, 1, &_vram[0x400]);
+    SetNametablePage(bus, 2, &_vram[0x400]);
+    SetNametablePage(bus, 3, &_vram[0x400]);
+    break;
+  case MIRROR_MODE_FOUR:
+    // Two pages are internal, the other two are provided by the cartridge
+    SetNametablePage(bus, 0, &_vram[0x000]);
+    SetNametablePage(bus, 1, &_vram[0x400]);
+    SetNametablePage(bus, 2, &bus->Mapper->FourScreenRam[0x000]);
+    SetNametablePage(bus, 3, &bus->Mapper->FourScreenRam[0x400]);
+    break;
+  }
 }
 
 void Bus_TriggerDMA(Bus_t *bus, u8_t cpuPage)
@@ -58,16 +142,29 @@ void Bus_NMI(const Bus_t *bus, bool assert)
   CPU_NMI(bus->CPU, assert);
 }
 
-void Bus_IRQ(const Bus_t *bus, bool assert)
+void Bus_IRQ(const Bus_t *bus, IRQSource_t source, bool assert)
 {
-  CPU_IRQ(bus->CPU, assert);
+  CPU_IRQ(bus->CPU, source, assert);
+}
+
+void Bus_PpuA12Rise(const Bus_t *bus)
+{
+  if (bus->Mapper != NULL && bus->Mapper->PpuA12Rise != NULL)
+  {
+    bus->Mapper->PpuA12Rise(bus->Mapper);
+  }
 }
 
 u8_t Bus_ReadFromCPU(const Bus_t *bus, u16_t address)
 {
   u8_t data;
 
-  if (bus->Mapper != NULL && bus->Mapper->ReadFromCpu(bus->Mapper, address, &data))
+  if (address >= 0x8000 && bus->PrgPages[(address - 0x8000) >> 13] != NULL)
+  {
+    // Banked PRG ROM, the mapper keeps the pages up to date
+    data = bus->PrgPages[(address - 0x8000) >> 13][address & 0x1FFF];
+  }
+  else if (bus->Mapper != NULL && bus->Mapper->ReadFromCpu != NULL && bus->Mapper->ReadFromCpu(bus->Mapper, address, &data))
   {
     // Handled by mapper
   }
@@ -161,21 +258,12 @@ u8_t Bus_ReadFromPPU(const Bus_t *bus, u16_t address)
   u8_t data;
   address &= 0x3FFF;
 
-  if (bus->Mapper != NULL && bus->Mapper->ReadFromPpu(bus->Mapper, address, &data))
+  if (address <= 0x3EFF)
   {
-    // Handled by mapper
+    // Pattern tables and nametables, both mapped in 1k pages
+    data = bus->PpuPages[address >> 10][address & 0x03FF];
   }
-  else if (address <= 0x1FFF)
-  {
-    // Pattern table
-    data = _pattern[address];
-  }
-  else if (address >= 0x2000 && address <= 0x3EFF)
-  {
-    // Default nametable implementation
-    data = ReadNametableDefault(bus, address);
-  }
-  else if (address >= 0x3F00 && address <= 0x3FFF)
+  else
   {
     u16_t localAddress = address & 0x001F;
     if (localAddress == 0x10
@@ -187,10 +275,6 @@ u8_t Bus_ReadFromPPU(const Bus_t *bus, u16_t address)
     }
     data = _palette[localAddress];
   }
-  else
-  {
-    LogError("Unmapped PPU read @ 0x%04X", address);
-  }
 
   return data;
 }
@@ -199,21 +283,20 @@ void Bus_WriteFromPPU(const Bus_t *bus, u16_t address, u8_t data)
 {
   address &= 0x3FFF;
 
-  if (bus->Mapper != NULL && bus->Mapper->WriteFromPpu(bus->Mapper, address, data))
-  {
-    // Handled by mapper
-  }
-  else if (address <= 0x1FFF)
+  if (address <= 0x1FFF)
   {
-    // Pattern table
-    _pattern[address] = data;
+    // Pattern table, writes to CHR ROM are ignored
+    if (bus->ChrIsWritable)
+    {
+      bus->PpuPages[address >> 10][address & 0x03FF] = data;
+    }
   }
-  else if (address >= 0x2000 && address <= 0x3EFF)
+  else if (address <= 0x3EFF)
   {
-    // Default nametable implementation
-    WriteNametableDefault(bus, address, data);
+    // Nametables
+    bus->PpuPages[address >> 10][address & 0x03FF] = data;
   }
-  else if (address >= 0x3F00 && address <= 0x3FFF)
+  else
   {
     u16_t localAddress = address & 0x001F;
     if (localAddress == 0x10
@@ -225,103 +308,19 @@ void Bus_WriteFromPPU(const Bus_t *bus, u16_t address, u8_t data)
     }
     _palette[localAddress] = data;
   }
-  else
-  {
-    LogError("Unmapped PPU write @ 0x%04X", address);
-  }
 }
 
-static u8_t ReadNametableDefault(const Bus_t *bus, u16_t address)
+const u8_t* Bus_GetCpuRam(void)
 {
-  address &= 0x0FFF;
-
-  if (bus->Mapper->Mirror == MIRROR_MODE_HORIZONTAL)
-  {
-    if (address >= 0x0000 && address <= 0x03FF)
-    {
-      return _vram[address & 0x3FF];
-    }
-    else if (address >= 0x0400 && address <= 0x07FF)
-    {
-      return _vram[address & 0x3FF];
-    }
-    else if (address >= 0x0800 && address <= 0x0BFF)
-    {
-      return _vram[(address & 0x3FF) + 0x400];
-    }
-    else if (address >= 0x0C00 && address <= 0x0FFF)
-    {
-      return _vram[(address & 0x3FF) + 0x400];
-    }
-  }
-  else if (bus->Mapper->Mirror == MIRROR_MODE_VERTICAL)
-  {
-    if (address >= 0x0000 && address <= 0x03FF)
-    {
-      return _vram[address & 0x3FF];
-    }
-    else if (address >= 0x0400 && address <= 0x07FF)
-    {
-      return _vram[(address & 0x3FF) + 0x400];
-    }
-    else if (address >= 0x0800 && address <= 0x0BFF)
-    {
-      return _vram[address & 0x3FF];
-    }
-    else if (address >= 0x0C00 && address <= 0x0FFF)
-    {
-      return _vram[(address & 0x3FF) + 0x400];
-    }
-  }
-
-  LogError("Unsupported mirroring mode %d", bus->Mapper->Mirror);
-  return 0x55;
+  return _testRam;
 }
 
-static void WriteNametableDefault(const Bus_t *bus, u16_t address, u8_t data)
+const u8_t* Bus_GetNametableRam(void)
 {
-  address &= 0x0FFF;
+  return _vram;
+}
 
-  if (bus->Mapper->Mirror == MIRROR_MODE_HORIZONTAL)
-  {
-    if (address >= 0x0000 && address <= 0x03FF)
-    {
-      _vram[address & 0x3FF] = data;
-    }
-    else if (address >= 0x0400 && address <= 0x07FF)
-    {
-      _vram[address & 0x3FF] = data;
-    }
-    else if (address >= 0x0800 && address <= 0x0BFF)
-    {
-      _vram[(address & 0x3FF) + 0x400] = data;
-    }
-    else if (address >= 0x0C00 && address <= 0x0FFF)
-    {
-      _vram[(address & 0x3FF) + 0x400] = data;
-    }
-  }
-  else if (bus->Mapper->Mirror == MIRROR_MODE_VERTICAL)
-  {
-    if (address >= 0x0000 && address <= 0x03FF)
-    {
-      _vram[address & 0x3FF] = data;
-    }
-    else if (address >= 0x0400 && address <= 0x07FF)
-    {
-      _vram[(address & 0x3FF) + 0x400] = data;
-    }
-    else if (address >= 0x0800 && address <= 0x0BFF)
-    {
-      _vram[address & 0x3FF] = data;
-    }
-    else if (address >= 0x0C00 && address <= 0x0FFF)
-    {
-      _vram[(address & 0x3FF) + 0x400] = data;
-    }
-  }
-  else
-  {
-    LogError("Unsupported mirroring mode %d", bus->Mapper->Mirror);
-  }
+const u8_t* Bus_GetPaletteRam(void)
+{
+  return _palette;
 }
@@ -10,11 +10,22 @@
 
 #include "Types.h"
 
+#define BUS_CPU_RAM_SIZE        (0x800)
+#define BUS_NAMETABLE_RAM_SIZE  (0x800)
+#define BUS_PALETTE_RAM_SIZE    (0x20)
+
 typedef struct _PPU_t PPU_t;
 typedef struct _CPU_t CPU_t;
 typedef struct _APU_t APU_t;
 typedef struct _Mapper_t Mapper_t;
 
+// Devices that can pull the CPU IRQ line
+typedef enum
+{
+  IRQ_SOURCE_APU = 0x01,
+  IRQ_SOURCE_MAPPER = 0x02,
+} IRQSource_t;
+
 typedef enum
 {
   DMA_STATE_IDLE,
@@ -28,6 +39,8 @@ typedef struct _DMA_t
   u16_t CPUBaseAddress;
   u8_t NumTransfersComplete;
   u8_t Data;
+  u8_t DmcStallCycles;          // CPU cycles still to be halted for a DMC sample fetch
+  unsigned int NumStallCycles;  // CPU cycles taken by OAM and DMC DMA, for metrics
 } DMA_t;
 
 typedef struct _Bus_t
@@ -37,18 +50,31 @@ typedef struct _Bus_t
   APU_t *APU;
   Mapper_t *Mapper;
   DMA_t DMA;
+  // PPU address space 0x0000 - 0x3EFF in 1k pages, 0-7 are CHR and 8-15 the nametables (+ mirror)
+  u8_t *PpuPages[16];
+  bool ChrIsWritable;         // CHR pages are RAM
+  // CPU address space 0x8000 - 0xFFFF in 8k pages, NULL when the mapper decodes reads itself
+  u8_t *PrgPages[4];
 } Bus_t;
 
 void Bus_TriggerDMA(Bus_t *bus, u8_t cpuPage);
 
 void Bus_NMI(const Bus_t *bus, bool assert);
 
-void Bus_IRQ(const Bus_t *bus, bool assert);
+void Bus_IRQ(const Bus_t *bus, IRQSource_t source, bool assert);
+
+void Bus_PpuA12Rise(const Bus_t *bus);
 
 void Bus_Initialize(Bus_t *bus, CPU_t *cpu, PPU_t *ppu, APU_t *apu);
 
 void Bus_SetMapper(Bus_t *bus, Mapper_t *mapper);
 
+void Bus_UpdateMirroring(Bus_t *bus);
+
+void Bus_UpdateChrPages(Bus_t *bus);
+
+void Bus_UpdatePrgPages(Bus_t *bus);
+
 u8_t Bus_ReadFromCPU(const Bus_t *bus, u16_t address);
 
 void Bus_WriteFromCPU(Bus_t *bus, u16_t address, u8_t data);
@@ -57,5 +83,10 @@ u8_t Bus_ReadFromPPU(const Bus_t *bus, u16_t address);
 
 void Bus_WriteFromPPU(const Bus_t *bus, u16_t address, u8_t data);
 
+// The memories inside the console, for inspecting and hashing
+const u8_t* Bus_GetCpuRam(void);
+const u8_t* Bus_GetNametableRam(void);
+const u8_t* Bus_GetPaletteRam(void);
+
 
 #endif /* SRC_NES_BUS_H_ */
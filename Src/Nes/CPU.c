@@ -9,7 +9,7 @@
 #include "CPU.h"
 #include "Bus.h"
 #include "stdint.h"
-#include "SharedSDL.h"
+#include "Profiler.h"
 
 #include <string.h>
 #include <stdbool.h>
@@ -41,9 +41,17 @@ void CPU_NMI(CPU_t *cpu, bool assert)
   cpu->NMILineAsserted = assert;
 }
 
-void CPU_IRQ(CPU_t *cpu, bool assert)
+void CPU_IRQ(CPU_t *cpu, u8_t source, bool assert)
 {
-  cpu->IRQLineAsserted = assert;
+  // Open collector line, any source can pull it low
+  if (assert)
+  {
+    cpu->IRQLines |= source;
+  }
+  else
+  {
+    cpu->IRQLines &= ~source;
+  }
 }
 
 void CPU_Tick(CPU_t *cpu)
@@ -65,7 +73,7 @@ void CPU_Tick(CPU_t *cpu)
     cpu->NMILineAssertedPrevious = cpu->NMILineAsserted;
 
     // IRQ level detection
-    CR1_Write(&cpu->IRQPendingInternal, cpu->IRQLineAsserted);
+    CR1_Write(&cpu->IRQPendingInternal, cpu->IRQLines != 0);
 
     // Next tick will be a rising clock edge
     cpu->IsRisingClockEdge = true;
@@ -81,7 +89,7 @@ void CPU_Tick(CPU_t *cpu)
     return;
   }
 
-  SharedSDL_BeginTiming(PERF_INDEX_CPU);
+  Profiler_Begin(PROFILER_SECTION_CPU);
 
   cpu->CycleCount++;
 
@@ -101,35 +109,39 @@ void CPU_Tick(CPU_t *cpu)
       Push(cpu, statusByte);
       // Put NMI vector in PC
       cpu->PC = Read16(cpu, NMI_VECTOR_LOCATION);
+      Debugger_OnInterrupt(DEBUGGER_INTERRUPT_NMI, cpu->PC);
       // Set interrupt disable flag
       SetFlag(&cpu->P, PFLAG_INTDISABLE, true);
       // NMI takes 7 cycles
       cpu->CyclesLeftForInstruction = 7;
 
       cpu->NextInstructionIsNMI = false;
+      cpu->IsInterruptPollDelayed = false;
+    }
+    else if (cpu->NextInstructionIsIRQ)
+    {
+      // IRQ takes priority over other things, but not an NMI. The I flag was
+      // already checked when the IRQ was polled.
+      // Push PC (hi, then low)
+      Push(cpu, cpu->PC >> 8);
+      Push(cpu, (u8_t)cpu->PC);
+      // Push P
+      u8_t statusByte = cpu->P;
+      // Set B flag correctly before pushing
+      SetFlag(&statusByte, PFLAG_B0, false);  // 1 = BRK, 0 = NMI/IRQ
+      SetFlag(&statusByte, PFLAG_B1, true);   // Always 1
+      Push(cpu, statusByte);
+      // Put IRQ vector in PC
+      cpu->PC = Read16(cpu, IRQ_VECTOR_LOCATION);
+      Debugger_OnInterrupt(DEBUGGER_INTERRUPT_IRQ, cpu->PC);
+      // Set interrupt disable flag
+      SetFlag(&cpu->P, PFLAG_INTDISABLE, true);
+      // IRQ takes 7 cycles
+      cpu->CyclesLeftForInstruction = 7;
+
+      cpu->NextInstructionIsIRQ = false;
+      cpu->IsInterruptPollDelayed = false;
     }
-    // TODO: Implement IRQ handling
-//    else if (cpu->NextInstructionIsIRQ && ((cpu->P & PFLAG_INTDISABLE) == 0))
-//    {
-//      // IRQ takes priority over other things, but not an NMI
-//      // Push PC (hi, then low)
-//      Push(cpu, cpu->PC >> 8);
-//      Push(cpu, (u8_t)cpu->PC);
-//      // Push P
-//      u8_t statusByte = cpu->P;
-//      // Set B flag correctly before pushing
-//      SetFlag(&statusByte, PFLAG_B0, false);  // 1 = BRK, 0 = NMI/IRQ
-//      SetFlag(&statusByte, PFLAG_B1, true);   // Always 1
-//      Push(cpu, statusByte);
-//      // Put IRQ vector in PC
-//      cpu->PC = Read16(cpu, IRQ_VECTOR_LOCATION);
-//      // Set interrupt disable flag
-//      SetFlag(&cpu->P, PFLAG_INTDISABLE, true);
-//      // IRQ takes 7 cycles
-//      cpu->CyclesLeftForInstruction = 7;
-//
-//      cpu->NextInstructionIsIRQ = false;
-//    }
     else
     {
       // Time for a new instruction!
@@ -139,6 +151,10 @@ void CPU_Tick(CPU_t *cpu)
 
       newInstruction = InstructionTable_GetInstruction(cpu->Instruction);
 
+      // CLI (0x58), SEI (0x78) and PLP (0x28) poll interrupts before I changes
+      cpu->WasInterruptDisabled = (cpu->P & PFLAG_INTDISABLE) != 0;
+      cpu->IsInterruptPollDelayed = cpu->Instruction == 0x58 || cpu->Instruction == 0x78 || cpu->Instruction == 0x28;
+
       cpu->AddressingMode = newInstruction->AddressingMode;
       cpu->CyclesLeftForInstruction = newInstruction->BaseCycleCount;
 
@@ -293,7 +309,8 @@ void CPU_Tick(CPU_t *cpu)
       CR1_Write(&cpu->NMIPendingInternal, false);
     }
 
-    cpu->NextInstructionIsIRQ = CR1_Read(cpu->IRQPendingInternal);
+    bool isInterruptDisabled = cpu->IsInterruptPollDelayed ? cpu->WasInterruptDisabled : (cpu->P & PFLAG_INTDISABLE) != 0;
+    cpu->NextInstructionIsIRQ = CR1_Read(cpu->IRQPendingInternal) && !isInterruptDisabled;
   }
 
   // Clock registers
@@ -302,6 +319,10 @@ void CPU_Tick(CPU_t *cpu)
 
   // Always decrement cycle counter
   cpu->CyclesLeftForInstruction--;
+  if (cpu->CyclesLeftForInstruction == 0)
+  {
+    Debugger_OnExecute(cpu);
+  }
 
-  SharedSDL_EndTiming(PERF_INDEX_CPU);
+  Profiler_End(PROFILER_SECTION_CPU);
 }
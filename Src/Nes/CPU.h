@@ -38,7 +38,9 @@ typedef struct _CPU_t
   bool IsRisingClockEdge;
   bool NMILineAssertedPrevious;
   bool NMILineAsserted;
-  bool IRQLineAsserted;
+  u8_t IRQLines;                 // IRQ sources asserting the line, it is active while any is set
+  bool WasInterruptDisabled;     // I flag before the current instruction executed
+  bool IsInterruptPollDelayed;   // Current instruction changes I after the interrupt poll
   cr1_t IRQPendingInternal;
   cr1_t NMIPendingInternal;
   bool NextInstructionIsNMI;
@@ -49,6 +51,6 @@ void CPU_Initialize(CPU_t *cpu);
 void CPU_Tick(CPU_t *cpu);
 void CPU_Reset(CPU_t *cpu);
 void CPU_NMI(CPU_t *cpu, bool assert);
-void CPU_IRQ(CPU_t *cpu, bool assert);
+void CPU_IRQ(CPU_t *cpu, u8_t source, bool assert);
 
 #endif /* SRC_NES_CPU_H_ */
@@ -11,6 +11,7 @@
 #include "CPU.h"
 #include "Types.h"
 #include "Bus.h"
+#include "Debugger.h"
 
 #define PFLAG_CARRY       0x01
 #define PFLAG_ZERO        0x02
@@ -46,17 +47,21 @@ static inline void SetFlag(u8_t *P, u8_t flag, bool set)
 static inline u16_t Read16(CPU_t *cpu, u16_t address)
 {
   u8_t lowByte;
+  Debugger_OnCpuAccess(address, DEBUGGER_ACCESS_READ);
+  Debugger_OnCpuAccess(address + 1, DEBUGGER_ACCESS_READ);
   lowByte = Bus_ReadFromCPU(cpu->Bus, address);
   return (Bus_ReadFromCPU(cpu->Bus, address + 1) << 8) | lowByte;
 }
 
 static inline u8_t Read(CPU_t *cpu, u16_t address)
 {
+  Debugger_OnCpuAccess(address, DEBUGGER_ACCESS_READ);
   return Bus_ReadFromCPU(cpu->Bus, address);
 }
 
 static inline void Write(CPU_t *cpu, u16_t address, u8_t data)
 {
+  Debugger_OnCpuAccess(address, DEBUGGER_ACCESS_WRITE);
   Bus_WriteFromCPU(cpu->Bus, address, data);
 }
 
@@ -0,0 +1,255 @@
+/*
+ * Debugger.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Debugger.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CPU_ADDRESS_SPACE   (0x10000)
+
+typedef struct
+{
+  DebuggerBus_t Bus;
+  u16_t Start;
+  u16_t End;          // Inclusive
+  u8_t Access;
+} Watchpoint_t;
+
+bool _isDebuggerBreak;
+u8_t _debuggerCpuPages[DEBUGGER_CPU_PAGES];
+u8_t _debuggerPpuPages[DEBUGGER_PPU_PAGES];
+u8_t _debuggerInterrupts;
+
+static u8_t _breakpoints[CPU_ADDRESS_SPACE / 8];
+static Watchpoint_t _watchpoints[DEBUGGER_MAX_WATCHPOINTS];
+static u8_t _numWatchpoints;
+static DebuggerBreak_t _break;
+
+// Marks the pages again after a breakpoint or watchpoint changed
+static void UpdatePages(void)
+{
+  memset(_debuggerCpuPages, 0, sizeof(_debuggerCpuPages));
+  memset(_debuggerPpuPages, 0, sizeof(_debuggerPpuPages));
+
+  const u16_t bytesPerPage = sizeof(_breakpoints) / DEBUGGER_CPU_PAGES;
+  for (u16_t page = 0; page < DEBUGGER_CPU_PAGES; page++)
+  {
+    for (u16_t i = 0; i < bytesPerPage; i++)
+    {
+      if (_breakpoints[page * bytesPerPage + i] != 0)
+      {
+        _debuggerCpuPages[page] |= DEBUGGER_ACCESS_EXECUTE;
+        break;
+      }
+    }
+  }
+
+  for (u8_t i = 0; i < _numWatchpoints; i++)
+  {
+    const Watchpoint_t *watchpoint = &_watchpoints[i];
+    u8_t *pages = watchpoint->Bus == DEBUGGER_BUS_CPU ? _debuggerCpuPages : _debuggerPpuPages;
+    for (u16_t page = watchpoint->Start >> 8; page <= watchpoint->End >> 8; page++)
+    {
+      pages[page] |= watchpoint->Access;
+    }
+  }
+}
+
+void Debugger_Reset(void)
+{
+  memset(_breakpoints, 0, sizeof(_breakpoints));
+  _numWatchpoints = 0;
+  _debuggerInterrupts = 0;
+  UpdatePages();
+  Debugger_Continue();
+}
+
+void Debugger_SetBreakpoint(u16_t address, bool isSet)
+{
+  if (isSet)
+  {
+    _breakpoints[address >> 3] |= 1 << (address & 7);
+  }
+  else
+  {
+    _breakpoints[address >> 3] &= ~(1 << (address & 7));
+  }
+  UpdatePages();
+}
+
+bool Debugger_IsBreakpoint(u16_t address)
+{
+  return (_breakpoints[address >> 3] >> (address & 7)) & 1;
+}
+
+bool Debugger_AddWatchpoint(DebuggerBus_t bus, u16_t start, u16_t end, u8_t access)
+{
+  if (_numWatchpoints == DEBUGGER_MAX_WATCHPOINTS)
+  {
+    LogError("No more than %u watchpoints", DEBUGGER_MAX_WATCHPOINTS);
+    return false;
+  }
+  if (bus == DEBUGGER_BUS_PPU && ((access & DEBUGGER_ACCESS_EXECUTE) != 0 || end > 0x3FFF))
+  {
+    LogError("PPU watchpoints only read and write $0000-$3FFF");
+    return false;
+  }
+  if (start > end || access == 0)
+  {
+    LogError("Invalid watchpoint $%04X-$%04X", start, end);
+    return false;
+  }
+
+  Watchpoint_t *watchpoint = &_watchpoints[_numWatchpoints++];
+  watchpoint->Bus = bus;
+  watchpoint->Start = start;
+  watchpoint->End = end;
+  watchpoint->Access = access;
+  UpdatePages();
+  return true;
+}
+
+bool Debugger_AddWatchpointFromString(const char *text)
+{
+  DebuggerBus_t bus;
+  char *end;
+  u8_t access = 0;
+
+  if (strncmp(text, "cpu:", 4) == 0)
+  {
+    bus = DEBUGGER_BUS_CPU;
+  }
+  else if (strncmp(text, "ppu:", 4) == 0)
+  {
+    bus = DEBUGGER_BUS_PPU;
+  }
+  else
+  {
+    LogError("Watchpoint %s should start with cpu: or ppu:", text);
+    return false;
+  }
+
+  unsigned long start = strtoul(&text[4], &end, 16);
+  unsigned long last = start;
+  if (*end == '-')
+  {
+    last = strtoul(end + 1, &end, 16);
+  }
+  if (*end != ':' || end == &text[4] || last > 0xFFFF)
+  {
+    LogError("Invalid address range in watchpoint %s", text);
+    return false;
+  }
+  for (end++; *end != '\0'; end++)
+  {
+    switch (*end)
+    {
+    case 'r':
+      access |= DEBUGGER_ACCESS_READ;
+      break;
+    case 'w':
+      access |= DEBUGGER_ACCESS_WRITE;
+      break;
+    case 'x':
+      access |= DEBUGGER_ACCESS_EXECUTE;
+      break;
+    default:
+      LogError("Invalid access '%c' in watchpoint %s", *end, text);
+      return false;
+    }
+  }
+  return Debugger_AddWatchpoint(bus, (u16_t) start, (u16_t) last, access);
+}
+
+void Debugger_SetBreakOnInterrupts(u8_t interrupts)
+{
+  _debuggerInterrupts = interrupts;
+}
+
+const DebuggerBreak_t *Debugger_GetBreak(void)
+{
+  return &_break;
+}
+
+void Debugger_Continue(void)
+{
+  memset(&_break, 0, sizeof(_break));
+  _isDebuggerBreak = false;
+}
+
+void Debugger_FormatBreak(char *text, size_t size)
+{
+  const char *access = _break.Access == DEBUGGER_ACCESS_READ ? "read" :
+                       _break.Access == DEBUGGER_ACCESS_WRITE ? "write" : "execute";
+
+  switch (_break.Reason)
+  {
+  case DEBUGGER_BREAK_BREAKPOINT:
+    snprintf(text, size, "Breakpoint at $%04X", _break.Address);
+    break;
+  case DEBUGGER_BREAK_WATCHPOINT:
+    snprintf(text, size, "Watchpoint, %s %s $%04X", _break.Bus == DEBUGGER_BUS_CPU ? "CPU" : "PPU", access,
+             _break.Address);
+    break;
+  case DEBUGGER_BREAK_NMI:
+    snprintf(text, size, "NMI, handler at $%04X", _break.Address);
+    break;
+  case DEBUGGER_BREAK_IRQ:
+    snprintf(text, size, "IRQ, handler at $%04X", _break.Address);
+    break;
+  case DEBUGGER_BREAK_NONE:
+  default:
+    snprintf(text, size, "No break");
+    break;
+  }
+}
+
+// The first hit is kept until Debugger_Continue
+static void Break(DebuggerBreakReason_t reason, DebuggerBus_t bus, u16_t address, u8_t access)
+{
+  if (_isDebuggerBreak)
+  {
+    return;
+  }
+  _break.Reason = reason;
+  _break.Bus = bus;
+  _break.Address = address;
+  _break.Access = access;
+  _isDebuggerBreak = true;
+}
+
+void Debugger_CheckExecute(u16_t address)
+{
+  if (Debugger_IsBreakpoint(address))
+  {
+    Break(DEBUGGER_BREAK_BREAKPOINT, DEBUGGER_BUS_CPU, address, DEBUGGER_ACCESS_EXECUTE);
+    return;
+  }
+  Debugger_CheckAccess(DEBUGGER_BUS_CPU, address, DEBUGGER_ACCESS_EXECUTE);
+}
+
+void Debugger_CheckAccess(DebuggerBus_t bus, u16_t address, u8_t access)
+{
+  for (u8_t i = 0; i < _numWatchpoints; i++)
+  {
+    const Watchpoint_t *watchpoint = &_watchpoints[i];
+    if (watchpoint->Bus == bus && (watchpoint->Access & access) != 0 &&
+        address >= watchpoint->Start && address <= watchpoint->End)
+    {
+      Break(DEBUGGER_BREAK_WATCHPOINT, bus, address, access);
+      return;
+    }
+  }
+}
+
+void Debugger_BreakOnInterrupt(u8_t interrupt, u16_t handler)
+{
+  DebuggerBreakReason_t reason = interrupt == DEBUGGER_INTERRUPT_NMI ? DEBUGGER_BREAK_NMI : DEBUGGER_BREAK_IRQ;
+  Break(reason, DEBUGGER_BUS_CPU, handler, DEBUGGER_ACCESS_EXECUTE);
+}
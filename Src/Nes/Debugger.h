@@ -0,0 +1,133 @@
+/*
+ * Debugger.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_NES_DEBUGGER_H_
+#define SRC_NES_DEBUGGER_H_
+
+#include "Types.h"
+#include "CPU.h"
+#include <stddef.h>
+
+// Breakpoints, watchpoints and break on interrupts, always compiled in.
+// Every CPU and PPU page of 256 bytes has a byte of DEBUGGER_ACCESS flags,
+// set when a breakpoint or watchpoint covers part of the page. The hooks only
+// test the flags of the page, the breakpoint bitset and the watchpoint list
+// are consulted when a page is marked. Without breakpoints and watchpoints a
+// hook is a load and a branch.
+// Breakpoints are indexed by the CPU address the PC points to, whatever bank
+// is mapped there. PPU watchpoints see the accesses of the CPU through
+// PPUDATA, not the fetches of rendering.
+// A hit stops NES_TickUntilCPUComplete and NES_TickUntilFrameComplete after the
+// current clock. A breakpoint stops before its instruction executes, a
+// watchpoint after the instruction that accessed the address, an interrupt
+// when the CPU enters the handler. Debugger_Continue clears the break.
+
+#define DEBUGGER_ACCESS_READ      (0x01)
+#define DEBUGGER_ACCESS_WRITE     (0x02)
+#define DEBUGGER_ACCESS_EXECUTE   (0x04)
+
+#define DEBUGGER_INTERRUPT_NMI    (0x01)
+#define DEBUGGER_INTERRUPT_IRQ    (0x02)
+
+#define DEBUGGER_CPU_PAGES        (0x100)
+#define DEBUGGER_PPU_PAGES        (0x40)   // 16k PPU address space
+#define DEBUGGER_MAX_WATCHPOINTS  (16)
+
+typedef enum
+{
+  DEBUGGER_BUS_CPU,
+  DEBUGGER_BUS_PPU
+} DebuggerBus_t;
+
+typedef enum
+{
+  DEBUGGER_BREAK_NONE,
+  DEBUGGER_BREAK_BREAKPOINT,
+  DEBUGGER_BREAK_WATCHPOINT,
+  DEBUGGER_BREAK_NMI,
+  DEBUGGER_BREAK_IRQ
+} DebuggerBreakReason_t;
+
+typedef struct
+{
+  DebuggerBreakReason_t Reason;
+  DebuggerBus_t Bus;
+  u16_t Address;      // Of the breakpoint or the access
+  u8_t Access;        // DEBUGGER_ACCESS flag of the access
+} DebuggerBreak_t;
+
+extern bool _isDebuggerBreak;
+extern u8_t _debuggerCpuPages[DEBUGGER_CPU_PAGES];
+extern u8_t _debuggerPpuPages[DEBUGGER_PPU_PAGES];
+extern u8_t _debuggerInterrupts;
+
+// Removes all breakpoints and watchpoints and clears the break
+void Debugger_Reset(void);
+
+void Debugger_SetBreakpoint(u16_t address, bool isSet);
+
+bool Debugger_IsBreakpoint(u16_t address);
+
+// Execute watchpoints only exist on the CPU, they stop like breakpoints
+bool Debugger_AddWatchpoint(DebuggerBus_t bus, u16_t start, u16_t end, u8_t access);
+
+// Parses "cpu:2002:r" or "ppu:2000-23ff:w", the access is any of r, w and x
+bool Debugger_AddWatchpointFromString(const char *text);
+
+// DEBUGGER_INTERRUPT flags of the interrupts to break on
+void Debugger_SetBreakOnInterrupts(u8_t interrupts);
+
+const DebuggerBreak_t *Debugger_GetBreak(void);
+
+void Debugger_Continue(void);
+
+void Debugger_FormatBreak(char *text, size_t size);
+
+// Slow paths of the hooks
+void Debugger_CheckExecute(u16_t address);
+void Debugger_CheckAccess(DebuggerBus_t bus, u16_t address, u8_t access);
+void Debugger_BreakOnInterrupt(u8_t interrupt, u16_t handler);
+
+// Call when the CPU is about to start the instruction at the PC
+static inline void Debugger_OnExecute(const CPU_t *cpu)
+{
+  if (_debuggerCpuPages[cpu->PC >> 8] & DEBUGGER_ACCESS_EXECUTE)
+  {
+    // An interrupt goes first, the instruction is checked again after it returns
+    if (!cpu->NextInstructionIsNMI && !cpu->NextInstructionIsIRQ)
+    {
+      Debugger_CheckExecute(cpu->PC);
+    }
+  }
+}
+
+static inline void Debugger_OnCpuAccess(u16_t address, u8_t access)
+{
+  if (_debuggerCpuPages[address >> 8] & access)
+  {
+    Debugger_CheckAccess(DEBUGGER_BUS_CPU, address, access);
+  }
+}
+
+static inline void Debugger_OnPpuAccess(u16_t address, u8_t access)
+{
+  address &= 0x3FFF;
+  if (_debuggerPpuPages[address >> 8] & access)
+  {
+    Debugger_CheckAccess(DEBUGGER_BUS_PPU, address, access);
+  }
+}
+
+static inline void Debugger_OnInterrupt(u8_t interrupt, u16_t handler)
+{
+  if (_debuggerInterrupts & interrupt)
+  {
+    Debugger_BreakOnInterrupt(interrupt, handler);
+  }
+}
+
+#endif /* SRC_NES_DEBUGGER_H_ */
@@ -0,0 +1,122 @@
+/*
+ * FrameHash.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "FrameHash.h"
+#include "Bus.h"
+#include "XxHash64.h"
+#include "log.h"
+#include <inttypes.h>
+
+static uint64_t HashSurface(const SDL_Surface *surface)
+{
+  size_t rowSize = (size_t) surface->w * surface->format->BytesPerPixel;
+  if ((size_t) surface->pitch == rowSize)
+  {
+    return XxHash64_Calculate(surface->pixels, rowSize * surface->h, 0);
+  }
+
+  // Leave the padding at the end of the rows out
+  uint64_t hash = 0;
+  for (int y = 0; y < surface->h; y++)
+  {
+    hash = XxHash64_Calculate((const u8_t*) surface->pixels + (size_t) y * surface->pitch, rowSize, hash);
+  }
+  return hash;
+}
+
+void FrameHash_Calculate(const SDL_Surface *screen, FrameHash_t *hash)
+{
+  hash->CpuRam = XxHash64_Calculate(Bus_GetCpuRam(), BUS_CPU_RAM_SIZE, 0);
+  hash->Vram = XxHash64_Calculate(Bus_GetNametableRam(), BUS_NAMETABLE_RAM_SIZE, 0);
+  hash->Vram = XxHash64_Calculate(Bus_GetPaletteRam(), BUS_PALETTE_RAM_SIZE, hash->Vram);
+  hash->Screen = screen != NULL ? HashSurface(screen) : 0;
+}
+
+bool FrameHash_Write(FILE *file, u32_t frame, const FrameHash_t *hash)
+{
+  return fprintf(file, "%u %016" PRIX64 " %016" PRIX64 " %016" PRIX64 "\n",
+                 frame, hash->CpuRam, hash->Vram, hash->Screen) > 0;
+}
+
+// Next frame in a stream, false at the end
+static bool ReadFrame(FILE *file, u32_t *frame, FrameHash_t *hash)
+{
+  char line[128];
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    if (sscanf(line, "%u %" SCNx64 " %" SCNx64 " %" SCNx64, frame, &hash->CpuRam, &hash->Vram, &hash->Screen) == 4)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool FrameHash_Compare(const char *fileA, const char *fileB)
+{
+  FILE *a = fopen(fileA, "r");
+  FILE *b = fopen(fileB, "r");
+  if (a == NULL || b == NULL)
+  {
+    LogError("Unable to open %s", a == NULL ? fileA : fileB);
+    if (a != NULL)
+    {
+      fclose(a);
+    }
+    if (b != NULL)
+    {
+      fclose(b);
+    }
+    return false;
+  }
+
+  u32_t numFrames = 0;
+  bool isSame = true;
+  for (;;)
+  {
+    u32_t frameA;
+    u32_t frameB;
+    FrameHash_t hashA;
+    FrameHash_t hashB;
+    bool hasA = ReadFrame(a, &frameA, &hashA);
+    bool hasB = ReadFrame(b, &frameB, &hashB);
+
+    if (!hasA || !hasB)
+    {
+      if (hasA || hasB)
+      {
+        LogMessage("%s ends after %u frames, the other continues", hasA ? fileB : fileA, numFrames);
+        isSame = false;
+      }
+      break;
+    }
+    if (frameA != frameB)
+    {
+      LogMessage("Frame numbers differ after %u frames: %u and %u", numFrames, frameA, frameB);
+      isSame = false;
+      break;
+    }
+    if (hashA.CpuRam != hashB.CpuRam || hashA.Vram != hashB.Vram || hashA.Screen != hashB.Screen)
+    {
+      LogMessage("First difference at frame %u:%s%s%s", frameA,
+                 hashA.CpuRam != hashB.CpuRam ? " CPU RAM" : "",
+                 hashA.Vram != hashB.Vram ? " VRAM" : "",
+                 hashA.Screen != hashB.Screen ? " screen" : "");
+      isSame = false;
+      break;
+    }
+    numFrames++;
+  }
+
+  if (isSame)
+  {
+    LogMessage("All %u frames are the same", numFrames);
+  }
+  fclose(a);
+  fclose(b);
+  return isSame;
+}
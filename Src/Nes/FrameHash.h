@@ -0,0 +1,34 @@
+/*
+ * FrameHash.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_NES_FRAMEHASH_H_
+#define SRC_NES_FRAMEHASH_H_
+
+#include "Types.h"
+#include <stdio.h>
+#include <SDL2/SDL.h>
+
+// Hashes of the console state at the end of a frame, to prove that two builds
+// or rendering paths produce the same output. A stream has a line per frame
+// with the frame number and the hashes in hex, so it can also be diffed as text.
+
+typedef struct
+{
+  uint64_t CpuRam;
+  uint64_t Vram;          // Nametable and palette RAM
+  uint64_t Screen;        // 0 without a screen
+} FrameHash_t;
+
+// The screen may be NULL when nothing is rendered
+void FrameHash_Calculate(const SDL_Surface *screen, FrameHash_t *hash);
+
+bool FrameHash_Write(FILE *file, u32_t frame, const FrameHash_t *hash);
+
+// Reports the first frame where two streams differ, true when they are the same
+bool FrameHash_Compare(const char *fileA, const char *fileB);
+
+#endif /* SRC_NES_FRAMEHASH_H_ */
@@ -7,79 +7,211 @@
 
 #include "INesLoader.h"
 #include "Mapper.h"
-#include "Mapper000.h"
-#include "Mapper001.h"
+#include "MappedFile.h"
+#include "RomDatabase.h"
+#include "Crc32.h"
+#include "Sha1.h"
 #include "log.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
+static bool _isSaveFileEnabled = true;
 
-bool INesLoader_Load(const char* file, Mapper_t* mapper)
+// The save file sits next to the ROM, with the extension replaced by .sav
+static void SetSavePath(Mapper_t *mapper, const char *file)
 {
-  FILE *f;
-  INesHeader_t header;
+  const char *extension = strrchr(file, '.');
+  const char *separator = strrchr(file, '/');
+  const char *backslash = strrchr(file, '\\');
+  if (backslash != NULL && (separator == NULL || backslash > separator))
+  {
+    separator = backslash;
+  }
+  size_t length = extension != NULL && (separator == NULL || extension > separator) ? (size_t) (extension - file) : strlen(file);
+
+  snprintf(mapper->SavePath, sizeof(mapper->SavePath), "%.*s.sav", (int) length, file);
+}
+
+// NES 2.0 ROM size, either in units or as an exponent with a multiplier
+static bool GetNes20RomSize(u8_t lsb, u8_t msb, u32_t unitSize, u32_t *size)
+{
+  if (msb != 0x0F)
+  {
+    *size = (((u32_t) msb << 8) | lsb) * unitSize;
+    return true;
+  }
 
-  f = fopen(file, "rb");
-  if (f == NULL)
+  u8_t exponent = lsb >> 2;
+  if (exponent > 28)
   {
-    LogError("Unable to open file %s", file);
     return false;
   }
+  *size = ((u32_t) 1 << exponent) * ((lsb & 0x03) * 2 + 1);
+  return true;
+}
+
+// NES 2.0 RAM sizes are 64 << shift, 0 means none
+static inline u32_t GetNes20RamSize(u8_t shift)
+{
+  return shift == 0 ? 0 : (u32_t) 64 << shift;
+}
+
+bool INesLoader_ParseHeader(const u8_t *data, size_t size, INesRomInfo_t *info)
+{
+  INesHeader_t header;
 
-  if (fread(&header, 1, 16, f) != 16)
+  if (size < sizeof(header) || memcmp(data, "NES\x1A", 4) != 0)
   {
-    fclose(f);
-    LogError("Unable to read file %s", file);
     return false;
   }
+  memcpy(&header, data, sizeof(header));
+  memset(info, 0, sizeof(*info));
 
-  LogMessage("Loading file %s", file);
-  LogMessage("Mapper PRG ROM: %u x 16k", header.PrgRomSize);
-  LogMessage("Mapper CHR ROM: %u x 8k", header.ChrRomSize);
-  LogMessage("Mapper flags6: 0x%02X", header.Flags6);
-  LogMessage("Mapper flags7: 0x%02X", header.Flags7);
-  LogMessage("Mapper flags8: 0x%02X", header.Flags8);
-  LogMessage("Mapper flags9: 0x%02X", header.Flags9);
-  LogMessage("Mapper flagsA: 0x%02X", header.Flags10);
-
-  if (header.Flags6 & 0x04)
-  {
-    // 512 byte trainer for 0x7000 - 0x71FF
-    if (fseek(f, 512, SEEK_CUR) != 0)
+  info->IsNes20 = (header.Flags7 & INES_FLAGS7_VERSION_MASK) == INES_FLAGS7_VERSION_NES20;
+  info->MapperId = (header.Flags6 & INES_FLAGS6_MAPPER_MASK) >> INES_FLAGS6_MAPPER_SHIFT;
+  info->HasBattery = (header.Flags6 & INES_FLAGS6_BATTERY_RAM) != 0;
+  info->RomOffset = sizeof(header) + (header.Flags6 & INES_FLAGS6_TRAINER ? INES_TRAINER_SIZE : 0);
+  if (header.Flags6 & INES_FLAGS6_FOUR_SCREEN_VRAM)
+  {
+    info->Mirror = MIRROR_MODE_FOUR;
+  }
+  else
+  {
+    info->Mirror = header.Flags6 & INES_FLAGS6_MIRROR_VERTICAL ? MIRROR_MODE_VERTICAL : MIRROR_MODE_HORIZONTAL;
+  }
+
+  if (info->IsNes20)
+  {
+    info->MapperId |= (header.Flags7 & INES_FLAGS7_MAPPER_MASK) | ((header.Flags8 & NES20_FLAGS8_MAPPER_MASK) << 8);
+    info->Submapper = header.Flags8 >> NES20_FLAGS8_SUBMAPPER_SHIFT;
+    if (!GetNes20RomSize(header.PrgRomSize, header.Flags9 & 0x0F, SIZE_16KB, &info->PrgRomSize) ||
+        !GetNes20RomSize(header.ChrRomSize, header.Flags9 >> 4, SIZE_8KB, &info->ChrRomSize))
     {
-      fclose(f);
-      LogError("Unable to read file %s", file);
       return false;
     }
+    info->PrgRamSize = GetNes20RamSize(header.Flags10 & 0x0F);
+    info->PrgNvramSize = GetNes20RamSize(header.Flags10 >> 4);
+    info->ChrRamSize = GetNes20RamSize(header.Flags11 & 0x0F);
+    info->ChrNvramSize = GetNes20RamSize(header.Flags11 >> 4);
+    info->Timing = (INesTiming_t) (header.Flags12 & NES20_FLAGS12_TIMING_MASK);
+  }
+  else
+  {
+    // Old dumping tools wrote their name at the end ("DiskDude!"), flags 7 and up are junk then
+    bool isPaddingClean = header.Flags12 == 0 && header.Padding[0] == 0 && header.Padding[1] == 0 && header.Padding[2] == 0;
+    if (isPaddingClean)
+    {
+      info->MapperId |= header.Flags7 & INES_FLAGS7_MAPPER_MASK;
+      info->Timing = header.Flags9 & INES_FLAGS9_PAL ? INES_TIMING_PAL : INES_TIMING_NTSC;
+    }
+    info->PrgRomSize = header.PrgRomSize * SIZE_16KB;
+    info->ChrRomSize = header.ChrRomSize * SIZE_8KB;
   }
 
-  u8_t mapperId = ((header.Flags6 & INES_FLAGS6_MAPPER_MASK) >> INES_FLAGS6_MAPPER_SHIFT) | (header.Flags7 & INES_FLAGS7_MAPPER_MASK);
+  return info->RomOffset + info->PrgRomSize + info->ChrRomSize <= size;
+}
+
+// Fixes up the header with the ROM database, bad headers are common in older dumps
+static void ApplyRomDatabase(const u8_t *rom, size_t romSize, INesRomInfo_t *info)
+{
+  u8_t sha1[SHA1_DIGEST_SIZE];
+  u32_t crc32 = Crc32_Update(0, rom, romSize);
+  Sha1_Calculate(rom, romSize, sha1);
 
-  switch (mapperId)
+  const RomDatabaseEntry_t *entry = RomDatabase_Find(crc32, sha1);
+  LogMessage("ROM CRC32: %08X%s", crc32, entry != NULL ? "" : ", not in the ROM database");
+  if (entry != NULL)
+  {
+    LogMessage("ROM database: %s", entry->Name);
+    RomDatabase_Apply(entry, info);
+  }
+}
+
+bool INesLoader_Load(const char* file, Mapper_t* mapper)
+{
+  MappedFile_t rom;
+  INesRomInfo_t info;
+
+  // PRG and CHR ROM are used straight from the mapped file
+  if (!MappedFile_OpenReadOnly(&rom, file))
   {
-  case 0x00:
-    Mapper000_Initialize(mapper, &header);
-    break;
-  case 0x01:
-    Mapper001_Initialize(mapper, &header);
-    break;
-  default:
-    fclose(f);
-    LogError("Mapper id %u in file %s is not supported", mapperId, file);
     return false;
   }
 
-  size_t bytesToRead = mapper->MemorySize;
-  if (fread(mapper->Memory, 1, bytesToRead, f) != bytesToRead)
+  if (!INesLoader_ParseHeader(rom.Data, rom.Size, &info))
   {
-    // TODO: Free mapper memory
-    fclose(f);
-    LogError("Unable to fully read file %s", file);
+    MappedFile_Close(&rom);
+    LogError("File %s is not a valid iNES file", file);
     return false;
   }
 
-  fclose(f);
+  LogMessage("Loading file %s", file);
+  ApplyRomDatabase(rom.Data + info.RomOffset, info.PrgRomSize + info.ChrRomSize, &info);
+  LogMessage("Format: %s", info.IsNes20 ? "NES 2.0" : "iNES");
+  LogMessage("Mapper PRG ROM: %u bytes", info.PrgRomSize);
+  LogMessage("Mapper CHR ROM: %u bytes", info.ChrRomSize);
+  if (info.IsNes20)
+  {
+    LogMessage("Mapper PRG RAM: %u bytes, %u bytes battery backed", info.PrgRamSize, info.PrgNvramSize);
+    LogMessage("Mapper CHR RAM: %u bytes, %u bytes battery backed", info.ChrRamSize, info.ChrNvramSize);
+  }
+  if (info.Timing == INES_TIMING_PAL || info.Timing == INES_TIMING_DENDY)
+  {
+    LogMessage("Only NTSC timing is emulated, the game may run incorrectly");
+  }
+
+  // Banks are counted in 16k PRG and 8k CHR units
+  if (info.PrgRomSize == 0 || info.PrgRomSize % SIZE_16KB != 0 || info.PrgRomSize / SIZE_16KB > 255 ||
+      info.ChrRomSize % SIZE_8KB != 0 || info.ChrRomSize / SIZE_8KB > 255)
+  {
+    MappedFile_Close(&rom);
+    LogError("ROM sizes in file %s are not supported", file);
+    return false;
+  }
+
+  const MapperInfo_t *mapperInfo = Mapper_Find(info.MapperId);
+  if (mapperInfo == NULL)
+  {
+    MappedFile_Close(&rom);
+    LogError("Mapper id %u in file %s is not supported", info.MapperId, file);
+    return false;
+  }
+  LogMessage("Mapper: %u.%u (%s)", info.MapperId, info.Submapper, mapperInfo->Name);
+
+  u8_t *ramArena = calloc(1, MAPPER_RAM_ARENA_SIZE);
+  if (ramArena == NULL)
+  {
+    MappedFile_Close(&rom);
+    LogError("Unable to allocate cartridge RAM");
+    return false;
+  }
+
+  memset(mapper, 0, sizeof(*mapper));
+  mapper->Info = mapperInfo;
+  mapper->Submapper = info.Submapper;
+  mapper->Rom = rom;
+  mapper->Memory = rom.Data + info.RomOffset;
+  mapper->MemorySize = info.PrgRomSize + info.ChrRomSize;
+  mapper->ChrOffset = info.PrgRomSize;
+  mapper->NumPrgBanks = (u8_t) (info.PrgRomSize / SIZE_16KB);
+  mapper->NumChrBanks = (u8_t) (info.ChrRomSize / SIZE_8KB);
+  mapper->RamArena = ramArena;
+  mapper->Mirror = info.Mirror;
+  mapper->HasBattery = _isSaveFileEnabled && (info.HasBattery || info.PrgNvramSize > 0);
+  SetSavePath(mapper, file);
+  if (info.Mirror == MIRROR_MODE_FOUR)
+  {
+    // Cartridge provides the other 2k of nametable RAM
+    mapper->FourScreenRam = Mapper_AllocateRam(mapper, 2048);
+  }
+  mapperInfo->Initialize(mapper, &info);
+
   return true;
 }
+
+void INesLoader_SetSaveFileEnabled(bool enabled)
+{
+  _isSaveFileEnabled = enabled;
+}
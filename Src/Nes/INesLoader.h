@@ -20,26 +20,73 @@
 #define INES_FLAGS6_MAPPER_SHIFT        (4)
 
 #define INES_FLAGS7_MAPPER_MASK         (0xF0)
+#define INES_FLAGS7_VERSION_MASK        (0x0C)
+#define INES_FLAGS7_VERSION_NES20       (0x08)
+
+#define INES_FLAGS9_PAL                 (0x01)    // iNES 1.0 only
+
+#define NES20_FLAGS8_MAPPER_MASK        (0x0F)    // Mapper bits 8-11
+#define NES20_FLAGS8_SUBMAPPER_SHIFT    (4)
+#define NES20_FLAGS12_TIMING_MASK       (0x03)
+
+#define INES_TRAINER_SIZE   512
 
 #define SIZE_16KB   16384
 #define SIZE_8KB    8192
+#define SIZE_4KB    4096
 
 #pragma pack(push, 1)
-typedef struct
+typedef struct _INesHeader_t
 {
   u8_t Magic[4];
   u8_t PrgRomSize;
   u8_t ChrRomSize;
   u8_t Flags6;
   u8_t Flags7;
-  u8_t Flags8;
-  u8_t Flags9;
-  u8_t Flags10;
-  u8_t Padding[5];
+  u8_t Flags8;      // NES 2.0: mapper bits 8-11 and submapper
+  u8_t Flags9;      // NES 2.0: PRG and CHR ROM size MSBs
+  u8_t Flags10;     // NES 2.0: PRG RAM and NVRAM shift counts
+  u8_t Flags11;     // NES 2.0: CHR RAM and NVRAM shift counts
+  u8_t Flags12;     // NES 2.0: CPU/PPU timing
+  u8_t Padding[3];
 } INesHeader_t;
 #pragma pack(pop)
 
+typedef enum
+{
+  INES_TIMING_NTSC,
+  INES_TIMING_PAL,
+  INES_TIMING_MULTIPLE,   // Works on both
+  INES_TIMING_DENDY
+} INesTiming_t;
+
+// Header contents of an iNES 1.0 or NES 2.0 file
+typedef struct _INesRomInfo_t
+{
+  bool IsNes20;
+  u16_t MapperId;
+  u8_t Submapper;
+  MirrorMode_t Mirror;    // Horizontal, vertical or four screen
+  bool HasBattery;
+  INesTiming_t Timing;
+  size_t RomOffset;       // Offset of PRG ROM in the file, after the header and trainer
+  u32_t PrgRomSize;       // In bytes
+  u32_t ChrRomSize;
+  u32_t PrgRamSize;       // RAM sizes are only known for NES 2.0, 0 otherwise
+  u32_t PrgNvramSize;
+  u32_t ChrRamSize;
+  u32_t ChrNvramSize;
+} INesRomInfo_t;
+
+// Parses the header of a .nes file in memory, fails when it isn't a valid
+// iNES file or the file is too short for the ROM sizes it declares
+bool INesLoader_ParseHeader(const u8_t *data, size_t size, INesRomInfo_t *info);
+
 bool INesLoader_Load(const char* file, Mapper_t *mapper);
 
+// Battery backed RAM of ROMs loaded afterwards is kept in a .sav file, or only
+// in memory when disabled. Enabled by default.
+void INesLoader_SetSaveFileEnabled(bool enabled);
+
 
 #endif /* SRC_NES_INESLOADER_H_ */
@@ -0,0 +1,245 @@
+/*
+ * Mapper.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Mapper.h"
+#include "Mapper000.h"
+#include "Mapper001.h"
+#include "Mapper002.h"
+#include "Mapper003.h"
+#include "Mapper004.h"
+#include "Mapper007.h"
+#include "Mapper066.h"
+#include "INesLoader.h"
+#include "Bus.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FOUR_SCREEN_RAM_SIZE    (2048)
+
+static const MapperInfo_t MAPPERS[] =
+{
+  { 0, "NROM", Mapper000_Initialize, Mapper000_Serialize, Mapper000_Deserialize, Mapper000_Destroy },
+  { 1, "MMC1", Mapper001_Initialize, Mapper001_Serialize, Mapper001_Deserialize, Mapper001_Destroy },
+  { 2, "UxROM", Mapper002_Initialize, Mapper002_Serialize, Mapper002_Deserialize, Mapper002_Destroy },
+  { 3, "CNROM", Mapper003_Initialize, Mapper003_Serialize, Mapper003_Deserialize, Mapper003_Destroy },
+  { 4, "MMC3", Mapper004_Initialize, Mapper004_Serialize, Mapper004_Deserialize, Mapper004_Destroy },
+  { 7, "AxROM", Mapper007_Initialize, Mapper007_Serialize, Mapper007_Deserialize, Mapper007_Destroy },
+  { 66, "GxROM", Mapper066_Initialize, Mapper066_Serialize, Mapper066_Deserialize, Mapper066_Destroy },
+};
+
+const MapperInfo_t* Mapper_Find(u16_t id)
+{
+  for (size_t i = 0; i < sizeof(MAPPERS) / sizeof(MAPPERS[0]); i++)
+  {
+    if (MAPPERS[i].Id == id)
+    {
+      return &MAPPERS[i];
+    }
+  }
+  return NULL;
+}
+
+u8_t* Mapper_AllocateRam(Mapper_t *mapper, size_t size)
+{
+  // The arena is sized for the largest combination any mapper asks for
+  NES_ASSERT(mapper->RamArenaUsed + size <= MAPPER_RAM_ARENA_SIZE);
+
+  u8_t *ram = mapper->RamArena + mapper->RamArenaUsed;
+  mapper->RamArenaUsed += size;
+  return ram;
+}
+
+u8_t* Mapper_AllocatePrgRam(Mapper_t *mapper, size_t size)
+{
+  NES_ASSERT(mapper->Save.Data == NULL);
+
+  if (mapper->HasBattery)
+  {
+    // The kernel writes the pages back, nothing to do on the emulation thread
+    if (MappedFile_OpenWritable(&mapper->Save, mapper->SavePath, size))
+    {
+      LogMessage("Battery backed RAM is kept in %s", mapper->SavePath);
+      return mapper->Save.Data;
+    }
+    LogError("Battery backed RAM won't be saved");
+  }
+  return Mapper_AllocateRam(mapper, size);
+}
+
+// Rounds a RAM size from the header up to a power of two within the supported range
+static u32_t LimitRamSize(u32_t size, u32_t minSize, u32_t maxSize, const char *name)
+{
+  u32_t limited = minSize;
+  while (limited < size && limited < maxSize)
+  {
+    limited <<= 1;
+  }
+  if (limited != size)
+  {
+    LogWarning("%u bytes of %s RAM in the header, using %u", size, name, limited);
+  }
+  return limited;
+}
+
+u8_t* Mapper_InitializePrgRam(Mapper_t *mapper, const INesRomInfo_t *info)
+{
+  u32_t size = info->PrgRamSize + info->PrgNvramSize;
+
+  if (!info->IsNes20)
+  {
+    // Boards without battery often have RAM too
+    size = SIZE_8KB;
+  }
+  else if (size == 0)
+  {
+    mapper->PrgRamSize = 0;
+    return NULL;
+  }
+
+  mapper->PrgRamSize = LimitRamSize(size, 1, MAPPER_MAX_PRG_RAM_SIZE, "PRG");
+  return Mapper_AllocatePrgRam(mapper, mapper->PrgRamSize);
+}
+
+void Mapper_InitializeChr(Mapper_t *mapper, const INesRomInfo_t *info)
+{
+  u32_t size = info->ChrRamSize + info->ChrNvramSize;
+
+  if (mapper->NumChrBanks != 0)
+  {
+    mapper->ChrRam = NULL;
+    mapper->ChrRamSize = 0;
+  }
+  else if (!info->IsNes20 || size == 0)
+  {
+    // No CHR ROM, the cartridge has 8k of CHR RAM instead
+    mapper->ChrRamSize = SIZE_8KB;
+    mapper->ChrRam = Mapper_AllocateRam(mapper, mapper->ChrRamSize);
+  }
+  else
+  {
+    // Smaller than a page can't be mapped, it would be mirrored within the page anyway
+    mapper->ChrRamSize = LimitRamSize(size, MAPPER_CHR_PAGE_SIZE, MAPPER_MAX_CHR_RAM_SIZE, "CHR");
+    mapper->ChrRam = Mapper_AllocateRam(mapper, mapper->ChrRamSize);
+  }
+
+  // Map the first 8k linearly
+  Mapper_MapChr(mapper, 0, MAPPER_NUM_CHR_PAGES, 0);
+}
+
+void Mapper_MapChr(Mapper_t *mapper, u8_t page, u8_t numPages, u32_t offset)
+{
+  u8_t *chr;
+  u32_t chrSize;
+
+  NES_ASSERT(page + numPages <= MAPPER_NUM_CHR_PAGES);
+
+  if (mapper->ChrRam != NULL)
+  {
+    chr = mapper->ChrRam;
+    chrSize = mapper->ChrRamSize;
+  }
+  else
+  {
+    chr = mapper->Memory + mapper->ChrOffset;
+    chrSize = mapper->NumChrBanks * SIZE_8KB;
+  }
+
+  for (u8_t i = 0; i < numPages; i++)
+  {
+    // Out of range banks wrap around, like the unconnected high bank lines would
+    mapper->ChrPages[page + i] = chr + ((offset + i * MAPPER_CHR_PAGE_SIZE) % chrSize);
+  }
+
+  if (mapper->Bus != NULL)
+  {
+    Bus_UpdateChrPages(mapper->Bus);
+  }
+}
+
+void Mapper_MapPrg(Mapper_t *mapper, u8_t page, u8_t numPages, u32_t offset)
+{
+  u32_t prgSize = mapper->NumPrgBanks * SIZE_16KB;
+
+  NES_ASSERT(page + numPages <= MAPPER_NUM_PRG_PAGES);
+
+  for (u8_t i = 0; i < numPages; i++)
+  {
+    mapper->PrgPages[page + i] = mapper->Memory + ((offset + i * MAPPER_PRG_PAGE_SIZE) % prgSize);
+  }
+
+  if (mapper->Bus != NULL)
+  {
+    Bus_UpdatePrgPages(mapper->Bus);
+  }
+}
+
+size_t Mapper_Serialize(const Mapper_t *mapper, u8_t *buffer, size_t capacity)
+{
+  size_t chrRamSize = mapper->ChrRamSize;
+  size_t fourScreenRamSize = mapper->FourScreenRam != NULL ? FOUR_SCREEN_RAM_SIZE : 0;
+  size_t size = 1 + chrRamSize + fourScreenRamSize + mapper->Info->Serialize(mapper, NULL);
+
+  if (buffer == NULL)
+  {
+    return size;
+  }
+  if (size > capacity)
+  {
+    LogError("Mapper state needs %u bytes, only %u available", (unsigned int) size, (unsigned int) capacity);
+    return 0;
+  }
+
+  *buffer++ = (u8_t) mapper->Mirror;
+  memcpy(buffer, mapper->ChrRam, chrRamSize);
+  buffer += chrRamSize;
+  memcpy(buffer, mapper->FourScreenRam, fourScreenRamSize);
+  buffer += fourScreenRamSize;
+  mapper->Info->Serialize(mapper, buffer);
+  return size;
+}
+
+bool Mapper_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size)
+{
+  size_t chrRamSize = mapper->ChrRamSize;
+  size_t fourScreenRamSize = mapper->FourScreenRam != NULL ? FOUR_SCREEN_RAM_SIZE : 0;
+  size_t headerSize = 1 + chrRamSize + fourScreenRamSize;
+
+  if (size < headerSize || buffer[0] > MIRROR_MODE_FOUR)
+  {
+    LogError("Invalid mapper state");
+    return false;
+  }
+
+  mapper->Mirror = (MirrorMode_t) buffer[0];
+  memcpy(mapper->ChrRam, &buffer[1], chrRamSize);
+  memcpy(mapper->FourScreenRam, &buffer[1 + chrRamSize], fourScreenRamSize);
+  if (!mapper->Info->Deserialize(mapper, &buffer[headerSize], size - headerSize))
+  {
+    LogError("Invalid %s mapper state", mapper->Info->Name);
+    return false;
+  }
+
+  if (mapper->Bus != NULL)
+  {
+    Bus_UpdateMirroring(mapper->Bus);
+  }
+  return true;
+}
+
+void Mapper_Teardown(Mapper_t *mapper)
+{
+  if (mapper->Info != NULL)
+  {
+    mapper->Info->Destroy(mapper);
+  }
+  MappedFile_Close(&mapper->Rom);
+  MappedFile_Sync(&mapper->Save);
+  MappedFile_Close(&mapper->Save);
+  free(mapper->RamArena);
+  memset(mapper, 0, sizeof(*mapper));
+}
@@ -9,36 +9,127 @@
 #define SRC_NES_MAPPER_H_
 
 #include "Types.h"
+#include "MappedFile.h"
+#include <stddef.h>
+
+#define MAPPER_CHR_PAGE_SIZE      (0x400)   // CHR is mapped in 1k pages
+#define MAPPER_NUM_CHR_PAGES      (8)       // Number of CHR pages for PPU 0x0000 - 0x1FFF
+#define MAPPER_PRG_PAGE_SIZE      (0x2000)  // PRG is mapped in 8k pages
+#define MAPPER_NUM_PRG_PAGES      (4)       // Number of PRG pages for CPU 0x8000 - 0xFFFF
+#define MAPPER_MAX_PRG_RAM_SIZE   (0x2000)  // PRG RAM at CPU 0x6000 - 0x7FFF, none of the mappers bank it
+#define MAPPER_MAX_CHR_RAM_SIZE   (0x8000)
+#define MAPPER_RAM_ARENA_SIZE     (0xA800)  // CHR RAM, PRG RAM and four screen RAM together
 
 typedef enum _MirrorMode_t
 {
   MIRROR_MODE_HORIZONTAL,
   MIRROR_MODE_VERTICAL,
-  MIRROR_MODE_SINGLE,
+  MIRROR_MODE_SINGLE_LOWER,
+  MIRROR_MODE_SINGLE_UPPER,
   MIRROR_MODE_FOUR,
 } MirrorMode_t;
 
 typedef struct _Bus_t Bus_t;
 typedef struct _Mapper_t Mapper_t;
+typedef struct _INesRomInfo_t INesRomInfo_t;
 
 typedef bool (*Mapper_Read)(Mapper_t *mapper, u16_t address, u8_t *data);
 typedef bool (*Mapper_Write)(Mapper_t *mapper, u16_t address, u8_t data);
+typedef void (*Mapper_PpuA12Rise)(Mapper_t *mapper);
+
+// Called with Memory, the bank counts, mirroring and the RAM arena already set up by the loader
+typedef void (*Mapper_Initializer)(Mapper_t *mapper, const INesRomInfo_t *info);
+// Writes the mapper specific state to buffer and returns its size, only returns the size when buffer is NULL
+typedef size_t (*Mapper_Serializer)(const Mapper_t *mapper, u8_t *buffer);
+// Restores state written by the serializer, including the bank mapping
+typedef bool (*Mapper_Deserializer)(Mapper_t *mapper, const u8_t *buffer, size_t size);
+// Frees what the initializer allocated outside of the RAM arena
+typedef void (*Mapper_Destructor)(Mapper_t *mapper);
+
+typedef struct
+{
+  u16_t Id;                         // iNES or NES 2.0 mapper ID
+  const char *Name;
+  Mapper_Initializer Initialize;
+  Mapper_Serializer Serialize;
+  Mapper_Deserializer Deserialize;
+  Mapper_Destructor Destroy;
+} MapperInfo_t;
 
 typedef struct _Mapper_t
 {
-  u8_t MapperId;     // iNES mapper ID
-  MirrorMode_t Mirror;  // Mirroring mode
+  u16_t MapperId;    // iNES mapper ID
+  u8_t Submapper;       // NES 2.0 submapper, 0 for iNES files
+  const MapperInfo_t *Info; // Registry entry of this mapper, set by the loader
+  MirrorMode_t Mirror;  // Mirroring mode, call Bus_UpdateMirroring after changing it
   Bus_t *Bus;           // The bus we are connected to
   u8_t NumPrgBanks;
   u8_t NumChrBanks;
-  u8_t *Memory;      // This mapper's backing memory, used internally
+  u8_t *Memory;      // PRG ROM followed by CHR ROM, read only as it points into Rom
   size_t MemorySize;    // The size of the mapper's memory, used internally
   size_t ChrOffset;     // Offset of CHR rom/ram in Memory
-  Mapper_Read ReadFromCpu;   // The mapper read function
+  MappedFile_t Rom;     // The mapped .nes file, shared with other instances running the same file
+  u8_t *RamArena;       // All writable cartridge memory, handed out by Mapper_AllocateRam
+  size_t RamArenaUsed;
+  bool HasBattery;      // PRG RAM is kept in SavePath
+  char SavePath[512];
+  MappedFile_t Save;    // The mapped save file, if it's in use
+  u8_t *FourScreenRam;  // Extra 2k of nametable RAM on the cartridge, only for four screen mirroring
+  u8_t *ChrRam;         // CHR RAM for cartridges without CHR ROM, NULL otherwise
+  u32_t ChrRamSize;
+  u32_t PrgRamSize;     // Of the RAM at 0x6000, a power of two mirrored over 8k, 0 without RAM
+  u8_t *ChrPages[MAPPER_NUM_CHR_PAGES]; // 1k CHR pages as seen by the PPU, only change using Mapper_MapChr
+  Mapper_Read ReadFromCpu;   // The mapper read function, may be NULL when PRG pages cover all reads
   Mapper_Write WriteFromCpu; // The mapper write function
-  Mapper_Read ReadFromPpu;   // The mapper read function
-  Mapper_Write WriteFromPpu; // The mapper write function
+  Mapper_PpuA12Rise PpuA12Rise; // Called on filtered rising edges of PPU A12 while rendering, may be NULL
+  u8_t *PrgPages[MAPPER_NUM_PRG_PAGES]; // 8k PRG pages as seen by the CPU, only change using Mapper_MapPrg
+  unsigned int NumBankSwitches; // Bank register writes, for metrics
   void *CustomData;     // Pointer to custom data for the mapper implementation
 } Mapper_t;
 
+// Returns the registry entry for an iNES mapper ID, NULL if it isn't supported
+const MapperInfo_t* Mapper_Find(u16_t id);
+
+// Returns zeroed memory from the RAM arena, freed on teardown
+u8_t* Mapper_AllocateRam(Mapper_t *mapper, size_t size);
+
+// Returns PRG RAM, mapped from the save file when the cartridge has a battery.
+// Falls back to arena RAM that isn't saved when the file can't be mapped.
+u8_t* Mapper_AllocatePrgRam(Mapper_t *mapper, size_t size);
+
+// Returns PRG RAM for 0x6000 - 0x7FFF sized from the NES 2.0 header, NULL when
+// the cartridge has none. iNES 1.0 headers don't tell, those always get 8k.
+u8_t* Mapper_InitializePrgRam(Mapper_t *mapper, const INesRomInfo_t *info);
+
+// Offset in PRG RAM of a CPU address in 0x6000 - 0x7FFF
+static inline u16_t Mapper_GetPrgRamOffset(const Mapper_t *mapper, u16_t address)
+{
+  return (address - 0x6000) & (mapper->PrgRamSize - 1);
+}
+
+// Sets up CHR RAM sized from the header when there is no CHR ROM, 8k for iNES 1.0
+void Mapper_InitializeChr(Mapper_t *mapper, const INesRomInfo_t *info);
+
+void Mapper_MapChr(Mapper_t *mapper, u8_t page, u8_t numPages, u32_t offset);
+
+// Maps PRG ROM at offset to CPU 0x8000 + page * 8k, out of range offsets wrap.
+// Mapped pages are read by the bus directly, without calling ReadFromCpu.
+void Mapper_MapPrg(Mapper_t *mapper, u8_t page, u8_t numPages, u32_t offset);
+
+// Called by mappers once per CPU write that changes the banking, for metrics
+static inline void Mapper_CountBankSwitch(Mapper_t *mapper)
+{
+  mapper->NumBankSwitches++;
+}
+
+// Mapper state including CHR RAM and mirroring, returns the size written or
+// 0 if it doesn't fit. Only returns the size needed when buffer is NULL.
+size_t Mapper_Serialize(const Mapper_t *mapper, u8_t *buffer, size_t capacity);
+
+bool Mapper_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size);
+
+// Frees everything the mapper allocated and flushes the save file, the mapper
+// can be loaded again afterwards. Detach it from the bus first.
+void Mapper_Teardown(Mapper_t *mapper);
+
 #endif /* SRC_NES_MAPPER_H_ */
@@ -12,57 +12,16 @@
 #include <stdlib.h>
 #include "log.h"
 
-static u8_t _mapper000Ram[SIZE_8KB];
-
 bool Mapper000_ReadFromCpu(Mapper_t *mapper,
                            u16_t address,
                            u8_t *data)
 {
   Mapper000Data_t *customData = (Mapper000Data_t*) mapper->CustomData;
-  if (address >= 0x6000 && address <= 0x7FFF)
-  {
-    // Optional RAM bank, we always provide it
-    *data = customData->PrgRam8k[address - 0x6000];
-    return true;
-  }
-  else if (address >= 0x8000 && address <= 0xFFFF)
+  // Program ROM is read by the bus through the PRG pages
+  if (address >= 0x6000 && address <= 0x7FFF && customData->PrgRam != NULL)
   {
-    // Program ROM, may be two 16k banks or a mirrored 16k bank
-    u16_t externalBankBaseAddress;
-    u32_t internalBankBaseAddress;
-
-    if (mapper->NumPrgBanks == 1)
-    {
-      // Just 1 bank that is mirrored
-      internalBankBaseAddress = 0x0000;
-      if (address < 0xC000)
-      {
-        externalBankBaseAddress = 0x8000;
-      }
-      else
-      {
-        externalBankBaseAddress = 0xC000;
-      }
-    }
-    else
-    {
-      // Two banks
-      if (address < 0xC000)
-      {
-        externalBankBaseAddress = 0x8000;
-        internalBankBaseAddress = 0x0000;
-      }
-      else
-      {
-        externalBankBaseAddress = 0xC000;
-        internalBankBaseAddress = 0x4000;
-      }
-    }
-
-    u32_t index = address - externalBankBaseAddress
-        + internalBankBaseAddress;
-    NES_ASSERT(index < mapper->MemorySize);
-    *data = mapper->Memory[index];
+    // Optional RAM bank, provided unless a NES 2.0 header says there is none
+    *data = customData->PrgRam[Mapper_GetPrgRamOffset(mapper, address)];
     return true;
   }
 
@@ -74,105 +33,59 @@ bool Mapper000_WriteFromCpu(Mapper_t *mapper,
                             u8_t data)
 {
   Mapper000Data_t *customData = (Mapper000Data_t*) mapper->CustomData;
-  if (address >= 0x6000 && address <= 0x7FFF)
+  if (address >= 0x6000 && address <= 0x7FFF && customData->PrgRam != NULL)
   {
-    // Optional RAM bank, we always provide it
-    customData->PrgRam8k[address - 0x6000] = data;
+    // Optional RAM bank, provided unless a NES 2.0 header says there is none
+    customData->PrgRam[Mapper_GetPrgRamOffset(mapper, address)] = data;
     return true;
   }
-  else if (address >= 0x8000 && address <= 0xFFFF)
+  else if (address >= 0x8000)
   {
-    // Program ROM, may be two 16k banks or a mirrored 16k bank
-    u16_t externalBankBaseAddress;
-    u32_t internalBankBaseAddress;
-
-    if (mapper->NumPrgBanks == 1)
-    {
-      // Just 1 bank that is mirrored
-      internalBankBaseAddress = 0x0000;
-      if (address < 0xC000)
-      {
-        externalBankBaseAddress = 0x8000;
-      }
-      else
-      {
-        externalBankBaseAddress = 0xC000;
-      }
-    }
-    else
-    {
-      // Two banks
-      if (address < 0xC000)
-      {
-        externalBankBaseAddress = 0x8000;
-        internalBankBaseAddress = 0x0000;
-      }
-      else
-      {
-        externalBankBaseAddress = 0xC000;
-        internalBankBaseAddress = 0x4000;
-      }
-    }
-
-    u32_t index = address - externalBankBaseAddress
-        + internalBankBaseAddress;
-    NES_ASSERT(index < mapper->MemorySize);
-    mapper->Memory[index] = data;
+    // Program ROM isn't writable
     return true;
   }
 
   return false;
 }
 
-bool Mapper000_ReadFromPpu(Mapper_t *mapper,
-                           u16_t address,
-                           u8_t *data)
+size_t Mapper000_Serialize(const Mapper_t *mapper, u8_t *buffer)
 {
-  if (address >= 0x0000 && address <= 0x1FFF)
+  Mapper000Data_t *customData = (Mapper000Data_t*) mapper->CustomData;
+  if (buffer != NULL)
   {
-    if (mapper->NumChrBanks > 0)
-    {
-      // PPU CHR ROM
-      u32_t offset = address + mapper->ChrOffset;
-      NES_ASSERT(offset < mapper->MemorySize);
-      *data = mapper->Memory[offset];
-      return true;
-    }
+    memcpy(buffer, customData->PrgRam, mapper->PrgRamSize);
   }
+  return mapper->PrgRamSize;
+}
 
-  return false;
+bool Mapper000_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size)
+{
+  Mapper000Data_t *customData = (Mapper000Data_t*) mapper->CustomData;
+  if (size != mapper->PrgRamSize)
+  {
+    return false;
+  }
+  memcpy(customData->PrgRam, buffer, mapper->PrgRamSize);
+  return true;
 }
 
-bool Mapper000_WriteFromPpu(Mapper_t *mapper,
-                            u16_t address,
-                            u8_t data)
+void Mapper000_Destroy(Mapper_t *mapper)
 {
-  return false;
+  free(mapper->CustomData);
 }
 
 void Mapper000_Initialize(Mapper_t *mapper,
-                          INesHeader_t *header)
+                          const INesRomInfo_t *info)
 {
-  memset(mapper, 0, sizeof(*mapper));
-
   mapper->MapperId = 0x00;
-  mapper->Mirror = header->Flags6 & 0x01 ? MIRROR_MODE_VERTICAL : MIRROR_MODE_HORIZONTAL;
-  mapper->MemorySize = header->PrgRomSize * SIZE_16KB + header->ChrRomSize * SIZE_8KB;
-  // TODO: Check for malloc failure
-  mapper->Memory = malloc((size_t) mapper->MemorySize);
-  mapper->ChrOffset = header->PrgRomSize * SIZE_16KB;
-  mapper->NumPrgBanks = header->PrgRomSize;
-  mapper->NumChrBanks = header->ChrRomSize;
   mapper->ReadFromCpu = Mapper000_ReadFromCpu;
-  mapper->ReadFromPpu = Mapper000_ReadFromPpu;
   mapper->WriteFromCpu = Mapper000_WriteFromCpu;
-  mapper->WriteFromPpu = Mapper000_WriteFromPpu;
+  Mapper_InitializeChr(mapper, info);
+  // A single 16k bank is mirrored by wrapping around
+  Mapper_MapPrg(mapper, 0, MAPPER_NUM_PRG_PAGES, 0);
 
   Mapper000Data_t *customData;
   customData = malloc(sizeof(Mapper000Data_t));
-  customData->PrgRam8k = _mapper000Ram;// malloc(SIZE_8KB);
+  customData->PrgRam = Mapper_InitializePrgRam(mapper, info);
   mapper->CustomData = customData;
-
-  // Init RAM for debugging purposes
-  memset(customData->PrgRam8k, 0x55, SIZE_8KB);
 }
@@ -12,9 +12,12 @@
 
 typedef struct
 {
-  u8_t *PrgRam8k;        // Pointer to 8k worth of program RAM
+  u8_t *PrgRam;          // Program RAM of mapper->PrgRamSize, NULL when there is none
 } Mapper000Data_t;
 
-void Mapper000_Initialize(Mapper_t *mapper, INesHeader_t *header);
+void Mapper000_Initialize(Mapper_t *mapper, const INesRomInfo_t *info);
+size_t Mapper000_Serialize(const Mapper_t *mapper, u8_t *buffer);
+bool Mapper000_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size);
+void Mapper000_Destroy(Mapper_t *mapper);
 
 #endif /* SRC_NES_MAPPER000_H_ */
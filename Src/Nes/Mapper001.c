@@ -7,72 +7,86 @@
 
 #include "Mapper001.h"
 #include "INesLoader.h"
+#include "Bus.h"
 #include "log.h"
 #include <string.h>
 #include <stdlib.h>
 
-static bool Mapper001_ReadFromCpu(Mapper_t *mapper, u16_t address, u8_t *data)
+#define CONTROL_MIRROR_MASK     (0x03)
+#define CONTROL_PRG_MODE_MASK   (0x0C)
+#define CONTROL_PRG_MODE_SHIFT  (2)
+#define CONTROL_CHR_4K          (0x10)    // Two switchable 4k CHR banks instead of one 8k bank
+#define PROGRAM_RAM_DISABLE     (0x10)
+
+static const MirrorMode_t MIRROR_MODES[4] =
+{
+  MIRROR_MODE_SINGLE_LOWER, MIRROR_MODE_SINGLE_UPPER, MIRROR_MODE_VERTICAL, MIRROR_MODE_HORIZONTAL
+};
+
+// Maps the banks selected by the registers, only called when a register changes
+static void UpdateBanks(Mapper_t *mapper)
 {
   Mapper001Data_t *customData = (Mapper001Data_t*) mapper->CustomData;
+  u8_t prgMode = (customData->ControlRegister & CONTROL_PRG_MODE_MASK) >> CONTROL_PRG_MODE_SHIFT;
+  u32_t selectedBank = (customData->ProgramRegister & 0x0F) * SIZE_16KB;
+  u32_t lastBank = (mapper->NumPrgBanks - 1) * SIZE_16KB;
 
-  if (customData->PrgRam8k != NULL && address >= 0x6000 && address <= 0x7FFF)
+  switch (prgMode)
   {
-    // Optional RAM bank
-    *data = customData->PrgRam8k[address - 0x6000];
-    return true;
+  case 0:
+  case 1:
+    // Single 32k bank, the lowest bit is ignored
+    Mapper_MapPrg(mapper, 0, MAPPER_NUM_PRG_PAGES, selectedBank & ~SIZE_16KB);
+    break;
+  case 2:
+    // Fixed first bank, second bank is variable
+    Mapper_MapPrg(mapper, 0, 2, 0);
+    Mapper_MapPrg(mapper, 2, 2, selectedBank);
+    break;
+  default:
+    // First bank is variable, last bank is fixed
+    Mapper_MapPrg(mapper, 0, 2, selectedBank);
+    Mapper_MapPrg(mapper, 2, 2, lastBank);
+    break;
   }
-  else if (address >= 0x8000 && address <= 0xFFFF)
+
+  if (customData->ControlRegister & CONTROL_CHR_4K)
   {
-    // Program ROM, may be a single 32k or two 16k banks
-    u8_t bankMode = (customData->ControlRegister >> 2) & 0x03;
-    u16_t externalBankBaseAddress;
-    u32_t internalBankBaseAddress;
-    u8_t selectedBank = (customData->ProgramRegister) & 0x0F;
+    Mapper_MapChr(mapper, 0, 4, customData->Char0Register * SIZE_4KB);
+    Mapper_MapChr(mapper, 4, 4, customData->Char1Register * SIZE_4KB);
+  }
+  else
+  {
+    // Single 8k bank, the lowest bit is ignored
+    Mapper_MapChr(mapper, 0, MAPPER_NUM_CHR_PAGES, (customData->Char0Register & 0x1E) * SIZE_4KB);
+  }
+}
 
-    if (bankMode == 0 || bankMode == 1)
-    {
-      // Single 32k bank
-      // Clear lowest bit since it is ignored in 32k mode
-      selectedBank &= ~0x01;
-      externalBankBaseAddress = 0x8000;
-      internalBankBaseAddress = selectedBank * SIZE_16KB;
-    }
-    else if (bankMode == 2)
-    {
-      // Fixed first bank, second bank is variable
-      if (address < 0xC000)
-      {
-        // First bank
-        externalBankBaseAddress = 0x8000;
-        internalBankBaseAddress = 0x0000;
-      }
-      else
-      {
-        // Second bank, find mapping
-        externalBankBaseAddress = 0xC000;
-        internalBankBaseAddress = selectedBank * SIZE_16KB;
-      }
-    }
-    else
-    {
-      // First bank is variable, Last bank is fixed
-      if (address < 0xC000)
-      {
-        // Switchable bank
-        externalBankBaseAddress = 0x8000;
-        internalBankBaseAddress = selectedBank * SIZE_16KB;
-      }
-      else
-      {
-        // Fixed last bank
-        externalBankBaseAddress = 0xC000;
-        // Stats at 256k-16k
-        internalBankBaseAddress = 0x3C000;
-      }
-    }
-    u32_t index = address - externalBankBaseAddress + internalBankBaseAddress;
-    index &= (mapper->NumPrgBanks * SIZE_16KB - 1);
-    *data = mapper->Memory[index];
+static void UpdateMirroring(Mapper_t *mapper)
+{
+  Mapper001Data_t *customData = (Mapper001Data_t*) mapper->CustomData;
+  mapper->Mirror = MIRROR_MODES[customData->ControlRegister & CONTROL_MIRROR_MASK];
+  if (mapper->Bus != NULL)
+  {
+    Bus_UpdateMirroring(mapper->Bus);
+  }
+}
+
+static inline bool IsPrgRamEnabled(const Mapper001Data_t *customData)
+{
+  // Without RAM it behaves as if it's disabled
+  return customData->PrgRam != NULL && (customData->ProgramRegister & PROGRAM_RAM_DISABLE) == 0;
+}
+
+static bool Mapper001_ReadFromCpu(Mapper_t *mapper, u16_t address, u8_t *data)
+{
+  Mapper001Data_t *customData = (Mapper001Data_t*) mapper->CustomData;
+
+  // Program ROM is read by the bus through the PRG pages
+  if (address >= 0x6000 && address <= 0x7FFF)
+  {
+    // Optional RAM bank, open bus isn't emulated so disabled RAM reads as 0
+    *data = IsPrgRamEnabled(customData) ? customData->PrgRam[Mapper_GetPrgRamOffset(mapper, address)] : 0;
     return true;
   }
 
@@ -82,20 +96,24 @@ static bool Mapper001_ReadFromCpu(Mapper_t *mapper, u16_t address, u8_t *data)
 static bool Mapper001_WriteFromCpu(Mapper_t *mapper, u16_t address, u8_t data)
 {
   Mapper001Data_t *customData = (Mapper001Data_t*) mapper->CustomData;
-  if (customData->PrgRam8k != NULL && address >= 0x6000 && address <= 0x7FFF)
+  if (address >= 0x6000 && address <= 0x7FFF)
   {
     // Optional RAM bank
-    customData->PrgRam8k[address - 0x6000] = data;
+    if (IsPrgRamEnabled(customData))
+    {
+      customData->PrgRam[Mapper_GetPrgRamOffset(mapper, address)] = data;
+    }
     return true;
   }
   else if (address >= 0x8000)
   {
-    LogMessage("CPU Mapper Write: 0x%04X = 0x%02X", address, data);
     // Shift register time
     if (data & 0x80)
     {
-      // Clear register
+      // Clear register, also switches to the fixed last bank mode
       customData->ShiftRegister = 0x10;
+      customData->ControlRegister |= CONTROL_PRG_MODE_MASK;
+      UpdateBanks(mapper);
     }
     else if (customData->ShiftRegister & 0x01)
     {
@@ -110,6 +128,7 @@ static bool Mapper001_WriteFromCpu(Mapper_t *mapper, u16_t address, u8_t data)
       {
       case 0:
         customData->ControlRegister = customData->ShiftRegister & 0x1F;
+        UpdateMirroring(mapper);
         break;
       case 1:
         customData->Char0Register = customData->ShiftRegister & 0x1F;
@@ -123,6 +142,8 @@ static bool Mapper001_WriteFromCpu(Mapper_t *mapper, u16_t address, u8_t data)
       default:
         break;
       }
+      UpdateBanks(mapper);
+      Mapper_CountBankSwitch(mapper);
       // Reset register
       customData->ShiftRegister = 0x10;
     }
@@ -133,74 +154,65 @@ static bool Mapper001_WriteFromCpu(Mapper_t *mapper, u16_t address, u8_t data)
       customData->ShiftRegister |= ((data & 1) << 4);
     }
 
-    LogMessage("MMC1-SR: 0x%02X", customData->ShiftRegister);
-    LogMessage("MMC1-CR: 0x%02X", customData->ControlRegister);
-    LogMessage("MMC1-C0: 0x%02X", customData->Char0Register);
-    LogMessage("MMC1-C1: 0x%02X", customData->Char1Register);
-    LogMessage("MMC1-PR: 0x%02X", customData->ProgramRegister);
-
     return true;
   }
 
   return false;
 }
 
-static bool Mapper001_ReadFromPpu(Mapper_t *mapper, u16_t address, u8_t *data)
+size_t Mapper001_Serialize(const Mapper_t *mapper, u8_t *buffer)
 {
-  // TODO: This is supposed to be banked!
-  //Mapper000Data_t *customData = (Mapper000Data_t*) mapper->CustomData;
-  if (address >= 0x0000 && address <= 0x1FFF)
+  Mapper001Data_t *customData = (Mapper001Data_t*) mapper->CustomData;
+  if (buffer != NULL)
   {
-    if (mapper->NumChrBanks > 0)
-    {
-      // PPU CHR ROM
-      *data = mapper->Memory[address + mapper->ChrOffset];
-      return true;
-    }
+    buffer[0] = customData->ShiftRegister;
+    buffer[1] = customData->ControlRegister;
+    buffer[2] = customData->Char0Register;
+    buffer[3] = customData->Char1Register;
+    buffer[4] = customData->ProgramRegister;
+    memcpy(&buffer[5], customData->PrgRam, mapper->PrgRamSize);
   }
-
-  return false;
+  return 5 + mapper->PrgRamSize;
 }
 
-static bool Mapper001_WriteFromPpu(Mapper_t *mapper, u16_t address, u8_t data)
+bool Mapper001_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size)
 {
-  return false;
+  Mapper001Data_t *customData = (Mapper001Data_t*) mapper->CustomData;
+  if (size != 5 + mapper->PrgRamSize)
+  {
+    return false;
+  }
+  customData->ShiftRegister = buffer[0];
+  customData->ControlRegister = buffer[1];
+  customData->Char0Register = buffer[2];
+  customData->Char1Register = buffer[3];
+  customData->ProgramRegister = buffer[4];
+  memcpy(customData->PrgRam, &buffer[5], mapper->PrgRamSize);
+  UpdateBanks(mapper);
+  return true;
 }
 
-void Mapper001_Initialize(Mapper_t *mapper, INesHeader_t *header)
+void Mapper001_Destroy(Mapper_t *mapper)
 {
-  memset(mapper, 0, sizeof(*mapper));
+  free(mapper->CustomData);
+}
 
+void Mapper001_Initialize(Mapper_t *mapper, const INesRomInfo_t *info)
+{
   mapper->MapperId = 0x01;
-  mapper->Mirror = header->Flags6 & INES_FLAGS6_MIRROR_VERTICAL ? MIRROR_MODE_VERTICAL : MIRROR_MODE_HORIZONTAL;
-  mapper->MemorySize = header->PrgRomSize * SIZE_16KB + header->ChrRomSize * SIZE_8KB;
-  // TODO: Check for malloc failure
-  mapper->Memory = malloc((size_t) mapper->MemorySize);
-  mapper->ChrOffset = header->PrgRomSize * SIZE_16KB;
-  mapper->NumPrgBanks = header->PrgRomSize;
-  mapper->NumChrBanks = header->ChrRomSize;
   mapper->ReadFromCpu = Mapper001_ReadFromCpu;
-  mapper->ReadFromPpu = Mapper001_ReadFromPpu;
   mapper->WriteFromCpu = Mapper001_WriteFromCpu;
-  mapper->WriteFromPpu = Mapper001_WriteFromPpu;
+  Mapper_InitializeChr(mapper, info);
 
   Mapper001Data_t *customData;
   customData = malloc(sizeof(Mapper001Data_t));
   customData->ShiftRegister = 0x10; // bit 5 is set
-  customData->ControlRegister = 0x00;
+  // Powers up with the last bank fixed, mirroring stays as in the header until the first write
+  customData->ControlRegister = CONTROL_PRG_MODE_MASK;
   customData->Char0Register = 0x00;
   customData->Char1Register = 0x00;
   customData->ProgramRegister = 0x0F;
-  // TODO: For some reason the CPU tries to read from this RAM on some test ROMs that don't include it
-  if (header->Flags6 & INES_FLAGS6_BATTERY_RAM || true)
-  {
-    LogMessage("Mapper001: Using battery backed RAM");
-    customData->PrgRam8k = malloc(SIZE_8KB);
-  }
-  else
-  {
-    LogMessage("Mapper001: No battery backed RAM");
-    customData->PrgRam8k = 0;
-  }
+  customData->PrgRam = Mapper_InitializePrgRam(mapper, info);
   mapper->CustomData = customData;
+  UpdateBanks(mapper);
 }
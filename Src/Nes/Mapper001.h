@@ -17,9 +17,12 @@ typedef struct
   u8_t Char0Register;
   u8_t Char1Register;
   u8_t ProgramRegister;
-  u8_t *PrgRam8k;        // Pointer to 8k worth of program RAM
+  u8_t *PrgRam;          // Program RAM of mapper->PrgRamSize, NULL when there is none
 } Mapper001Data_t;
 
-void Mapper001_Initialize(Mapper_t *mapper, INesHeader_t *header);
+void Mapper001_Initialize(Mapper_t *mapper, const INesRomInfo_t *info);
+size_t Mapper001_Serialize(const Mapper_t *mapper, u8_t *buffer);
+bool Mapper001_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size);
+void Mapper001_Destroy(Mapper_t *mapper);
 
 #endif /* SRC_NES_MAPPER001_H_ */
@@ -0,0 +1,73 @@
+/*
+ * Mapper002.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Mapper002.h"
+#include "INesLoader.h"
+#include <string.h>
+#include <stdlib.h>
+
+static void UpdateBanks(Mapper_t *mapper)
+{
+  Mapper002Data_t *customData = (Mapper002Data_t*) mapper->CustomData;
+  Mapper_MapPrg(mapper, 0, 2, customData->BankRegister * SIZE_16KB);
+  Mapper_MapPrg(mapper, 2, 2, (mapper->NumPrgBanks - 1) * SIZE_16KB);
+}
+
+static bool Mapper002_WriteFromCpu(Mapper_t *mapper, u16_t address, u8_t data)
+{
+  Mapper002Data_t *customData = (Mapper002Data_t*) mapper->CustomData;
+  if (address >= 0x8000)
+  {
+    customData->BankRegister = data;
+    UpdateBanks(mapper);
+    Mapper_CountBankSwitch(mapper);
+    return true;
+  }
+
+  return false;
+}
+
+size_t Mapper002_Serialize(const Mapper_t *mapper, u8_t *buffer)
+{
+  Mapper002Data_t *customData = (Mapper002Data_t*) mapper->CustomData;
+  if (buffer != NULL)
+  {
+    buffer[0] = customData->BankRegister;
+  }
+  return 1;
+}
+
+bool Mapper002_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size)
+{
+  Mapper002Data_t *customData = (Mapper002Data_t*) mapper->CustomData;
+  if (size != 1)
+  {
+    return false;
+  }
+  customData->BankRegister = buffer[0];
+  UpdateBanks(mapper);
+  return true;
+}
+
+void Mapper002_Destroy(Mapper_t *mapper)
+{
+  free(mapper->CustomData);
+}
+
+void Mapper002_Initialize(Mapper_t *mapper, const INesRomInfo_t *info)
+{
+  mapper->MapperId = 0x02;
+  // No RAM, PRG ROM is read by the bus through the PRG pages
+  mapper->ReadFromCpu = NULL;
+  mapper->WriteFromCpu = Mapper002_WriteFromCpu;
+  Mapper_InitializeChr(mapper, info);
+
+  Mapper002Data_t *customData;
+  customData = calloc(1, sizeof(Mapper002Data_t));
+  mapper->CustomData = customData;
+  UpdateBanks(mapper);
+}
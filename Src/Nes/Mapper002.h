@@ -0,0 +1,26 @@
+/*
+ * Mapper002.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_NES_MAPPER002_H_
+#define SRC_NES_MAPPER002_H_
+#include "Types.h"
+#include "INesLoader.h"
+
+// UxROM: a switchable 16k PRG bank at 0x8000 and the last 16k bank fixed at 0xC000.
+// CHR is usually 8k of RAM.
+
+typedef struct
+{
+  u8_t BankRegister;     // Last value written to 0x8000 - 0xFFFF
+} Mapper002Data_t;
+
+void Mapper002_Initialize(Mapper_t *mapper, const INesRomInfo_t *info);
+size_t Mapper002_Serialize(const Mapper_t *mapper, u8_t *buffer);
+bool Mapper002_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size);
+void Mapper002_Destroy(Mapper_t *mapper);
+
+#endif /* SRC_NES_MAPPER002_H_ */
@@ -0,0 +1,74 @@
+/*
+ * Mapper003.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Mapper003.h"
+#include "INesLoader.h"
+#include <string.h>
+#include <stdlib.h>
+
+static void UpdateBanks(Mapper_t *mapper)
+{
+  Mapper003Data_t *customData = (Mapper003Data_t*) mapper->CustomData;
+  // A single 16k bank is mirrored by wrapping around
+  Mapper_MapPrg(mapper, 0, MAPPER_NUM_PRG_PAGES, 0);
+  Mapper_MapChr(mapper, 0, MAPPER_NUM_CHR_PAGES, customData->BankRegister * SIZE_8KB);
+}
+
+static bool Mapper003_WriteFromCpu(Mapper_t *mapper, u16_t address, u8_t data)
+{
+  Mapper003Data_t *customData = (Mapper003Data_t*) mapper->CustomData;
+  if (address >= 0x8000)
+  {
+    customData->BankRegister = data;
+    UpdateBanks(mapper);
+    Mapper_CountBankSwitch(mapper);
+    return true;
+  }
+
+  return false;
+}
+
+size_t Mapper003_Serialize(const Mapper_t *mapper, u8_t *buffer)
+{
+  Mapper003Data_t *customData = (Mapper003Data_t*) mapper->CustomData;
+  if (buffer != NULL)
+  {
+    buffer[0] = customData->BankRegister;
+  }
+  return 1;
+}
+
+bool Mapper003_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size)
+{
+  Mapper003Data_t *customData = (Mapper003Data_t*) mapper->CustomData;
+  if (size != 1)
+  {
+    return false;
+  }
+  customData->BankRegister = buffer[0];
+  UpdateBanks(mapper);
+  return true;
+}
+
+void Mapper003_Destroy(Mapper_t *mapper)
+{
+  free(mapper->CustomData);
+}
+
+void Mapper003_Initialize(Mapper_t *mapper, const INesRomInfo_t *info)
+{
+  mapper->MapperId = 0x03;
+  // No RAM, PRG ROM is read by the bus through the PRG pages
+  mapper->ReadFromCpu = NULL;
+  mapper->WriteFromCpu = Mapper003_WriteFromCpu;
+  Mapper_InitializeChr(mapper, info);
+
+  Mapper003Data_t *customData;
+  customData = calloc(1, sizeof(Mapper003Data_t));
+  mapper->CustomData = customData;
+  UpdateBanks(mapper);
+}
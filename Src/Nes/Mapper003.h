@@ -0,0 +1,25 @@
+/*
+ * Mapper003.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_NES_MAPPER003_H_
+#define SRC_NES_MAPPER003_H_
+#include "Types.h"
+#include "INesLoader.h"
+
+// CNROM: fixed 16k or 32k of PRG and a switchable 8k CHR bank.
+
+typedef struct
+{
+  u8_t BankRegister;     // Last value written to 0x8000 - 0xFFFF
+} Mapper003Data_t;
+
+void Mapper003_Initialize(Mapper_t *mapper, const INesRomInfo_t *info);
+size_t Mapper003_Serialize(const Mapper_t *mapper, u8_t *buffer);
+bool Mapper003_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size);
+void Mapper003_Destroy(Mapper_t *mapper);
+
+#endif /* SRC_NES_MAPPER003_H_ */
@@ -0,0 +1,229 @@
+/*
+ * Mapper004.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Mapper004.h"
+#include "INesLoader.h"
+#include "Bus.h"
+#include "log.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define BANK_SELECT_REGISTER_MASK   (0x07)
+#define BANK_SELECT_PRG_MODE        (0x40)    // Swaps R6 and the second last bank
+#define BANK_SELECT_CHR_INVERSION   (0x80)    // Swaps the 2k and 1k CHR halves
+#define PRG_RAM_ENABLE              (0x80)
+#define PRG_RAM_WRITE_PROTECT       (0x40)
+#define STATE_SIZE                  (15)
+
+static void UpdatePrgBanks(Mapper_t *mapper)
+{
+  Mapper004Data_t *customData = (Mapper004Data_t*) mapper->CustomData;
+  u32_t secondLast = mapper->NumPrgBanks * SIZE_16KB - 2 * MAPPER_PRG_PAGE_SIZE;
+  u32_t r6 = customData->Banks[6] * MAPPER_PRG_PAGE_SIZE;
+  bool isSwapped = (customData->BankSelect & BANK_SELECT_PRG_MODE) != 0;
+
+  Mapper_MapPrg(mapper, 0, 1, isSwapped ? secondLast : r6);
+  Mapper_MapPrg(mapper, 1, 1, customData->Banks[7] * MAPPER_PRG_PAGE_SIZE);
+  Mapper_MapPrg(mapper, 2, 1, isSwapped ? r6 : secondLast);
+  Mapper_MapPrg(mapper, 3, 1, secondLast + MAPPER_PRG_PAGE_SIZE);
+}
+
+static void UpdateChrBanks(Mapper_t *mapper)
+{
+  Mapper004Data_t *customData = (Mapper004Data_t*) mapper->CustomData;
+  // The 2k banks go to pages 0-3 and the 1k banks to 4-7, or the other way around
+  u8_t twoKPage = customData->BankSelect & BANK_SELECT_CHR_INVERSION ? 4 : 0;
+  u8_t oneKPage = twoKPage ^ 4;
+
+  // The lowest bit of the 2k bank numbers is ignored
+  Mapper_MapChr(mapper, twoKPage, 2, (customData->Banks[0] & 0xFE) * MAPPER_CHR_PAGE_SIZE);
+  Mapper_MapChr(mapper, twoKPage + 2, 2, (customData->Banks[1] & 0xFE) * MAPPER_CHR_PAGE_SIZE);
+  for (u8_t i = 0; i < 4; i++)
+  {
+    Mapper_MapChr(mapper, oneKPage + i, 1, customData->Banks[2 + i] * MAPPER_CHR_PAGE_SIZE);
+  }
+}
+
+static bool Mapper004_ReadFromCpu(Mapper_t *mapper, u16_t address, u8_t *data)
+{
+  Mapper004Data_t *customData = (Mapper004Data_t*) mapper->CustomData;
+
+  // PRG ROM is read by the bus through the PRG pages
+  if (address >= 0x6000 && address <= 0x7FFF)
+  {
+    // Open bus isn't emulated, disabled or missing RAM reads as 0
+    bool isEnabled = customData->PrgRam != NULL && (customData->PrgRamProtect & PRG_RAM_ENABLE) != 0;
+    *data = isEnabled ? customData->PrgRam[Mapper_GetPrgRamOffset(mapper, address)] : 0;
+    return true;
+  }
+
+  return false;
+}
+
+static bool Mapper004_WriteFromCpu(Mapper_t *mapper, u16_t address, u8_t data)
+{
+  Mapper004Data_t *customData = (Mapper004Data_t*) mapper->CustomData;
+
+  if (address >= 0x6000 && address <= 0x7FFF)
+  {
+    if (customData->PrgRam != NULL && (customData->PrgRamProtect & (PRG_RAM_ENABLE | PRG_RAM_WRITE_PROTECT)) == PRG_RAM_ENABLE)
+    {
+      customData->PrgRam[Mapper_GetPrgRamOffset(mapper, address)] = data;
+    }
+    return true;
+  }
+  else if (address < 0x8000)
+  {
+    return false;
+  }
+
+  // Registers are selected by bits 14, 13 and 0 of the address
+  bool isOdd = (address & 0x01) != 0;
+  switch (address & 0xE000)
+  {
+  case 0x8000:
+    if (isOdd)
+    {
+      customData->Banks[customData->BankSelect & BANK_SELECT_REGISTER_MASK] = data;
+      Mapper_CountBankSwitch(mapper);
+    }
+    else
+    {
+      // Selecting the next register only switches banks when the modes change
+      if ((customData->BankSelect ^ data) & (BANK_SELECT_PRG_MODE | BANK_SELECT_CHR_INVERSION))
+      {
+        Mapper_CountBankSwitch(mapper);
+      }
+      customData->BankSelect = data;
+    }
+    UpdatePrgBanks(mapper);
+    UpdateChrBanks(mapper);
+    break;
+  case 0xA000:
+    if (isOdd)
+    {
+      customData->PrgRamProtect = data;
+    }
+    else if (mapper->Mirror != MIRROR_MODE_FOUR)
+    {
+      mapper->Mirror = data & 0x01 ? MIRROR_MODE_HORIZONTAL : MIRROR_MODE_VERTICAL;
+      Bus_UpdateMirroring(mapper->Bus);
+    }
+    break;
+  case 0xC000:
+    if (isOdd)
+    {
+      customData->IrqCounter = 0;
+      customData->IsIrqReloadPending = true;
+    }
+    else
+    {
+      customData->IrqLatch = data;
+    }
+    break;
+  default:
+    customData->IsIrqEnabled = isOdd;
+    if (!isOdd)
+    {
+      // Disabling also acknowledges a pending IRQ
+      customData->IsIrqPending = false;
+      Bus_IRQ(mapper->Bus, IRQ_SOURCE_MAPPER, false);
+    }
+    break;
+  }
+
+  return true;
+}
+
+static void Mapper004_PpuA12Rise(Mapper_t *mapper)
+{
+  Mapper004Data_t *customData = (Mapper004Data_t*) mapper->CustomData;
+
+  if (customData->IrqCounter == 0 || customData->IsIrqReloadPending)
+  {
+    customData->IrqCounter = customData->IrqLatch;
+    customData->IsIrqReloadPending = false;
+  }
+  else
+  {
+    customData->IrqCounter--;
+  }
+
+  if (customData->IrqCounter == 0 && customData->IsIrqEnabled)
+  {
+    customData->IsIrqPending = true;
+    Bus_IRQ(mapper->Bus, IRQ_SOURCE_MAPPER, true);
+  }
+}
+
+size_t Mapper004_Serialize(const Mapper_t *mapper, u8_t *buffer)
+{
+  Mapper004Data_t *customData = (Mapper004Data_t*) mapper->CustomData;
+  if (buffer != NULL)
+  {
+    buffer[0] = customData->BankSelect;
+    memcpy(&buffer[1], customData->Banks, 8);
+    buffer[9] = customData->PrgRamProtect;
+    buffer[10] = customData->IrqLatch;
+    buffer[11] = customData->IrqCounter;
+    buffer[12] = customData->IsIrqReloadPending;
+    buffer[13] = customData->IsIrqEnabled;
+    buffer[14] = customData->IsIrqPending;
+    memcpy(&buffer[STATE_SIZE], customData->PrgRam, mapper->PrgRamSize);
+  }
+  return STATE_SIZE + mapper->PrgRamSize;
+}
+
+bool Mapper004_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size)
+{
+  Mapper004Data_t *customData = (Mapper004Data_t*) mapper->CustomData;
+  if (size != STATE_SIZE + mapper->PrgRamSize)
+  {
+    return false;
+  }
+  customData->BankSelect = buffer[0];
+  memcpy(customData->Banks, &buffer[1], 8);
+  customData->PrgRamProtect = buffer[9];
+  customData->IrqLatch = buffer[10];
+  customData->IrqCounter = buffer[11];
+  customData->IsIrqReloadPending = buffer[12] != 0;
+  customData->IsIrqEnabled = buffer[13] != 0;
+  customData->IsIrqPending = buffer[14] != 0;
+  if (mapper->Bus != NULL)
+  {
+    Bus_IRQ(mapper->Bus, IRQ_SOURCE_MAPPER, customData->IsIrqPending);
+  }
+  memcpy(customData->PrgRam, &buffer[STATE_SIZE], mapper->PrgRamSize);
+
+  UpdatePrgBanks(mapper);
+  UpdateChrBanks(mapper);
+  return true;
+}
+
+void Mapper004_Destroy(Mapper_t *mapper)
+{
+  free(mapper->CustomData);
+}
+
+void Mapper004_Initialize(Mapper_t *mapper, const INesRomInfo_t *info)
+{
+  mapper->MapperId = 0x04;
+  mapper->ReadFromCpu = Mapper004_ReadFromCpu;
+  mapper->WriteFromCpu = Mapper004_WriteFromCpu;
+  mapper->PpuA12Rise = Mapper004_PpuA12Rise;
+  Mapper_InitializeChr(mapper, info);
+
+  Mapper004Data_t *customData;
+  customData = calloc(1, sizeof(Mapper004Data_t));
+  // Games expect the RAM to be usable without enabling it first
+  customData->PrgRamProtect = PRG_RAM_ENABLE;
+  customData->PrgRam = Mapper_InitializePrgRam(mapper, info);
+  mapper->CustomData = customData;
+
+  UpdatePrgBanks(mapper);
+  UpdateChrBanks(mapper);
+}
@@ -0,0 +1,31 @@
+/*
+ * Mapper004.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_NES_MAPPER004_H_
+#define SRC_NES_MAPPER004_H_
+#include "Types.h"
+#include "INesLoader.h"
+
+typedef struct
+{
+  u8_t BankSelect;       // Register to update on the next bank data write, plus PRG and CHR modes
+  u8_t Banks[8];         // R0-R5 select CHR banks, R6 and R7 select PRG banks
+  u8_t PrgRamProtect;    // Bit 7 enables the RAM, bit 6 protects it from writes
+  u8_t IrqLatch;         // Value the scanline counter reloads with
+  u8_t IrqCounter;       // Counts down on each filtered PPU A12 rise
+  bool IsIrqReloadPending;
+  bool IsIrqEnabled;
+  bool IsIrqPending;     // IRQ asserted and not acknowledged yet
+  u8_t *PrgRam;          // Program RAM of mapper->PrgRamSize, NULL when there is none
+} Mapper004Data_t;
+
+void Mapper004_Initialize(Mapper_t *mapper, const INesRomInfo_t *info);
+size_t Mapper004_Serialize(const Mapper_t *mapper, u8_t *buffer);
+bool Mapper004_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size);
+void Mapper004_Destroy(Mapper_t *mapper);
+
+#endif /* SRC_NES_MAPPER004_H_ */
@@ -0,0 +1,79 @@
+/*
+ * Mapper007.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Mapper007.h"
+#include "INesLoader.h"
+#include "Bus.h"
+#include <string.h>
+#include <stdlib.h>
+
+static void UpdateBanks(Mapper_t *mapper)
+{
+  Mapper007Data_t *customData = (Mapper007Data_t*) mapper->CustomData;
+  Mapper_MapPrg(mapper, 0, MAPPER_NUM_PRG_PAGES, (customData->BankRegister & 0x07) * 2 * SIZE_16KB);
+  mapper->Mirror = customData->BankRegister & 0x10 ? MIRROR_MODE_SINGLE_UPPER : MIRROR_MODE_SINGLE_LOWER;
+  if (mapper->Bus != NULL)
+  {
+    Bus_UpdateMirroring(mapper->Bus);
+  }
+}
+
+static bool Mapper007_WriteFromCpu(Mapper_t *mapper, u16_t address, u8_t data)
+{
+  Mapper007Data_t *customData = (Mapper007Data_t*) mapper->CustomData;
+  if (address >= 0x8000)
+  {
+    customData->BankRegister = data;
+    UpdateBanks(mapper);
+    Mapper_CountBankSwitch(mapper);
+    return true;
+  }
+
+  return false;
+}
+
+size_t Mapper007_Serialize(const Mapper_t *mapper, u8_t *buffer)
+{
+  Mapper007Data_t *customData = (Mapper007Data_t*) mapper->CustomData;
+  if (buffer != NULL)
+  {
+    buffer[0] = customData->BankRegister;
+  }
+  return 1;
+}
+
+bool Mapper007_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size)
+{
+  Mapper007Data_t *customData = (Mapper007Data_t*) mapper->CustomData;
+  if (size != 1)
+  {
+    return false;
+  }
+  customData->BankRegister = buffer[0];
+  UpdateBanks(mapper);
+  return true;
+}
+
+void Mapper007_Destroy(Mapper_t *mapper)
+{
+  free(mapper->CustomData);
+}
+
+void Mapper007_Initialize(Mapper_t *mapper, const INesRomInfo_t *info)
+{
+  mapper->MapperId = 0x07;
+  mapper->Mirror = MIRROR_MODE_SINGLE_LOWER;
+  // No RAM, PRG ROM is read by the bus through the PRG pages
+  mapper->ReadFromCpu = NULL;
+  mapper->WriteFromCpu = Mapper007_WriteFromCpu;
+  Mapper_InitializeChr(mapper, info);
+
+  Mapper007Data_t *customData;
+  customData = calloc(1, sizeof(Mapper007Data_t));
+  mapper->CustomData = customData;
+  UpdateBanks(mapper);
+}
@@ -0,0 +1,26 @@
+/*
+ * Mapper007.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_NES_MAPPER007_H_
+#define SRC_NES_MAPPER007_H_
+#include "Types.h"
+#include "INesLoader.h"
+
+// AxROM: a switchable 32k PRG bank, 8k of CHR RAM and single screen mirroring
+// selected by bit 4 of the bank register.
+
+typedef struct
+{
+  u8_t BankRegister;     // Last value written to 0x8000 - 0xFFFF
+} Mapper007Data_t;
+
+void Mapper007_Initialize(Mapper_t *mapper, const INesRomInfo_t *info);
+size_t Mapper007_Serialize(const Mapper_t *mapper, u8_t *buffer);
+bool Mapper007_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size);
+void Mapper007_Destroy(Mapper_t *mapper);
+
+#endif /* SRC_NES_MAPPER007_H_ */
@@ -0,0 +1,73 @@
+/*
+ * Mapper066.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Mapper066.h"
+#include "INesLoader.h"
+#include <string.h>
+#include <stdlib.h>
+
+static void UpdateBanks(Mapper_t *mapper)
+{
+  Mapper066Data_t *customData = (Mapper066Data_t*) mapper->CustomData;
+  Mapper_MapPrg(mapper, 0, MAPPER_NUM_PRG_PAGES, ((customData->BankRegister >> 4) & 0x03) * 2 * SIZE_16KB);
+  Mapper_MapChr(mapper, 0, MAPPER_NUM_CHR_PAGES, (customData->BankRegister & 0x03) * SIZE_8KB);
+}
+
+static bool Mapper066_WriteFromCpu(Mapper_t *mapper, u16_t address, u8_t data)
+{
+  Mapper066Data_t *customData = (Mapper066Data_t*) mapper->CustomData;
+  if (address >= 0x8000)
+  {
+    customData->BankRegister = data;
+    UpdateBanks(mapper);
+    Mapper_CountBankSwitch(mapper);
+    return true;
+  }
+
+  return false;
+}
+
+size_t Mapper066_Serialize(const Mapper_t *mapper, u8_t *buffer)
+{
+  Mapper066Data_t *customData = (Mapper066Data_t*) mapper->CustomData;
+  if (buffer != NULL)
+  {
+    buffer[0] = customData->BankRegister;
+  }
+  return 1;
+}
+
+bool Mapper066_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size)
+{
+  Mapper066Data_t *customData = (Mapper066Data_t*) mapper->CustomData;
+  if (size != 1)
+  {
+    return false;
+  }
+  customData->BankRegister = buffer[0];
+  UpdateBanks(mapper);
+  return true;
+}
+
+void Mapper066_Destroy(Mapper_t *mapper)
+{
+  free(mapper->CustomData);
+}
+
+void Mapper066_Initialize(Mapper_t *mapper, const INesRomInfo_t *info)
+{
+  mapper->MapperId = 0x42;
+  // No RAM, PRG ROM is read by the bus through the PRG pages
+  mapper->ReadFromCpu = NULL;
+  mapper->WriteFromCpu = Mapper066_WriteFromCpu;
+  Mapper_InitializeChr(mapper, info);
+
+  Mapper066Data_t *customData;
+  customData = calloc(1, sizeof(Mapper066Data_t));
+  mapper->CustomData = customData;
+  UpdateBanks(mapper);
+}
@@ -0,0 +1,26 @@
+/*
+ * Mapper066.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_NES_MAPPER066_H_
+#define SRC_NES_MAPPER066_H_
+#include "Types.h"
+#include "INesLoader.h"
+
+// GxROM: a switchable 32k PRG bank in bits 4-5 and a switchable 8k CHR bank in
+// bits 0-1 of the bank register.
+
+typedef struct
+{
+  u8_t BankRegister;     // Last value written to 0x8000 - 0xFFFF
+} Mapper066Data_t;
+
+void Mapper066_Initialize(Mapper_t *mapper, const INesRomInfo_t *info);
+size_t Mapper066_Serialize(const Mapper_t *mapper, u8_t *buffer);
+bool Mapper066_Deserialize(Mapper_t *mapper, const u8_t *buffer, size_t size);
+void Mapper066_Destroy(Mapper_t *mapper);
+
+#endif /* SRC_NES_MAPPER066_H_ */
@@ -0,0 +1,421 @@
+/*
+ * Metrics.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Metrics.h"
+#include "NES.h"
+#include "Mapper.h"
+#include "log.h"
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#define REQUEST_BUFFER_SIZE   (1024)
+#define RESPONSE_BUFFER_SIZE  (8192)
+#define CLIENT_TIMEOUT_MS     (1000)    // A client gets this long to send its request, and per send of the response
+
+static const u32_t METRICS_FRAME_BUCKETS_MS[METRICS_NUM_FRAME_BUCKETS - 1] = { 1, 2, 4, 8, 16, 33, 66 };
+
+static MetricsInstance_t *_instances;
+static u32_t _numInstances;
+
+MetricsInstance_t *Metrics_GetInstance(u32_t index)
+{
+  return index < _numInstances ? &_instances[index] : NULL;
+}
+
+void Metrics_ResetBaseline(MetricsInstance_t *instance)
+{
+  MetricsCounters_t *counters = &instance->Counters;
+  Bus_t *bus = NES_GetBus();
+
+  counters->LastInstructionCount = NES_GetCPU()->InstructionCount;
+  counters->LastCycleCount = NES_GetPPU()->CycleCount;
+  counters->LastStallCycles = bus->DMA.NumStallCycles;
+  counters->LastBankSwitches = bus->Mapper != NULL ? bus->Mapper->NumBankSwitches : 0;
+}
+
+void Metrics_UpdateFrame(MetricsInstance_t *instance, uint64_t frameTicks)
+{
+  MetricsCounters_t *counters = &instance->Counters;
+  Bus_t *bus = NES_GetBus();
+  unsigned int instructionCount = NES_GetCPU()->InstructionCount;
+  unsigned int cycleCount = NES_GetPPU()->CycleCount;
+  unsigned int stallCycles = bus->DMA.NumStallCycles;
+  unsigned int bankSwitches = bus->Mapper != NULL ? bus->Mapper->NumBankSwitches : 0;
+
+  // Unsigned differences, so wrapping console counters are fine
+  counters->Frames++;
+  counters->CpuInstructions += instructionCount - counters->LastInstructionCount;
+  counters->PpuDots += cycleCount - counters->LastCycleCount;
+  counters->DmaStallCycles += stallCycles - counters->LastStallCycles;
+  counters->BankSwitches += bankSwitches - counters->LastBankSwitches;
+  counters->LastInstructionCount = instructionCount;
+  counters->LastCycleCount = cycleCount;
+  counters->LastStallCycles = stallCycles;
+  counters->LastBankSwitches = bankSwitches;
+
+  uint64_t ns = frameTicks * 1000000000 / SDL_GetPerformanceFrequency();
+  u8_t bucket = 0;
+  while (bucket < METRICS_NUM_FRAME_BUCKETS - 1 && ns > (uint64_t) METRICS_FRAME_BUCKETS_MS[bucket] * 1000000)
+  {
+    bucket++;
+  }
+  counters->FrameTimeBuckets[bucket]++;
+  counters->FrameTimeNs += ns;
+}
+
+void Metrics_SetAudioUnderruns(MetricsInstance_t *instance, uint32_t underruns)
+{
+  instance->Counters.AudioUnderruns = underruns;
+}
+
+// Appends to the response, output that doesn't fit is cut off
+static void Append(char *buffer, size_t *length, const char *format, ...)
+{
+  va_list args;
+
+  if (*length >= RESPONSE_BUFFER_SIZE - 1)
+  {
+    return;
+  }
+  va_start(args, format);
+  int written = vsnprintf(&buffer[*length], RESPONSE_BUFFER_SIZE - *length, format, args);
+  va_end(args);
+  if (written > 0)
+  {
+    *length += (size_t) written;
+  }
+  if (*length > RESPONSE_BUFFER_SIZE - 1)
+  {
+    *length = RESPONSE_BUFFER_SIZE - 1;
+  }
+}
+
+static void AppendCounter(char *buffer, size_t *length, const char *name, const char *help, size_t offset)
+{
+  uint64_t sum = 0;
+  for (u32_t i = 0; i < _numInstances; i++)
+  {
+    sum += *(const volatile uint64_t*) ((const u8_t*) &_instances[i].Counters + offset);
+  }
+  Append(buffer, length, "# HELP %s %s\n# TYPE %s counter\n%s %" PRIu64 "\n", name, help, name, name, sum);
+}
+
+// Sums all instances, every value is read once so a concurrent update is at most a frame late
+static size_t Format(char *buffer)
+{
+  size_t length = 0;
+
+  AppendCounter(buffer, &length, "nes_frames_total", "Emulated frames.", offsetof(MetricsCounters_t, Frames));
+  AppendCounter(buffer, &length, "nes_cpu_instructions_total", "Executed CPU instructions.",
+                offsetof(MetricsCounters_t, CpuInstructions));
+  AppendCounter(buffer, &length, "nes_ppu_dots_total", "Emulated PPU dots.", offsetof(MetricsCounters_t, PpuDots));
+  AppendCounter(buffer, &length, "nes_audio_underruns_total", "Audio device reads the emulation couldn't fill.",
+                offsetof(MetricsCounters_t, AudioUnderruns));
+  AppendCounter(buffer, &length, "nes_dma_stall_cycles_total", "CPU cycles stalled by OAM and DMC DMA.",
+                offsetof(MetricsCounters_t, DmaStallCycles));
+  AppendCounter(buffer, &length, "nes_mapper_bank_switches_total", "Mapper writes that switched PRG or CHR banks.",
+                offsetof(MetricsCounters_t, BankSwitches));
+
+  uint64_t buckets[METRICS_NUM_FRAME_BUCKETS] = { 0 };
+  uint64_t frameTimeNs = 0;
+  for (u32_t i = 0; i < _numInstances; i++)
+  {
+    for (u8_t b = 0; b < METRICS_NUM_FRAME_BUCKETS; b++)
+    {
+      buckets[b] += _instances[i].Counters.FrameTimeBuckets[b];
+    }
+    frameTimeNs += _instances[i].Counters.FrameTimeNs;
+  }
+  Append(buffer, &length, "# HELP nes_frame_time_seconds Wall clock time of emulating a frame.\n"
+         "# TYPE nes_frame_time_seconds histogram\n");
+  uint64_t count = 0;
+  for (u8_t b = 0; b < METRICS_NUM_FRAME_BUCKETS - 1; b++)
+  {
+    count += buckets[b];
+    Append(buffer, &length, "nes_frame_time_seconds_bucket{le=\"%.3f\"} %" PRIu64 "\n",
+           METRICS_FRAME_BUCKETS_MS[b] / 1000.0, count);
+  }
+  count += buckets[METRICS_NUM_FRAME_BUCKETS - 1];
+  Append(buffer, &length, "nes_frame_time_seconds_bucket{le=\"+Inf\"} %" PRIu64 "\n", count);
+  Append(buffer, &length, "nes_frame_time_seconds_sum %.9f\n", frameTimeNs / 1e9);
+  Append(buffer, &length, "nes_frame_time_seconds_count %" PRIu64 "\n", count);
+  return length;
+}
+
+#ifdef _WIN32
+
+#include <malloc.h>
+
+bool Metrics_Initialize(u32_t numInstances)
+{
+  // calloc only aligns to 16 bytes, instances have to start on a cache line
+  _instances = _aligned_malloc((size_t) numInstances * sizeof(MetricsInstance_t), METRICS_CACHE_LINE_SIZE);
+  if (_instances == NULL)
+  {
+    LogError("Unable to allocate %u metrics instances", numInstances);
+    return false;
+  }
+  memset(_instances, 0, (size_t) numInstances * sizeof(MetricsInstance_t));
+  _numInstances = numInstances;
+  return true;
+}
+
+void Metrics_Destroy(void)
+{
+  _aligned_free(_instances);
+  _instances = NULL;
+  _numInstances = 0;
+}
+
+bool Metrics_StartServer(const char *address)
+{
+  LogError("The metrics server is not supported on this platform, not listening on %s", address);
+  return false;
+}
+
+void Metrics_StopServer(void)
+{
+}
+
+#else
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static SDL_Thread *_thread;
+static SDL_atomic_t _isStopping;
+static int _listenSocket = -1;
+static char _socketPath[sizeof(((struct sockaddr_un*) NULL)->sun_path)];
+
+bool Metrics_Initialize(u32_t numInstances)
+{
+  // Shared, so the counters of forked children end up here
+  size_t size = (size_t) numInstances * sizeof(MetricsInstance_t);
+  void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED)
+  {
+    LogError("Unable to map %u metrics instances", numInstances);
+    return false;
+  }
+  _instances = memory;
+  _numInstances = numInstances;
+  return true;
+}
+
+void Metrics_Destroy(void)
+{
+  if (_instances != NULL)
+  {
+    munmap(_instances, (size_t) _numInstances * sizeof(MetricsInstance_t));
+  }
+  _instances = NULL;
+  _numInstances = 0;
+}
+
+static void SendAll(int client, const char *data, size_t size)
+{
+  while (size > 0)
+  {
+    ssize_t sent = send(client, data, size, MSG_NOSIGNAL);
+    if (sent <= 0)
+    {
+      return;
+    }
+    data += sent;
+    size -= (size_t) sent;
+  }
+}
+
+// Every request gets the metrics, whatever the path. HTTP/1.0, so closing ends the body.
+// Clients are served one at a time, so a client that stalls is dropped after
+// CLIENT_TIMEOUT_MS instead of holding up the next scrape.
+static void Serve(int client)
+{
+  static char request[REQUEST_BUFFER_SIZE];
+  static char body[RESPONSE_BUFFER_SIZE];
+  char header[128];
+  size_t received = 0;
+  uint32_t startTicks = SDL_GetTicks();
+
+  struct timeval timeout = { CLIENT_TIMEOUT_MS / 1000, (CLIENT_TIMEOUT_MS % 1000) * 1000 };
+  if (setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+      setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) != 0)
+  {
+    LogError("Unable to set the timeouts of a metrics client");
+    return;
+  }
+
+  while (received < sizeof(request) - 1)
+  {
+    // The timeout applies to every recv, a client trickling in bytes is cut off here
+    ssize_t size = recv(client, &request[received], sizeof(request) - 1 - received, 0);
+    if (size <= 0 || SDL_GetTicks() - startTicks > CLIENT_TIMEOUT_MS)
+    {
+      return;
+    }
+    received += (size_t) size;
+    request[received] = '\0';
+    if (strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL)
+    {
+      break;
+    }
+  }
+
+  size_t length = Format(body);
+  int headerLength = snprintf(header, sizeof(header),
+                              "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                              "Content-Length: %zu\r\n\r\n", length);
+  SendAll(client, header, (size_t) headerLength);
+  SendAll(client, body, length);
+}
+
+static int ServerThread(void *data)
+{
+  (void) data;
+  while (!SDL_AtomicGet(&_isStopping))
+  {
+    int client = accept(_listenSocket, NULL, NULL);
+    if (client < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      break;
+    }
+    Serve(client);
+    close(client);
+  }
+  return 0;
+}
+
+static int Listen(const char *address)
+{
+  int listenSocket;
+
+  if (strncmp(address, "unix:", 5) == 0)
+  {
+    struct sockaddr_un unixAddress;
+    const char *path = &address[5];
+    if (strlen(path) >= sizeof(unixAddress.sun_path))
+    {
+      LogError("Metrics socket path %s is too long", path);
+      return -1;
+    }
+    listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket < 0)
+    {
+      LogError("Unable to create the metrics socket");
+      return -1;
+    }
+    memset(&unixAddress, 0, sizeof(unixAddress));
+    unixAddress.sun_family = AF_UNIX;
+    strcpy(unixAddress.sun_path, path);
+    // A socket left behind by an earlier run would fail the bind
+    unlink(path);
+    if (bind(listenSocket, (struct sockaddr*) &unixAddress, sizeof(unixAddress)) != 0)
+    {
+      LogError("Unable to bind the metrics socket to %s", path);
+      close(listenSocket);
+      return -1;
+    }
+    strcpy(_socketPath, path);
+  }
+  else
+  {
+    struct sockaddr_in inetAddress;
+    char *end;
+    unsigned long port = strtoul(address, &end, 10);
+    if (*end != '\0' || port == 0 || port > 65535)
+    {
+      LogError("Invalid metrics address %s, expected a port or unix:path", address);
+      return -1;
+    }
+    listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenSocket < 0)
+    {
+      LogError("Unable to create the metrics socket");
+      return -1;
+    }
+    int reuse = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    memset(&inetAddress, 0, sizeof(inetAddress));
+    inetAddress.sin_family = AF_INET;
+    inetAddress.sin_port = htons((uint16_t) port);
+    inetAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listenSocket, (struct sockaddr*) &inetAddress, sizeof(inetAddress)) != 0)
+    {
+      LogError("Unable to bind the metrics socket to port %lu", port);
+      close(listenSocket);
+      return -1;
+    }
+  }
+
+  if (listen(listenSocket, 4) != 0)
+  {
+    LogError("Unable to listen on %s", address);
+    close(listenSocket);
+    return -1;
+  }
+  return listenSocket;
+}
+
+bool Metrics_StartServer(const char *address)
+{
+  _listenSocket = Listen(address);
+  if (_listenSocket < 0)
+  {
+    return false;
+  }
+
+  SDL_AtomicSet(&_isStopping, 0);
+  _thread = SDL_CreateThread(ServerThread, "Metrics", NULL);
+  if (_thread == NULL)
+  {
+    LogError("SDL_CreateThread failed: %s", SDL_GetError());
+    Metrics_StopServer();
+    return false;
+  }
+  LogMessage("Serving metrics on %s", address);
+  return true;
+}
+
+void Metrics_StopServer(void)
+{
+  if (_listenSocket < 0)
+  {
+    return;
+  }
+
+  // Wakes up the accept
+  SDL_AtomicSet(&_isStopping, 1);
+  shutdown(_listenSocket, SHUT_RDWR);
+  if (_thread != NULL)
+  {
+    SDL_WaitThread(_thread, NULL);
+    _thread = NULL;
+  }
+  close(_listenSocket);
+  _listenSocket = -1;
+  if (_socketPath[0] != '\0')
+  {
+    unlink(_socketPath);
+    _socketPath[0] = '\0';
+  }
+}
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Metrics.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_NES_METRICS_H_
+#define SRC_NES_METRICS_H_
+
+#include "Types.h"
+#include <stdint.h>
+
+// Runtime counters of emulation instances, served in the Prometheus text
+// format. Every instance has one writer, the process or thread emulating it,
+// and lives on its own cache lines, so writers never share a line. The server
+// thread reads and sums all instances without locks. Instances are in shared
+// memory, so children forked after Metrics_Initialize report to the parent.
+
+#define METRICS_CACHE_LINE_SIZE     (64)
+#define METRICS_NUM_FRAME_BUCKETS   (8)     // Upper bounds in METRICS_FRAME_BUCKETS_MS, the last one is +Inf
+
+typedef struct
+{
+  // Written by the owner, read by the server
+  volatile uint64_t Frames;
+  volatile uint64_t CpuInstructions;
+  volatile uint64_t PpuDots;
+  volatile uint64_t AudioUnderruns;
+  volatile uint64_t DmaStallCycles;
+  volatile uint64_t BankSwitches;
+  volatile uint64_t FrameTimeNs;
+  volatile uint64_t FrameTimeBuckets[METRICS_NUM_FRAME_BUCKETS]; // Not cumulative, summed when served
+
+  // Console counters at the last update, only used by the owner
+  unsigned int LastInstructionCount;
+  unsigned int LastCycleCount;
+  unsigned int LastStallCycles;
+  unsigned int LastBankSwitches;
+} MetricsCounters_t;
+
+typedef union
+{
+  MetricsCounters_t Counters;
+  u8_t Padding[(sizeof(MetricsCounters_t) + METRICS_CACHE_LINE_SIZE - 1) & ~(METRICS_CACHE_LINE_SIZE - 1)];
+} MetricsInstance_t;
+
+bool Metrics_Initialize(u32_t numInstances);
+
+void Metrics_Destroy(void);
+
+MetricsInstance_t *Metrics_GetInstance(u32_t index);
+
+// Takes the current console counters as the starting point, call after loading a ROM
+void Metrics_ResetBaseline(MetricsInstance_t *instance);
+
+// Adds what the console did since the last update and the time the frame took
+void Metrics_UpdateFrame(MetricsInstance_t *instance, uint64_t frameTicks);
+
+void Metrics_SetAudioUnderruns(MetricsInstance_t *instance, uint32_t underruns);
+
+// Listens on "unix:/path" or on a TCP port of the loopback address
+bool Metrics_StartServer(const char *address);
+
+void Metrics_StopServer(void);
+
+#endif /* SRC_NES_METRICS_H_ */
@@ -0,0 +1,204 @@
+/*
+ * Movie.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Movie.h"
+#include "MappedFile.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_CAPACITY    (3600)      // A minute of frames
+#define FM2_BUTTONS         "RLDUTSBA"  // Most significant bit first
+#define FM2_COMMAND_RESET   (0x01)
+#define FM2_COMMAND_POWER   (0x02)
+
+static bool Reserve(Movie_t *movie, u32_t numFrames)
+{
+  if (numFrames <= movie->Capacity)
+  {
+    return true;
+  }
+
+  u32_t capacity = movie->Capacity != 0 ? movie->Capacity : INITIAL_CAPACITY;
+  while (capacity < numFrames)
+  {
+    capacity *= 2;
+  }
+  u8_t (*buttons)[MOVIE_NUM_CONTROLLERS] = realloc(movie->Buttons, (size_t) capacity * sizeof(*buttons));
+  if (buttons == NULL)
+  {
+    LogError("Unable to allocate %u movie frames", capacity);
+    return false;
+  }
+  movie->Buttons = buttons;
+  movie->Capacity = capacity;
+  return true;
+}
+
+// Any character but '.' and ' ' is a pressed button, an empty field is a missing controller
+static u8_t ParseButtons(const char *field, const char *end)
+{
+  u8_t buttons = 0;
+  for (u8_t i = 0; i < 8 && field + i < end && field[i] != '|'; i++)
+  {
+    if (field[i] != '.' && field[i] != ' ')
+    {
+      buttons |= 0x80 >> i;
+    }
+  }
+  return buttons;
+}
+
+bool Movie_Load(Movie_t *movie, const char *file)
+{
+  MappedFile_t data;
+
+  memset(movie, 0, sizeof(*movie));
+  if (!MappedFile_OpenReadOnly(&data, file))
+  {
+    return false;
+  }
+
+  const char *text = (const char*) data.Data;
+  const char *textEnd = text + data.Size;
+  bool isOk = true;
+  bool hasResets = false;
+  u32_t lineNumber = 0;
+  while (isOk && text < textEnd)
+  {
+    const char *lineEnd = memchr(text, '\n', (size_t) (textEnd - text));
+    if (lineEnd == NULL)
+    {
+      lineEnd = textEnd;
+    }
+    lineNumber++;
+
+    if (lineEnd - text >= 8 && memcmp(text, "binary 1", 8) == 0)
+    {
+      LogError("Binary input in %s is not supported", file);
+      isOk = false;
+    }
+    else if (text[0] == '|')
+    {
+      // |commands|port0|port1|port2|
+      const char *fields[4] = { NULL };
+      u8_t numFields = 0;
+      for (const char *p = text; p < lineEnd && numFields < 4; p++)
+      {
+        if (*p == '|')
+        {
+          fields[numFields++] = p + 1;
+        }
+      }
+      if (numFields < 3)
+      {
+        LogError("Invalid input on line %u of %s", lineNumber, file);
+        isOk = false;
+        break;
+      }
+      isOk = Reserve(movie, movie->NumFrames + 1);
+      if (isOk)
+      {
+        hasResets |= (strtoul(fields[0], NULL, 10) & (FM2_COMMAND_RESET | FM2_COMMAND_POWER)) != 0;
+        movie->Buttons[movie->NumFrames][0] = ParseButtons(fields[1], lineEnd);
+        movie->Buttons[movie->NumFrames][1] = numFields > 3 ? ParseButtons(fields[2], lineEnd) : 0;
+        movie->NumFrames++;
+      }
+    }
+    text = lineEnd + 1;
+  }
+  MappedFile_Close(&data);
+
+  if (!isOk)
+  {
+    Movie_Free(movie);
+    return false;
+  }
+  if (hasResets)
+  {
+    LogMessage("Reset commands in %s are ignored", file);
+  }
+  LogMessage("Loaded movie %s, %u frames", file, movie->NumFrames);
+  return true;
+}
+
+static void WriteButtons(FILE *out, u8_t buttons)
+{
+  for (u8_t i = 0; i < 8; i++)
+  {
+    fputc((buttons & (0x80 >> i)) != 0 ? FM2_BUTTONS[i] : '.', out);
+  }
+}
+
+bool Movie_Save(const Movie_t *movie, const char *file, const char *romFile)
+{
+  FILE *out = fopen(file, "w");
+  if (out == NULL)
+  {
+    LogError("Unable to open %s", file);
+    return false;
+  }
+
+  // FCEUX only warns about the unknown ROM checksum
+  const char *romName = strrchr(romFile, '/');
+  romName = romName != NULL ? romName + 1 : romFile;
+  fprintf(out, "version 3\nemuVersion 22020\nrerecordCount 0\npalFlag 0\n");
+  fprintf(out, "romFilename %s\nromChecksum base64:AAAAAAAAAAAAAAAAAAAAAA==\n", romName);
+  fprintf(out, "guid 00000000-0000-0000-0000-000000000000\n");
+  fprintf(out, "fourscore 0\nmicrophone 0\nport0 1\nport1 1\nport2 0\nFDS 0\nNewPPU 0\n");
+  for (u32_t i = 0; i < movie->NumFrames; i++)
+  {
+    fputs("|0|", out);
+    WriteButtons(out, movie->Buttons[i][0]);
+    fputc('|', out);
+    WriteButtons(out, movie->Buttons[i][1]);
+    fputs("||\n", out);
+  }
+
+  bool isWritten = !ferror(out);
+  if (fclose(out) != 0 || !isWritten)
+  {
+    LogError("Unable to write %s", file);
+    return false;
+  }
+  LogMessage("Saved movie %s, %u frames", file, movie->NumFrames);
+  return true;
+}
+
+void Movie_Free(Movie_t *movie)
+{
+  free(movie->Buttons);
+  memset(movie, 0, sizeof(*movie));
+}
+
+void Movie_AdvanceFrame(Movie_t *movie)
+{
+  if (movie->Frame < movie->NumFrames)
+  {
+    memcpy(movie->Current, movie->Buttons[movie->Frame], sizeof(movie->Current));
+    movie->Frame++;
+  }
+  else
+  {
+    memset(movie->Current, 0, sizeof(movie->Current));
+  }
+}
+
+void Movie_Record(Movie_t *movie, u8_t buttons0, u8_t buttons1)
+{
+  if (!Reserve(movie, movie->NumFrames + 1))
+  {
+    return;
+  }
+  movie->Buttons[movie->NumFrames][0] = buttons0;
+  movie->Buttons[movie->NumFrames][1] = buttons1;
+  movie->NumFrames++;
+  movie->Frame = movie->NumFrames;
+  movie->Current[0] = buttons0;
+  movie->Current[1] = buttons1;
+}
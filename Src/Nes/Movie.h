@@ -0,0 +1,49 @@
+/*
+ * Movie.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_NES_MOVIE_H_
+#define SRC_NES_MOVIE_H_
+
+#include "Types.h"
+#include "Controllers.h"
+
+// Controller input per frame, read from and written to FCEUX .fm2 text movies.
+// Every frame stores one byte per controller in the bit order of
+// Controller_t Data, which is also the RLDUTSBA order of .fm2 input lines.
+// The state of the current frame is latched by Movie_AdvanceFrame, so reading
+// a button during the frame is a shift and a mask.
+
+#define MOVIE_NUM_CONTROLLERS   (2)
+
+typedef struct
+{
+  u8_t (*Buttons)[MOVIE_NUM_CONTROLLERS];
+  u32_t NumFrames;
+  u32_t Capacity;
+  u32_t Frame;            // Next frame to play back
+  u8_t Current[MOVIE_NUM_CONTROLLERS];
+} Movie_t;
+
+bool Movie_Load(Movie_t *movie, const char *file);
+
+// Writes the frames as .fm2, romFile only ends up in the header
+bool Movie_Save(const Movie_t *movie, const char *file, const char *romFile);
+
+void Movie_Free(Movie_t *movie);
+
+// Latches the buttons of the next frame, all released after the last frame
+void Movie_AdvanceFrame(Movie_t *movie);
+
+// Appends a frame and latches it
+void Movie_Record(Movie_t *movie, u8_t buttons0, u8_t buttons1);
+
+static inline bool Movie_IsPressed(const Movie_t *movie, u8_t controller, NESButton_t button)
+{
+  return (movie->Current[controller & (MOVIE_NUM_CONTROLLERS - 1)] >> button) & 1;
+}
+
+#endif /* SRC_NES_MOVIE_H_ */
@@ -12,9 +12,11 @@
 #include "PPU.h"
 #include "APU.h"
 #include "Controllers.h"
+#include "Debugger.h"
 #include "log.h"
 
 static int _clockCycleCount;
+static uint64_t _cpuCycleCount;   // Clock of the APU
 static CPU_t _cpu;
 static Bus_t _bus;
 static PPU_t _ppu;
@@ -24,14 +26,19 @@ static bool _isEvenCpuCycle;
 
 static u8_t _ppuTicker;
 static u8_t _cpuTicker;
+static bool _isCpuHalted;       // By a DMC sample fetch, for the current CPU cycle
 
 void NES_Initialize(void)
 {
   _clockCycleCount = 0;
+  _cpuCycleCount = 0;
+  _ppuTicker = 0;
+  _cpuTicker = 0;
+  _isCpuHalted = false;
 
   CPU_Initialize(&_cpu);
   PPU_Initialize(&_ppu);
-  APU_Initialize(&_apu);
+  APU_Initialize(&_apu, &_cpuCycleCount);
   Bus_Initialize(&_bus, &_cpu, &_ppu, &_apu);
   Controllers_Initialize(2);
 
@@ -48,8 +55,24 @@ void NES_TickClock(void)
 
   if ((_cpuTicker == 0) || (_cpuTicker == 3))
   {
-    // Handle DMA
-    if (_bus.DMA.State == DMA_STATE_IDLE)
+    // Handle DMA, a DMC sample fetch halts the CPU for whole cycles
+    if (_cpuTicker == 0)
+    {
+      _isCpuHalted = _bus.DMA.State == DMA_STATE_IDLE && _bus.DMA.DmcStallCycles > 0;
+      if (_isCpuHalted)
+      {
+        _bus.DMA.DmcStallCycles--;
+      }
+      if (_isCpuHalted || _bus.DMA.State != DMA_STATE_IDLE)
+      {
+        _bus.DMA.NumStallCycles++;
+      }
+    }
+    if (_isCpuHalted)
+    {
+      // Nothing happens on the CPU side
+    }
+    else if (_bus.DMA.State == DMA_STATE_IDLE)
     {
       CPU_Tick(&_cpu);
     }
@@ -79,8 +102,12 @@ void NES_TickClock(void)
 
   if (_cpuTicker == 0)
   {
-    // Tick APU after the CPU, it will also clock the registers
-    APU_Tick(&_apu);
+    // The APU catches up by itself when the CPU accesses it, it only runs here for its next event
+    if (_cpuCycleCount >= _apu.NextEventClock)
+    {
+      APU_RunEvents(&_apu);
+    }
+    _cpuCycleCount++;
   }
 
   if (_ppuTicker == 0)
@@ -102,7 +129,7 @@ void NES_TickUntilCPUComplete(void)
 {
   // Tick until the last CPU cycle for the current instruction
   unsigned int currentCount = _cpu.InstructionCount;
-  while (_cpu.InstructionCount == currentCount)
+  while (_cpu.InstructionCount == currentCount && !_isDebuggerBreak)
   {
     NES_TickClock();
   }
@@ -113,6 +140,11 @@ void NES_TickUntilFrameComplete(void)
   while (_ppu.IsEvenFrame == _ppuLastFrameEven)
   {
     NES_TickClock();
+    if (_isDebuggerBreak)
+    {
+      // The next call finishes the frame
+      return;
+    }
   }
   _ppuLastFrameEven = _ppu.IsEvenFrame;
 }
@@ -131,3 +163,8 @@ Bus_t *NES_GetBus(void)
 {
   return &_bus;
 }
+
+APU_t *NES_GetAPU(void)
+{
+  return &_apu;
+}
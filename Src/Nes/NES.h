@@ -11,6 +11,7 @@
 #include "CPU.h"
 #include "Bus.h"
 #include "PPU.h"
+#include "APU.h"
 
 void NES_Initialize(void);
 void NES_TickClock(void);
@@ -20,6 +21,7 @@ void NES_TickUntilFrameComplete(void);
 PPU_t *NES_GetPPU(void);
 CPU_t *NES_GetCPU(void);
 Bus_t *NES_GetBus(void);
+APU_t *NES_GetAPU(void);
 
 
 #endif /* SRC_NES_NES_H_ */
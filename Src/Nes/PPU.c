@@ -6,40 +6,18 @@
  */
 
 #include "PPU.h"
+#include "PPU_Internal.h"
+#include "PPURenderer.h"
 #include "Bus.h"
+#include "Debugger.h"
 #include "Palette.h"
 #include <string.h>
 #include <SDL2/SDL.h>
-#include "SharedSDL.h"
+#include "Profiler.h"
+#include "Trace.h"
 #include "log.h"
 
-#define CTRLFLAG_NAMETABLE_MASK       0x03
-#define CTRLFLAG_VRAM_INCREMENT       0x04
-#define CTRLFLAG_SPRITE_ADDRESS       0x08
-#define CTRLFLAG_BACKGROUND_ADDRESS   0x10
-#define CTRLFLAG_SPRITE_SIZE          0x20
-#define CTRLFLAG_MASTER_SELECT        0x40
-#define CTRLFLAG_VBLANK_NMI           0x80
-
-#define MASKFLAG_GREYSCALE            0x01
-#define MASKFLAG_BACKGROUND_LEFT      0x02
-#define MASKFLAG_SPRITES_LEFT         0x04
-#define MASKFLAG_BACKGROUND           0x08
-#define MASKFLAG_SPRITES              0x10
-#define MASKFLAG_EMPHASIZE_RED        0x20
-#define MASKFLAG_EMPHASIZE_GREEN      0x40
-#define MASKFLAG_EMPHASIZE_BLUE       0x80
-
-#define STATFLAG_GARBAGE_MASK         0x1F
-#define STATFLAG_SPRITE_OVERFLOW      0x20
-#define STATFLAG_SPRITE_0_HIT         0x40
-#define STATFLAG_VBLANK               0x80
-
-#define ATTRFLAG_PALLETE_MASK         0x03
-#define ATTRFLAG_NOTHING_MASK         0x1C      // TODO: This needs to apply to OAM reads and writes as well
-#define ATTRFLAG_PRIORITY             0x20
-#define ATTRFLAG_FLIP_HORIZONTAL      0x40
-#define ATTRFLAG_FLIP_VERTICAL        0x80
+#define A12_FILTER_CYCLES   (10)
 
 static u8_t BIT_REVERSE_TABLE[16] =
 {
@@ -64,6 +42,28 @@ static inline bool IsRendering(PPU_t *ppu)
   return CR8_IsBitSet(ppu->Mask, MASKFLAG_BACKGROUND) || CR8_IsBitSet(ppu->Mask, MASKFLAG_SPRITES);
 }
 
+// Fetch on behalf of rendering, also tracks address line A12 for mappers that
+// count its rising edges (MMC3). Rises within A12_FILTER_CYCLES of the line
+// going low are ignored, like the filter on the real cartridge does. Accesses
+// through $2006/$2007 don't clock the mapper.
+static inline u8_t FetchForRendering(PPU_t *ppu, u16_t address)
+{
+  bool isA12High = (address & 0x1000) != 0;
+  if (isA12High != ppu->IsA12High)
+  {
+    ppu->IsA12High = isA12High;
+    if (!isA12High)
+    {
+      ppu->A12LowCycle = ppu->CycleCount;
+    }
+    else if (ppu->CycleCount - ppu->A12LowCycle >= A12_FILTER_CYCLES)
+    {
+      Bus_PpuA12Rise(ppu->Bus);
+    }
+  }
+  return Bus_ReadFromPPU(ppu->Bus, address);
+}
+
 void PPU_RenderPixel(const PPU_t *ppu, u16f_t x, u16f_t y, u8_t pixel, u8_t palette)
 {
   if (_renderSurface == NULL)
@@ -71,7 +71,7 @@ void PPU_RenderPixel(const PPU_t *ppu, u16f_t x, u16f_t y, u8_t pixel, u8_t pale
     return;
   }
 
-  if (!IsInRange(0, _renderSurface->w, x) || !IsInRange(0, _renderSurface->h, y))
+  if (!IsInRange(0, _renderSurface->w - 1, x) || !IsInRange(0, _renderSurface->h - 1, y))
   {
     return;
   }
@@ -98,6 +98,30 @@ void PPU_RenderPixel(const PPU_t *ppu, u16f_t x, u16f_t y, u8_t pixel, u8_t pale
   *(u32_t*)pixelPtr = SDL_MapRGB(_renderSurface->format, r, g, b);
 }
 
+void PPU_SetSkipOutput(PPU_t *ppu, bool skip)
+{
+  ppu->SkipOutput = skip;
+  if (ppu->VCount == 0 && ppu->HCount == 0)
+  {
+    // Exactly on a frame boundary, so it can apply to this frame already
+    ppu->IsSkippingOutput = skip;
+  }
+}
+
+void PPU_SetDeferredRendering(PPU_t *ppu, bool defer)
+{
+  if (defer && !PPURenderer_Start())
+  {
+    return;
+  }
+
+  ppu->DeferRendering = defer;
+  if (ppu->VCount == 0 && ppu->HCount == 0)
+  {
+    ppu->IsDeferringRendering = defer;
+  }
+}
+
 void PPU_SetRenderSurface(SDL_Surface *surface)
 {
   _renderSurface = surface;
@@ -193,6 +217,73 @@ static u16_t CalculateSpriteAddress(u16f_t vCount, u16f_t ctrl, const OAMEntry_t
   return address;
 }
 
+static void LogDeferredDot(PPU_t *ppu, u16f_t minBackgroundX)
+{
+  PPU_LineLog_t *line = &ppu->LineLog;
+  u8_t mask = CR8_Read(ppu->Mask);
+
+  if (ppu->HCount == 0)
+  {
+    // Take everything that only changes between lines
+    line->Surface = _renderSurface;
+    line->Y = ppu->VCount;
+    line->Mask = mask;
+    line->NumMaskChanges = 0;
+    line->NumPaletteChanges = 0;
+    memcpy(line->Sprites, ppu->ActiveSpriteData, sizeof(line->Sprites));
+    for (u8f_t i = 0; i < 32; i++)
+    {
+      line->Palette[i] = Bus_ReadFromPPU(ppu->Bus, 0x3F00 + i);
+    }
+  }
+  else
+  {
+    u8_t lastMask = line->NumMaskChanges > 0 ? line->MaskChanges[line->NumMaskChanges - 1].Mask : line->Mask;
+    if (mask != lastMask && line->NumMaskChanges < PPU_LINE_LOG_MAX_MASK_CHANGES)
+    {
+      line->MaskChanges[line->NumMaskChanges].Dot = ppu->HCount;
+      line->MaskChanges[line->NumMaskChanges].Mask = mask;
+      line->NumMaskChanges++;
+    }
+  }
+
+  u8_t background = 0;
+  if ((mask & MASKFLAG_BACKGROUND) && ppu->HCount >= minBackgroundX)
+  {
+    u16_t pixelBit = (0x8000 >> ppu->X);
+    background = ((ppu->SRPatternLow & pixelBit) > 0) |
+                 (((ppu->SRPatternHigh & pixelBit) > 0) << 1) |
+                 (((ppu->SRAttributeLow & pixelBit) > 0) << 2) |
+                 (((ppu->SRAttributeHigh & pixelBit) > 0) << 3);
+  }
+  line->Background[ppu->HCount] = background;
+
+  if (ppu->HCount == PPU_VISIBLE_WIDTH - 1)
+  {
+    PPURenderer_SubmitLine(line);
+  }
+}
+
+// Only writes halfway a visible line are logged, the others end up in the
+// palette taken at dot 0 of the next line
+static void LogDeferredPaletteWrite(PPU_t *ppu, u16_t address)
+{
+  PPU_LineLog_t *line = &ppu->LineLog;
+
+  if (!ppu->IsDeferringRendering || ppu->IsSkippingOutput || ppu->VCount >= PPU_VISIBLE_HEIGHT ||
+      ppu->HCount == 0 || ppu->HCount >= PPU_VISIBLE_WIDTH)
+  {
+    return;
+  }
+  if (line->NumPaletteChanges < PPU_LINE_LOG_MAX_PALETTE_CHANGES)
+  {
+    PaletteChange_t *change = &line->PaletteChanges[line->NumPaletteChanges++];
+    change->Dot = ppu->HCount;
+    change->Index = address & 0x1F;
+    change->Value = Bus_ReadFromPPU(ppu->Bus, address);
+  }
+}
+
 void PPU_ClockRegisters(PPU_t *ppu)
 {
   if (ppu->PhaseCounter != 1)
@@ -211,10 +302,13 @@ void PPU_ClockRegisters(PPU_t *ppu)
 
 void PPU_Tick(PPU_t *ppu)
 {
-  SharedSDL_BeginTiming(PERF_INDEX_PPU);
+  Profiler_Begin(PROFILER_SECTION_PPU);
 
   bool isPreRenderScanline = (PPU_PRE_RENDER_SCANLINE == ppu->VCount);
   bool isVisibleScanline = IsInRange(0, 239, ppu->VCount);
+  // Skipping output wins from deferring it, nothing has to be composed at all then
+  bool isComposing = !ppu->IsSkippingOutput && !ppu->IsDeferringRendering;
+  bool isDeferring = !ppu->IsSkippingOutput && ppu->IsDeferringRendering;
 
   ppu->PhaseCounter = 1;
 
@@ -224,8 +318,6 @@ void PPU_Tick(PPU_t *ppu)
 
   // Do PPU things
 
-  SharedSDL_BeginTiming(PERF_INDEX_PPU_BG_FETCH);
-
   // Visible scanlines and pre-render scanline
   if (isPreRenderScanline || isVisibleScanline)
   {
@@ -245,16 +337,16 @@ void PPU_Tick(PPU_t *ppu)
           ppu->SRAttributeHigh =  (ppu->SRAttributeHigh & 0xFF00) | (ppu->NextBgAttribute & 0x02 ? 0xFF : 0x00);
         }
         // Fetch NT
-        ppu->NextBgTileId = Bus_ReadFromPPU(ppu->Bus, 0x2000 | (ppu->V & 0x0FFF));
+        ppu->NextBgTileId = FetchForRendering(ppu, 0x2000 | (ppu->V & 0x0FFF));
       }
       else if (pixelCycle == 3)
       {
         // Fetch AT
-        ppu->NextBgAttribute = Bus_ReadFromPPU(ppu->Bus,
-                                           0x23C0
-                                           | (ppu->V & 0x0C00)
-                                           | ((ppu->V >> 4) & 0x0038)
-                                           | ((ppu->V >> 2) & 0x0007));
+        ppu->NextBgAttribute = FetchForRendering(ppu,
+                                             0x23C0
+                                             | (ppu->V & 0x0C00)
+                                             | ((ppu->V >> 4) & 0x0038)
+                                             | ((ppu->V >> 2) & 0x0007));
         if (ppu->V & 0x40)
         {
           // Bit 1 of coarse Y is set
@@ -270,26 +362,22 @@ void PPU_Tick(PPU_t *ppu)
       else if (pixelCycle == 5)
       {
         // Fetch low BG tile byte
-        ppu->NextBgTileLow = Bus_ReadFromPPU(ppu->Bus,
-                                             (CR8_IsBitSet(ppu->Ctrl, CTRLFLAG_BACKGROUND_ADDRESS) ? 0x1000 : 0x000)
-                                             + ((u16f_t)ppu->NextBgTileId << 4)
-                                             + ((ppu->V >> 12) & 0x07) + 0);
+        ppu->NextBgTileLow = FetchForRendering(ppu,
+                                               (CR8_IsBitSet(ppu->Ctrl, CTRLFLAG_BACKGROUND_ADDRESS) ? 0x1000 : 0x000)
+                                               + ((u16f_t)ppu->NextBgTileId << 4)
+                                               + ((ppu->V >> 12) & 0x07) + 0);
       }
       else if (pixelCycle == 7)
       {
         // Fetch high BG tile byte
-        ppu->NextBgTileHigh = Bus_ReadFromPPU(ppu->Bus,
-                                              (CR8_IsBitSet(ppu->Ctrl, CTRLFLAG_BACKGROUND_ADDRESS) ? 0x1000 : 0x000)
-                                              + ((u16f_t)ppu->NextBgTileId << 4)
-                                              + ((ppu->V >> 12) & 0x07) + 8);
+        ppu->NextBgTileHigh = FetchForRendering(ppu,
+                                                (CR8_IsBitSet(ppu->Ctrl, CTRLFLAG_BACKGROUND_ADDRESS) ? 0x1000 : 0x000)
+                                                + ((u16f_t)ppu->NextBgTileId << 4)
+                                                + ((ppu->V >> 12) & 0x07) + 8);
       }
     }
   }
 
-  SharedSDL_EndTiming(PERF_INDEX_PPU_BG_FETCH);
-
-  SharedSDL_BeginTiming(PERF_INDEX_PPU_SPRITE_EVAL);
-
   if (isVisibleScanline)
   {
     if (IsInRange(1, 256, ppu->HCount))
@@ -395,10 +483,6 @@ void PPU_Tick(PPU_t *ppu)
     }
   }
 
-  SharedSDL_EndTiming(PERF_INDEX_PPU_SPRITE_EVAL);
-
-  SharedSDL_BeginTiming(PERF_INDEX_PPU_SPRITE_FETCH);
-
   if (isVisibleScanline || isPreRenderScanline)
   {
     if (IsInRange(257, 320, ppu->HCount))
@@ -416,7 +500,7 @@ void PPU_Tick(PPU_t *ppu)
       {
       case 1:
         // Fetch garbage NT
-        Bus_ReadFromPPU(ppu->Bus, 0x2000 | (ppu->V & 0x0FFF));
+        FetchForRendering(ppu, 0x2000 | (ppu->V & 0x0FFF));
         break;
       case 2:
         // Move attribute to 'latch'
@@ -424,11 +508,11 @@ void PPU_Tick(PPU_t *ppu)
         break;
       case 3:
         // Fetch garbage AT
-        Bus_ReadFromPPU(ppu->Bus,
-                        0x23C0
-                        | (ppu->V & 0x0C00)
-                        | ((ppu->V >> 4) & 0x0038)
-                        | ((ppu->V >> 2) & 0x0007));
+        FetchForRendering(ppu,
+                          0x23C0
+                          | (ppu->V & 0x0C00)
+                          | ((ppu->V >> 4) & 0x0038)
+                          | ((ppu->V >> 2) & 0x0007));
         // Load X coordinate into latch
         activeSprite->X = ppu->ActiveSpriteOAM[spriteIndex].X;
         break;
@@ -436,13 +520,13 @@ void PPU_Tick(PPU_t *ppu)
       {
         // Fetch low sprite tile byte
         u16_t address = CalculateSpriteAddress(ppu->VCount, CR8_Read(ppu->Ctrl), &ppu->ActiveSpriteOAM[spriteIndex], activeSprite->Attributes & ATTRFLAG_FLIP_VERTICAL);
-        activeSprite->SRPatternLow = Bus_ReadFromPPU(ppu->Bus, address);
+        activeSprite->SRPatternLow = FetchForRendering(ppu, address);
         break;
       }
       case 7:
       {
         u16_t address = CalculateSpriteAddress(ppu->VCount, CR8_Read(ppu->Ctrl), &ppu->ActiveSpriteOAM[spriteIndex], activeSprite->Attributes & ATTRFLAG_FLIP_VERTICAL) + 8;
-        activeSprite->SRPatternHigh = Bus_ReadFromPPU(ppu->Bus, address);
+        activeSprite->SRPatternHigh = FetchForRendering(ppu, address);
 
         // Do horizontal mirroring
         if (ppu->ActiveSpriteData[spriteIndex].Attributes & ATTRFLAG_FLIP_HORIZONTAL)
@@ -458,10 +542,6 @@ void PPU_Tick(PPU_t *ppu)
     }
   }
 
-  SharedSDL_EndTiming(PERF_INDEX_PPU_SPRITE_FETCH);
-
-  SharedSDL_BeginTiming(PERF_INDEX_PPU_ORDERING);
-
   // Try to render a pixel
   u8_t bgPixel = 0;
   u8_t bgPalette = 0;
@@ -472,70 +552,102 @@ void PPU_Tick(PPU_t *ppu)
   u16f_t minBackgroundX = CR8_IsBitSet(ppu->Mask, MASKFLAG_BACKGROUND_LEFT) ? 0 : 8;
   u16f_t minSpriteX = CR8_IsBitSet(ppu->Mask, MASKFLAG_SPRITES_LEFT) ? 0 : 8;
 
-  if (CR8_IsBitSet(ppu->Mask, MASKFLAG_BACKGROUND) && ppu->HCount >= minBackgroundX)
+  if (isComposing)
   {
-    // Try to render a pixel, RenderPixel will deal with any out of bounds write attempts
-    u16_t pixelBit = (0x8000 >> ppu->X);
-    u8_t pixel = ((ppu->SRPatternLow  & pixelBit) > 0) |
-                    (((ppu->SRPatternHigh &  pixelBit) > 0) << 1);
-    u8_t palette = ((ppu->SRAttributeLow  & pixelBit) > 0) |
-                      (((ppu->SRAttributeHigh &  pixelBit) > 0) << 1);
-
-    bgPixel = pixel;
-    bgPalette = palette;
-  }
+    if (CR8_IsBitSet(ppu->Mask, MASKFLAG_BACKGROUND) && ppu->HCount >= minBackgroundX)
+    {
+      // Try to render a pixel, RenderPixel will deal with any out of bounds write attempts
+      u16_t pixelBit = (0x8000 >> ppu->X);
+      u8_t pixel = ((ppu->SRPatternLow  & pixelBit) > 0) |
+                      (((ppu->SRPatternHigh &  pixelBit) > 0) << 1);
+      u8_t palette = ((ppu->SRAttributeLow  & pixelBit) > 0) |
+                        (((ppu->SRAttributeHigh &  pixelBit) > 0) << 1);
+
+      bgPixel = pixel;
+      bgPalette = palette;
+    }
 
-  bool isSpriteZero = false;
+    bool isSpriteZero = false;
 
-  if (CR8_IsBitSet(ppu->Mask, MASKFLAG_SPRITES) && ppu->HCount >= minSpriteX)
-  {
-    // Find a sprite pixel to draw
-    for (u8f_t i = 0; i < 8; i++)
+    if (CR8_IsBitSet(ppu->Mask, MASKFLAG_SPRITES) && ppu->HCount >= minSpriteX)
     {
-      if (ppu->ActiveSpriteData[i].X == 0)
+      // Find a sprite pixel to draw
+      for (u8f_t i = 0; i < 8; i++)
       {
-        u8f_t pixel = ((ppu->ActiveSpriteData[i].SRPatternLow & 0x80) > 0) |
-            (((ppu->ActiveSpriteData[i].SRPatternHigh &  0x80) > 0) << 1);
+        if (ppu->ActiveSpriteData[i].X == 0)
+        {
+          u8f_t pixel = ((ppu->ActiveSpriteData[i].SRPatternLow & 0x80) > 0) |
+              (((ppu->ActiveSpriteData[i].SRPatternHigh &  0x80) > 0) << 1);
 
-        u8f_t palette = (ppu->ActiveSpriteData[i].Attributes & ATTRFLAG_PALLETE_MASK) + 4;
+          u8f_t palette = (ppu->ActiveSpriteData[i].Attributes & ATTRFLAG_PALLETE_MASK) + 4;
 
-        if (pixel != 0)
+          if (pixel != 0)
+          {
+            // Non-transparent pixel
+            spPixel = pixel;
+            spPalette = palette;
+            // TODO: Attributes
+            bgPriority = (ppu->ActiveSpriteData[i].Attributes & ATTRFLAG_PRIORITY) > 0;
+            isSpriteZero = i == 0;
+            break;
+          }
+        }
+      }
+    }
+
+    // Find when we should display sprite instead of background
+    // I'm reusing the bgXXX variables for the final pixel and palette
+    if (bgPixel == 0 && spPixel != 0)
+    {
+      bgPixel = spPixel;
+      bgPalette = spPalette;
+    }
+    else if (bgPixel != 0 && spPixel != 0)
+    {
+      if (isSpriteZero && CR8_IsBitSet(ppu->Mask, MASKFLAG_BACKGROUND))
+      {
+        // Sprite zero hit wooo
+        // TODO: Partially hidden logic
+        if (ppu->HCount != 255 && ppu->HCount >= 2 && ppu->HCount <= 257)
         {
-          // Non-transparent pixel
-          spPixel = pixel;
-          spPalette = palette;
-          // TODO: Attributes
-          bgPriority = (ppu->ActiveSpriteData[i].Attributes & ATTRFLAG_PRIORITY) > 0;
-          isSpriteZero = i == 0;
-          break;
+          CR8_SetBits(&ppu->Status, STATFLAG_SPRITE_0_HIT);
         }
       }
+
+      if (!bgPriority)
+      {
+        bgPixel = spPixel;
+        bgPalette = spPalette;
+      }
     }
   }
-
-  // Find when we should display sprite instead of background
-  // I'm reusing the bgXXX variables for the final pixel and palette
-  if (bgPixel == 0 && spPixel != 0)
+  else if (CR8_IsBitSet(ppu->Mask, MASKFLAG_BACKGROUND) && CR8_IsBitSet(ppu->Mask, MASKFLAG_SPRITES)
+           && ppu->HCount >= minBackgroundX && ppu->HCount >= minSpriteX)
   {
-    bgPixel = spPixel;
-    bgPalette = spPalette;
+    // No pixels are composed here, but sprite zero hit is visible to the CPU so check
+    // only that: sprite 0 is always the first candidate so it is hit iff both pixels are opaque
+    const SpriteData_t *spriteZero = &ppu->ActiveSpriteData[0];
+    u16_t pixelBit = (0x8000 >> ppu->X);
+
+    if (spriteZero->X == 0
+        && ((spriteZero->SRPatternLow | spriteZero->SRPatternHigh) & 0x80)
+        && ((ppu->SRPatternLow | ppu->SRPatternHigh) & pixelBit)
+        && ppu->HCount != 255 && ppu->HCount >= 2 && ppu->HCount <= 257)
+    {
+      CR8_SetBits(&ppu->Status, STATFLAG_SPRITE_0_HIT);
+    }
   }
-  else if (bgPixel != 0 && spPixel != 0)
+
+  if (isDeferring)
   {
-    if (isSpriteZero && CR8_IsBitSet(ppu->Mask, MASKFLAG_BACKGROUND))
+    if (isVisibleScanline && ppu->HCount < PPU_VISIBLE_WIDTH)
     {
-      // Sprite zero hit wooo
-      // TODO: Partially hidden logic
-      if (ppu->HCount != 255 && ppu->HCount >= 2 && ppu->HCount <= 257)
-      {
-        CR8_SetBits(&ppu->Status, STATFLAG_SPRITE_0_HIT);
-      }
+      LogDeferredDot(ppu, minBackgroundX);
     }
-
-    if (!bgPriority)
+    else if (ppu->VCount == PPU_VISIBLE_HEIGHT && ppu->HCount == 0)
     {
-      bgPixel = spPixel;
-      bgPalette = spPalette;
+      // The frame has to be complete before anyone looks at the render surface
+      PPURenderer_Flush();
     }
   }
 
@@ -555,15 +667,22 @@ void PPU_Tick(PPU_t *ppu)
       // Set VBLANK flag here
       CR8_SetBits(&ppu->Status, STATFLAG_VBLANK);
     }
+
+    // The visible scanlines of a frame are traced as one batch, this stays inside
+    // the frame so it nests in the events of the emulation thread
+    if (ppu->VCount == 0)
+    {
+      Trace_Begin("visible lines");
+    }
+    else if (ppu->VCount == PPU_VISIBLE_HEIGHT)
+    {
+      Trace_End("visible lines");
+    }
   }
 
   // NMI line is enabled iff it's enabled in CTRL and STATUS has VBLANK active
   Bus_NMI(ppu->Bus, CR8_IsBitSet(ppu->Ctrl, CTRLFLAG_VBLANK_NMI) && CR8_IsBitSet(ppu->Status, STATFLAG_VBLANK));
 
-  SharedSDL_EndTiming(PERF_INDEX_PPU_ORDERING);
-
-  SharedSDL_BeginTiming(PERF_INDEX_PPU_INCREMENTS);
-
   // Address increment things
   if ((isPreRenderScanline || isVisibleScanline))
   {
@@ -628,14 +747,11 @@ void PPU_Tick(PPU_t *ppu)
     }
   }
 
-  SharedSDL_EndTiming(PERF_INDEX_PPU_INCREMENTS);
-
-  SharedSDL_BeginTiming(PERF_INDEX_PPU_PIXEL_OUT);
-
   // Render the pixel to the screen
-  PPU_RenderPixel(ppu, ppu->HCount, ppu->VCount, bgPixel, bgPalette);
-
-  SharedSDL_EndTiming(PERF_INDEX_PPU_PIXEL_OUT);
+  if (isComposing)
+  {
+    PPU_RenderPixel(ppu, ppu->HCount, ppu->VCount, bgPixel, bgPalette);
+  }
 
   // Calculate next scanline position
   ppu->HCount++;
@@ -652,10 +768,13 @@ void PPU_Tick(PPU_t *ppu)
       ppu->VCount = 0;
       ppu->IsEvenFrame = !ppu->IsEvenFrame;
       ppu->FrameCount++;
+      // Output skipping and deferring only change on frame boundaries
+      ppu->IsSkippingOutput = ppu->SkipOutput;
+      ppu->IsDeferringRendering = ppu->DeferRendering;
     }
   }
 
-  SharedSDL_EndTiming(PERF_INDEX_PPU);
+  Profiler_End(PROFILER_SECTION_PPU);
 }
 
 u8_t PPU_ReadFromCpu(PPU_t *ppu, u16_t address)
@@ -703,6 +822,7 @@ u8_t PPU_ReadFromCpu(PPU_t *ppu, u16_t address)
     // returned immediately
     // TODO: Clock?
     result = ppu->DataBuffer;
+    Debugger_OnPpuAccess(ppu->V, DEBUGGER_ACCESS_READ);
     // DataBuffer only gets updated by reading this register
     ppu->DataBuffer = Bus_ReadFromPPU(ppu->Bus, ppu->V);
     // Check if we are reading palette memory and update result accordingly
@@ -819,7 +939,12 @@ void PPU_WriteFromCpu(PPU_t *ppu, u16_t address, u8_t data)
       //LogMessage("Writing to PPU memory at line %d, 0x%04X (0x%04X) = 0x%02X", ppu->VCount, ppu->V, ppu->V & 0x3FFF, data);
     }
     // TODO: Clock clock clock?
+    Debugger_OnPpuAccess(ppu->V, DEBUGGER_ACCESS_WRITE);
     Bus_WriteFromPPU(ppu->Bus, ppu->V, data);
+    if ((ppu->V & 0x3FFF) >= 0x3F00)
+    {
+      LogDeferredPaletteWrite(ppu, ppu->V & 0x3FFF);
+    }
     ppu->V += CR8_IsBitSet(ppu->Ctrl, CTRLFLAG_VRAM_INCREMENT) ? 32 : 1;
     break;
   default:
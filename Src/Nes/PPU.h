@@ -14,6 +14,11 @@
 
 #define PPU_NUM_SCANLINES         (262)
 #define PPU_PRE_RENDER_SCANLINE   (PPU_NUM_SCANLINES - 1)
+#define PPU_VISIBLE_WIDTH         (256)
+#define PPU_VISIBLE_HEIGHT        (240)
+
+#define PPU_LINE_LOG_MAX_MASK_CHANGES   (16)
+#define PPU_LINE_LOG_MAX_PALETTE_CHANGES  (32)
 
 typedef struct _Bus_t Bus_t;
 
@@ -35,6 +40,36 @@ typedef struct
   u8_t Attributes;
 } SpriteData_t;
 
+typedef struct
+{
+  u16_t Dot;             // First dot the new mask applies to
+  u8_t Mask;
+} MaskChange_t;
+
+typedef struct
+{
+  u16_t Dot;             // First dot the new color applies to
+  u8_t Index;            // Palette RAM entry, 0 - 31
+  u8_t Value;
+} PaletteChange_t;
+
+// Everything needed to compose the pixels of one scanline away from the PPU.
+// The background fetches are mapper visible so they stay with the PPU, their
+// result is logged per dot instead of V, T and X.
+typedef struct
+{
+  SDL_Surface *Surface;                 // Surface to draw the line on
+  u16_t Y;                              // Scanline
+  u8_t Mask;                            // Mask at the start of the line
+  u8_t NumMaskChanges;
+  MaskChange_t MaskChanges[PPU_LINE_LOG_MAX_MASK_CHANGES];   // Mid-line writes, in dot order
+  u8_t Palette[32];                     // Palette RAM at the start of the line
+  u8_t NumPaletteChanges;
+  PaletteChange_t PaletteChanges[PPU_LINE_LOG_MAX_PALETTE_CHANGES];  // Mid-line writes, in dot order
+  SpriteData_t Sprites[8];              // Sprite shifters at the start of the line
+  u8_t Background[PPU_VISIBLE_WIDTH];   // Background pixel (bits 0-1) and palette (bits 2-3) per dot
+} PPU_LineLog_t;
+
 typedef enum
 {
   SPRITE_EVAL_STATE_NEW_SPRITE,
@@ -70,6 +105,12 @@ typedef struct _PPU_t
   u16f_t VCount;     // Scanline
   u16f_t HCount;     // Dot (or pixel) horizontally on the scanline, starts at 0
   bool IsEvenFrame;         // Toggle indicating if we are on an odd or even frame
+  bool SkipOutput;          // Requested output skipping, applied from the next frame onwards
+  bool IsSkippingOutput;    // No pixels are composed or output this frame, only CPU visible effects
+  bool DeferRendering;      // Requested deferred rendering, applied from the next frame onwards
+  bool IsDeferringRendering;  // Pixels of this frame are composed by the renderer thread
+  bool IsA12High;           // Level of address line A12 on the last rendering fetch
+  unsigned int A12LowCycle; // Cycle count when A12 last went low
 
   // VRAM Address Registers
   // V and T have the same internal structure
@@ -106,6 +147,8 @@ typedef struct _PPU_t
   u8_t SpriteEval_SpriteByteIndex;
   u8_t SpriteEval_TempSpriteData;
   SpriteEvalState_t SpriteEval_State;
+
+  PPU_LineLog_t LineLog;    // Scanline being logged for the renderer thread
 } PPU_t;
 
 void PPU_Initialize(PPU_t *ppu);
@@ -114,6 +157,8 @@ void PPU_ClockRegisters(PPU_t *ppu);
 void PPU_Reset(PPU_t *ppu);
 u8_t PPU_ReadFromCpu(PPU_t *ppu, u16_t address);
 void PPU_WriteFromCpu(PPU_t *ppu, u16_t address, u8_t data);
+void PPU_SetSkipOutput(PPU_t *ppu, bool skip);
+void PPU_SetDeferredRendering(PPU_t *ppu, bool defer);
 void PPU_SetRenderSurface(SDL_Surface *surface);
 void PPU_RenderPixel(const PPU_t *ppu, u16f_t x, u16f_t y, u8_t pixel, u8_t palette);
 #endif /* SRC_NES_PPU_H_ */
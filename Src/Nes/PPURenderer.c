@@ -0,0 +1,264 @@
+/*
+ * PPURenderer.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "PPURenderer.h"
+#include "PPU_Internal.h"
+#include "Palette.h"
+#include "SpscQueue.h"
+#include "Trace.h"
+#include "log.h"
+#include <string.h>
+#include <SDL2/SDL.h>
+
+// A bit over one frame, the emulation flushes the renderer at the end of every frame
+#define LINE_QUEUE_CAPACITY   (256)
+
+static SpscQueue_t _lineQueue;
+static SDL_sem *_linesAvailable;
+static SDL_sem *_linesRendered;
+static SDL_Thread *_thread;
+static SDL_atomic_t _isStopping;
+static unsigned int _linesPending;      // Only used by the emulation thread
+
+static u32_t _colors[64];               // Palette colors mapped to _colorsFormat
+static Uint32 _colorsFormat = SDL_PIXELFORMAT_UNKNOWN;
+
+static void UpdateColors(const SDL_PixelFormat *format)
+{
+  for (u8f_t i = 0; i < 64; i++)
+  {
+    u8_t r;
+    u8_t g;
+    u8_t b;
+    Palette_GetRGB(i, &r, &g, &b);
+    _colors[i] = SDL_MapRGB(format, r, g, b);
+  }
+  _colorsFormat = format->format;
+}
+
+static void RenderLine(const PPU_LineLog_t *line)
+{
+  SDL_Surface *surface = line->Surface;
+  if (surface == NULL || line->Y >= surface->h)
+  {
+    return;
+  }
+
+  if (surface->format->format != _colorsFormat)
+  {
+    UpdateColors(surface->format);
+  }
+
+  SpriteData_t sprites[8];
+  memcpy(sprites, line->Sprites, sizeof(sprites));
+
+  u8_t palette[32];
+  memcpy(palette, line->Palette, sizeof(palette));
+
+  u8_t mask = line->Mask;
+  u8f_t nextMaskChange = 0;
+  u8f_t nextPaletteChange = 0;
+  u16f_t width = surface->w < PPU_VISIBLE_WIDTH ? surface->w : PPU_VISIBLE_WIDTH;
+  u32_t *pixels = (u32_t *)((u8_t *)surface->pixels + surface->pitch * line->Y);
+
+  for (u16f_t x = 0; x < PPU_VISIBLE_WIDTH; x++)
+  {
+    if (nextMaskChange < line->NumMaskChanges && line->MaskChanges[nextMaskChange].Dot == x)
+    {
+      mask = line->MaskChanges[nextMaskChange].Mask;
+      nextMaskChange++;
+    }
+    while (nextPaletteChange < line->NumPaletteChanges && line->PaletteChanges[nextPaletteChange].Dot == x)
+    {
+      // Entry 0 of every palette is shared by background and sprites
+      const PaletteChange_t *change = &line->PaletteChanges[nextPaletteChange];
+      palette[change->Index] = change->Value;
+      if ((change->Index & 0x03) == 0)
+      {
+        palette[change->Index ^ 0x10] = change->Value;
+      }
+      nextPaletteChange++;
+    }
+
+    u8_t pixel = line->Background[x] & 0x03;
+    u8_t attribute = line->Background[x] >> 2;
+    bool areSpritesEnabled = (mask & MASKFLAG_SPRITES) != 0;
+    u16f_t minSpriteX = (mask & MASKFLAG_SPRITES_LEFT) ? 0 : 8;
+
+    if (areSpritesEnabled && x >= minSpriteX)
+    {
+      // The first opaque sprite pixel is the only candidate, same as on the PPU
+      for (u8f_t i = 0; i < 8; i++)
+      {
+        if (sprites[i].X == 0)
+        {
+          u8f_t spPixel = ((sprites[i].SRPatternLow & 0x80) > 0) |
+              (((sprites[i].SRPatternHigh & 0x80) > 0) << 1);
+
+          if (spPixel != 0)
+          {
+            if (pixel == 0 || !(sprites[i].Attributes & ATTRFLAG_PRIORITY))
+            {
+              pixel = spPixel;
+              attribute = (sprites[i].Attributes & ATTRFLAG_PALLETE_MASK) + 4;
+            }
+            break;
+          }
+        }
+      }
+    }
+
+    if (x < width)
+    {
+      // Palette entry 0 always maps to the universal background of palette 0
+      u8_t colorPaletteIndex = palette[pixel == 0 ? 0 : (attribute << 2) + pixel];
+      if (mask & MASKFLAG_GREYSCALE)
+      {
+        colorPaletteIndex &= 0x30;
+      }
+      pixels[x] = _colors[colorPaletteIndex & 0x3F];
+    }
+
+    // Sprite shifters move exactly like they do on the PPU
+    if (x >= 2 && areSpritesEnabled)
+    {
+      for (u8f_t i = 0; i < 8; i++)
+      {
+        if (sprites[i].X > 0)
+        {
+          sprites[i].X--;
+        }
+        else
+        {
+          sprites[i].SRPatternHigh <<= 1;
+          sprites[i].SRPatternLow <<= 1;
+        }
+      }
+    }
+  }
+}
+
+static int RendererThread(void *data)
+{
+  PPU_LineLog_t line;
+
+  Trace_NameThread("Renderer");
+  for (;;)
+  {
+    SDL_SemWait(_linesAvailable);
+
+    if (!SpscQueue_Pop(&_lineQueue, &line))
+    {
+      // Only woken up without a line when we have to stop
+      if (SDL_AtomicGet(&_isStopping))
+      {
+        break;
+      }
+      continue;
+    }
+
+    // Everything that is queued already is one batch
+    Trace_Begin("render lines");
+    do
+    {
+      RenderLine(&line);
+      SDL_SemPost(_linesRendered);
+    } while (SpscQueue_Pop(&_lineQueue, &line));
+    Trace_End("render lines");
+  }
+
+  return 0;
+}
+
+bool PPURenderer_Start(void)
+{
+  if (_thread != NULL)
+  {
+    return true;
+  }
+
+  if (!SpscQueue_Initialize(&_lineQueue, sizeof(PPU_LineLog_t), LINE_QUEUE_CAPACITY))
+  {
+    LogError("Unable to allocate the scanline queue");
+    goto return_on_error;
+  }
+
+  _linesAvailable = SDL_CreateSemaphore(0);
+  _linesRendered = SDL_CreateSemaphore(0);
+  if (_linesAvailable == NULL || _linesRendered == NULL)
+  {
+    LogError("SDL_CreateSemaphore failed: %s", SDL_GetError());
+    goto destroy_semaphores_on_error;
+  }
+
+  SDL_AtomicSet(&_isStopping, 0);
+  _linesPending = 0;
+  _thread = SDL_CreateThread(RendererThread, "PPU Renderer", NULL);
+  if (_thread == NULL)
+  {
+    LogError("SDL_CreateThread failed: %s", SDL_GetError());
+    goto destroy_semaphores_on_error;
+  }
+
+  return true;
+
+destroy_semaphores_on_error:
+  if (_linesAvailable != NULL)
+  {
+    SDL_DestroySemaphore(_linesAvailable);
+    _linesAvailable = NULL;
+  }
+  if (_linesRendered != NULL)
+  {
+    SDL_DestroySemaphore(_linesRendered);
+    _linesRendered = NULL;
+  }
+  SpscQueue_Destroy(&_lineQueue);
+return_on_error:
+  return false;
+}
+
+void PPURenderer_Stop(void)
+{
+  if (_thread == NULL)
+  {
+    return;
+  }
+
+  PPURenderer_Flush();
+  SDL_AtomicSet(&_isStopping, 1);
+  SDL_SemPost(_linesAvailable);
+  SDL_WaitThread(_thread, NULL);
+  _thread = NULL;
+
+  SDL_DestroySemaphore(_linesAvailable);
+  SDL_DestroySemaphore(_linesRendered);
+  _linesAvailable = NULL;
+  _linesRendered = NULL;
+  SpscQueue_Destroy(&_lineQueue);
+}
+
+void PPURenderer_SubmitLine(const PPU_LineLog_t *line)
+{
+  while (!SpscQueue_Push(&_lineQueue, line))
+  {
+    // Only when the renderer is more than a frame behind, wait until it rendered a line
+    SDL_SemWait(_linesRendered);
+    _linesPending--;
+  }
+  SDL_SemPost(_linesAvailable);
+  _linesPending++;
+}
+
+void PPURenderer_Flush(void)
+{
+  while (_linesPending > 0)
+  {
+    SDL_SemWait(_linesRendered);
+    _linesPending--;
+  }
+}
@@ -0,0 +1,23 @@
+/*
+ * PPURenderer.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_NES_PPURENDERER_H_
+#define SRC_NES_PPURENDERER_H_
+
+#include "PPU.h"
+
+// Composes the pixels of logged scanlines on a thread of its own. Lines are
+// submitted by the emulation thread in order and only drawn on the surface they
+// carry, the renderer doesn't touch the bus or the PPU. Everything except the
+// renderer thread itself must be called from the emulation thread.
+
+bool PPURenderer_Start(void);
+void PPURenderer_Stop(void);
+void PPURenderer_SubmitLine(const PPU_LineLog_t *line);
+void PPURenderer_Flush(void);
+
+#endif /* SRC_NES_PPURENDERER_H_ */
@@ -0,0 +1,39 @@
+/*
+ * PPU_Internal.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_NES_PPU_INTERNAL_H_
+#define SRC_NES_PPU_INTERNAL_H_
+
+#define CTRLFLAG_NAMETABLE_MASK       0x03
+#define CTRLFLAG_VRAM_INCREMENT       0x04
+#define CTRLFLAG_SPRITE_ADDRESS       0x08
+#define CTRLFLAG_BACKGROUND_ADDRESS   0x10
+#define CTRLFLAG_SPRITE_SIZE          0x20
+#define CTRLFLAG_MASTER_SELECT        0x40
+#define CTRLFLAG_VBLANK_NMI           0x80
+
+#define MASKFLAG_GREYSCALE            0x01
+#define MASKFLAG_BACKGROUND_LEFT      0x02
+#define MASKFLAG_SPRITES_LEFT         0x04
+#define MASKFLAG_BACKGROUND           0x08
+#define MASKFLAG_SPRITES              0x10
+#define MASKFLAG_EMPHASIZE_RED        0x20
+#define MASKFLAG_EMPHASIZE_GREEN      0x40
+#define MASKFLAG_EMPHASIZE_BLUE       0x80
+
+#define STATFLAG_GARBAGE_MASK         0x1F
+#define STATFLAG_SPRITE_OVERFLOW      0x20
+#define STATFLAG_SPRITE_0_HIT         0x40
+#define STATFLAG_VBLANK               0x80
+
+#define ATTRFLAG_PALLETE_MASK         0x03
+#define ATTRFLAG_NOTHING_MASK         0x1C      // TODO: This needs to apply to OAM reads and writes as well
+#define ATTRFLAG_PRIORITY             0x20
+#define ATTRFLAG_FLIP_HORIZONTAL      0x40
+#define ATTRFLAG_FLIP_VERTICAL        0x80
+
+#endif /* SRC_NES_PPU_INTERNAL_H_ */
@@ -0,0 +1,107 @@
+/*
+ * RomDatabase.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "RomDatabase.h"
+#include "log.h"
+#include <string.h>
+
+// Sorted by CRC32 for the binary search, keep it that way when adding entries
+static const RomDatabaseEntry_t ENTRIES[] =
+{
+  { 0x02328D92, { 0xC0, 0x94, 0x63, 0x8C, 0x33, 0x47, 0x01, 0x46, 0x0E, 0x81,
+                  0x53, 0xFE, 0xAF, 0x36, 0x7A, 0x30, 0x18, 0xBF, 0x45, 0xD4 },
+    1, 0, MIRROR_MODE_VERTICAL, false, INES_TIMING_NTSC, "all_instrs" },
+  { 0x0E16C971, { 0x8B, 0xE2, 0xA5, 0x7A, 0x92, 0x6D, 0xD9, 0xD7, 0x12, 0x3F,
+                  0x49, 0x53, 0xEB, 0xBB, 0x70, 0xEF, 0xE2, 0xE2, 0xD3, 0x22 },
+    0, 0, MIRROR_MODE_HORIZONTAL, false, INES_TIMING_NTSC, "ntsc_torture" },
+  { 0x102F7E63, { 0x05, 0xFC, 0x6B, 0x97, 0xC9, 0x80, 0x1D, 0x9D, 0x07, 0x35,
+                  0x97, 0x66, 0xF6, 0x38, 0x9D, 0x60, 0x00, 0x35, 0x68, 0x59 },
+    0, 0, MIRROR_MODE_HORIZONTAL, false, INES_TIMING_NTSC, "sprite_ram" },
+  { 0x158B0388, { 0x41, 0x31, 0x30, 0x7F, 0x0F, 0x69, 0xF2, 0xA5, 0xC5, 0x4B,
+                  0x7D, 0x43, 0x83, 0x28, 0xC5, 0xB2, 0xA5, 0xED, 0x08, 0x20 },
+    0, 0, MIRROR_MODE_HORIZONTAL, false, INES_TIMING_NTSC, "nestest" },
+  { 0x26EA03E8, { 0x17, 0xB7, 0x95, 0x7E, 0xE7, 0x68, 0x64, 0x75, 0xD0, 0x37,
+                  0x70, 0x9A, 0x9A, 0xA9, 0xE5, 0x24, 0xDC, 0x0B, 0x5E, 0x03 },
+    0, 0, MIRROR_MODE_HORIZONTAL, false, INES_TIMING_NTSC, "vram_access" },
+  { 0x5CDF99DF, { 0x2C, 0x8F, 0x6F, 0x41, 0x22, 0xCA, 0x0E, 0x5E, 0xEA, 0xCD,
+                  0xD4, 0x5D, 0x20, 0xB8, 0x94, 0x88, 0x51, 0x8A, 0x4D, 0xAB },
+    1, 0, MIRROR_MODE_VERTICAL, false, INES_TIMING_NTSC, "instr_timing" },
+  { 0x5CE951EA, { 0x7A, 0x4F, 0xA7, 0xBE, 0xCB, 0x8A, 0x2B, 0x76, 0x46, 0x0C,
+                  0x77, 0xFA, 0x27, 0x2F, 0x32, 0xD5, 0x42, 0x83, 0x04, 0x06 },
+    0, 0, MIRROR_MODE_HORIZONTAL, false, INES_TIMING_NTSC, "demo_ntsc" },
+  { 0x95BF214E, { 0xE4, 0x0C, 0xFC, 0xF3, 0x7A, 0x01, 0x33, 0xD3, 0x51, 0x65,
+                  0xDE, 0xFE, 0xB1, 0xB6, 0xB5, 0x2F, 0x1F, 0xE3, 0x07, 0xD2 },
+    0, 0, MIRROR_MODE_HORIZONTAL, false, INES_TIMING_NTSC, "palette_ram" },
+  { 0xA7013B44, { 0xFC, 0xFE, 0x51, 0xD8, 0x91, 0xF8, 0x95, 0x39, 0x28, 0x72,
+                  0x26, 0x6E, 0xF3, 0x4C, 0xD2, 0x63, 0xA6, 0xEB, 0xA7, 0x61 },
+    1, 0, MIRROR_MODE_VERTICAL, false, INES_TIMING_NTSC, "apu_test" },
+  { 0xAA597C9A, { 0xC6, 0xBA, 0x32, 0xF6, 0x73, 0x25, 0x4B, 0xA5, 0x2E, 0x0B,
+                  0x6D, 0x14, 0x2A, 0x46, 0x31, 0x0B, 0x4B, 0xA8, 0x65, 0x2A },
+    1, 0, MIRROR_MODE_VERTICAL, false, INES_TIMING_NTSC, "cpu_interrupts" },
+  { 0xABF707DA, { 0x97, 0xB7, 0x3A, 0x73, 0x32, 0xB6, 0x5E, 0x8A, 0xBD, 0x3D,
+                  0xAA, 0x73, 0xBE, 0x78, 0x20, 0xD2, 0xC3, 0xF5, 0x1C, 0xFF },
+    0, 0, MIRROR_MODE_VERTICAL, false, INES_TIMING_NTSC, "oam_stress" },
+  { 0xB004FD2E, { 0xF9, 0xB1, 0x81, 0x6E, 0x6C, 0x09, 0x6A, 0xFE, 0xC2, 0x92,
+                  0x4F, 0xBE, 0xD5, 0x7D, 0xED, 0x95, 0x6A, 0x4F, 0xB4, 0x37 },
+    1, 0, MIRROR_MODE_VERTICAL, false, INES_TIMING_NTSC, "ppu_sprite_hit" },
+  { 0xD6C34773, { 0x25, 0xA3, 0x75, 0x29, 0x8E, 0x87, 0x85, 0xCF, 0x4C, 0xA6,
+                  0xFC, 0xA4, 0x03, 0xA9, 0x75, 0xA3, 0x19, 0xC7, 0x39, 0xD0 },
+    0, 0, MIRROR_MODE_HORIZONTAL, false, INES_TIMING_NTSC, "vbl_clear_time" },
+  { 0xDA59B973, { 0x20, 0x3A, 0x39, 0xBD, 0xD9, 0xD7, 0x27, 0x15, 0x84, 0xE0,
+                  0x95, 0x43, 0x8D, 0xC5, 0x17, 0x17, 0xCD, 0x71, 0x7C, 0x37 },
+    1, 0, MIRROR_MODE_VERTICAL, false, INES_TIMING_NTSC, "official_only" },
+  { 0xDD941E82, { 0xFD, 0xA5, 0xC8, 0x24, 0x8E, 0x43, 0xE7, 0x7A, 0x73, 0x31,
+                  0x4F, 0x23, 0xC7, 0xA5, 0x03, 0x36, 0x51, 0x36, 0x11, 0x4E },
+    0, 0, MIRROR_MODE_HORIZONTAL, false, INES_TIMING_NTSC, "power_up_palette" },
+  { 0xEEA20263, { 0x78, 0xFD, 0xDA, 0xE9, 0x00, 0x61, 0x93, 0x61, 0x7F, 0x10,
+                  0x54, 0xFD, 0x00, 0x7D, 0x01, 0x85, 0xE4, 0xE2, 0x25, 0x44 },
+    1, 0, MIRROR_MODE_VERTICAL, false, INES_TIMING_NTSC, "ppu_vbl_nmi" },
+};
+
+#define NUM_ENTRIES   (sizeof(ENTRIES) / sizeof(ENTRIES[0]))
+
+const RomDatabaseEntry_t* RomDatabase_Find(u32_t crc32, const u8_t sha1[SHA1_DIGEST_SIZE])
+{
+  // Find the first entry with this CRC
+  size_t low = 0;
+  size_t high = NUM_ENTRIES;
+  while (low < high)
+  {
+    size_t middle = low + (high - low) / 2;
+    if (ENTRIES[middle].Crc32 < crc32)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  // CRCs can collide, the SHA-1 decides
+  for (size_t i = low; i < NUM_ENTRIES && ENTRIES[i].Crc32 == crc32; i++)
+  {
+    if (memcmp(ENTRIES[i].Sha1, sha1, SHA1_DIGEST_SIZE) == 0)
+    {
+      return &ENTRIES[i];
+    }
+  }
+  return NULL;
+}
+
+void RomDatabase_Apply(const RomDatabaseEntry_t *entry, INesRomInfo_t *info)
+{
+  if (info->MapperId != entry->MapperId || info->Submapper != entry->Submapper)
+  {
+    LogMessage("Header says mapper %u.%u, using %u.%u", info->MapperId, info->Submapper, entry->MapperId, entry->Submapper);
+  }
+  info->MapperId = entry->MapperId;
+  info->Submapper = entry->Submapper;
+  info->Mirror = entry->Mirror;
+  info->HasBattery = entry->HasBattery;
+  info->Timing = entry->Timing;
+}
@@ -0,0 +1,35 @@
+/*
+ * RomDatabase.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_NES_ROMDATABASE_H_
+#define SRC_NES_ROMDATABASE_H_
+
+#include "Types.h"
+#include "INesLoader.h"
+#include "Sha1.h"
+
+// Known ROMs identified by the hashes of their PRG and CHR ROM (header and
+// trainer excluded), with the header values they really need.
+typedef struct
+{
+  u32_t Crc32;
+  u8_t Sha1[SHA1_DIGEST_SIZE];
+  u16_t MapperId;
+  u8_t Submapper;
+  MirrorMode_t Mirror;
+  bool HasBattery;
+  INesTiming_t Timing;
+  const char *Name;
+} RomDatabaseEntry_t;
+
+// Returns the entry matching both hashes, NULL if the ROM isn't known
+const RomDatabaseEntry_t* RomDatabase_Find(u32_t crc32, const u8_t sha1[SHA1_DIGEST_SIZE]);
+
+// Overrides the header values in info with the ones from the database
+void RomDatabase_Apply(const RomDatabaseEntry_t *entry, INesRomInfo_t *info);
+
+#endif /* SRC_NES_ROMDATABASE_H_ */
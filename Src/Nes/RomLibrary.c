@@ -0,0 +1,402 @@
+/*
+ * RomLibrary.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "RomLibrary.h"
+#include "INesLoader.h"
+#include "RomDatabase.h"
+#include "Crc32.h"
+#include "log.h"
+#include <SDL2/SDL.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define MAX_THREADS     (64)
+
+typedef struct
+{
+  char *Path;             // Relative to the library directory
+  uint64_t Size;
+  int64_t ModifiedTime;
+} ScanFile_t;
+
+typedef struct
+{
+  const char *Directory;
+  ScanFile_t *Files;
+  u32_t NumFiles;
+  u32_t FilesCapacity;
+  RomLibraryEntry_t *Entries;       // One per file, filled in by the threads
+  const RomLibrary_t *Previous;     // Index of the last scan, NULL if there is none
+  SDL_atomic_t NextFile;            // Next file for a thread to pick up
+  SDL_atomic_t NumRead;             // Files that had to be read
+} Scan_t;
+
+static bool IsRomFile(const char *name)
+{
+  const char *extension = strrchr(name, '.');
+  return extension != NULL && tolower(extension[1]) == 'n' && tolower(extension[2]) == 'e' &&
+         tolower(extension[3]) == 's' && extension[4] == '\0';
+}
+
+static bool AddFile(Scan_t *scan, const char *path, const struct stat *status)
+{
+  if (scan->NumFiles == scan->FilesCapacity)
+  {
+    u32_t capacity = scan->FilesCapacity == 0 ? 256 : scan->FilesCapacity * 2;
+    ScanFile_t *files = realloc(scan->Files, capacity * sizeof(ScanFile_t));
+    if (files == NULL)
+    {
+      return false;
+    }
+    scan->Files = files;
+    scan->FilesCapacity = capacity;
+  }
+
+  ScanFile_t *file = &scan->Files[scan->NumFiles];
+  file->Path = malloc(strlen(path) + 1);
+  if (file->Path == NULL)
+  {
+    return false;
+  }
+  strcpy(file->Path, path);
+  file->Size = (uint64_t) status->st_size;
+  file->ModifiedTime = (int64_t) status->st_mtime;
+  scan->NumFiles++;
+  return true;
+}
+
+// Joins a directory and a name into path, false when it doesn't fit
+static bool JoinPath(char *path, size_t size, const char *directory, const char *name)
+{
+  int length = snprintf(path, size, "%s%s%s", directory, directory[0] != '\0' ? "/" : "", name);
+  if (length < 0 || (size_t) length >= size)
+  {
+    LogWarning("Skipping %s/%s, the path is longer than %zu characters", directory, name, size - 1);
+    return false;
+  }
+  return true;
+}
+
+// Collects the .nes files in a directory and its subdirectories
+static bool AddDirectory(Scan_t *scan, const char *relativePath)
+{
+  char path[1024];
+  if (!JoinPath(path, sizeof(path), scan->Directory, relativePath))
+  {
+    return false;
+  }
+
+  DIR *directory = opendir(path);
+  if (directory == NULL)
+  {
+    LogError("Unable to open directory %s", path);
+    return false;
+  }
+
+  bool isOk = true;
+  struct dirent *item;
+  while (isOk && (item = readdir(directory)) != NULL)
+  {
+    if (item->d_name[0] == '.')
+    {
+      continue;
+    }
+
+    char itemPath[1024];
+    struct stat status;
+    if (!JoinPath(itemPath, sizeof(itemPath), relativePath, item->d_name) ||
+        !JoinPath(path, sizeof(path), scan->Directory, itemPath) ||
+        stat(path, &status) != 0)
+    {
+      continue;
+    }
+
+    if (S_ISDIR(status.st_mode))
+    {
+      isOk = AddDirectory(scan, itemPath);
+    }
+    else if (S_ISREG(status.st_mode) && IsRomFile(item->d_name))
+    {
+      isOk = AddFile(scan, itemPath, &status);
+    }
+  }
+
+  closedir(directory);
+  return isOk;
+}
+
+static int CompareFiles(const void *a, const void *b)
+{
+  return strcmp(((const ScanFile_t*) a)->Path, ((const ScanFile_t*) b)->Path);
+}
+
+static void IndexFile(const Scan_t *scan, const ScanFile_t *file, RomLibraryEntry_t *entry)
+{
+  char path[1024];
+  MappedFile_t rom;
+  INesRomInfo_t info;
+
+  if (!JoinPath(path, sizeof(path), scan->Directory, file->Path) || !MappedFile_OpenReadOnly(&rom, path))
+  {
+    return;
+  }
+
+  if (INesLoader_ParseHeader(rom.Data, rom.Size, &info))
+  {
+    const u8_t *data = rom.Data + info.RomOffset;
+    size_t size = info.PrgRomSize + info.ChrRomSize;
+    entry->Crc32 = Crc32_Update(0, data, size);
+    Sha1_Calculate(data, size, entry->Sha1);
+
+    const RomDatabaseEntry_t *known = RomDatabase_Find(entry->Crc32, entry->Sha1);
+    if (known != NULL)
+    {
+      RomDatabase_Apply(known, &info);
+      entry->Flags |= ROM_LIBRARY_FLAG_KNOWN;
+    }
+
+    entry->MapperId = info.MapperId;
+    entry->Submapper = info.Submapper;
+    entry->Timing = (u8_t) info.Timing;
+    entry->Flags |= ROM_LIBRARY_FLAG_VALID;
+    entry->Flags |= info.IsNes20 ? ROM_LIBRARY_FLAG_NES20 : 0;
+    entry->Flags |= info.HasBattery || info.PrgNvramSize > 0 ? ROM_LIBRARY_FLAG_BATTERY : 0;
+  }
+  else
+  {
+    LogError("File %s is not a valid iNES file", path);
+  }
+
+  MappedFile_Close(&rom);
+}
+
+static int ScanThread(void *data)
+{
+  Scan_t *scan = data;
+
+  for (;;)
+  {
+    u32_t index = (u32_t) SDL_AtomicAdd(&scan->NextFile, 1);
+    if (index >= scan->NumFiles)
+    {
+      return 0;
+    }
+
+    const ScanFile_t *file = &scan->Files[index];
+    RomLibraryEntry_t *entry = &scan->Entries[index];
+    const RomLibraryEntry_t *previous = scan->Previous != NULL ? RomLibrary_Find(scan->Previous, file->Path) : NULL;
+    if (previous != NULL && previous->Size == file->Size && previous->ModifiedTime == file->ModifiedTime)
+    {
+      *entry = *previous;
+      continue;
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    entry->Size = file->Size;
+    entry->ModifiedTime = file->ModifiedTime;
+    IndexFile(scan, file, entry);
+    SDL_AtomicAdd(&scan->NumRead, 1);
+  }
+}
+
+static bool WriteIndex(const Scan_t *scan, const char *indexFile)
+{
+  char tempFile[1024];
+  RomLibraryHeader_t header;
+
+  memcpy(header.Magic, ROM_LIBRARY_MAGIC, sizeof(header.Magic));
+  header.NumEntries = scan->NumFiles;
+  header.StringsSize = 0;
+  for (u32_t i = 0; i < scan->NumFiles; i++)
+  {
+    scan->Entries[i].PathOffset = header.StringsSize;
+    header.StringsSize += (u32_t) strlen(scan->Files[i].Path) + 1;
+  }
+
+  // Written next to the old index and renamed over it, readers never see half an index
+  int length = snprintf(tempFile, sizeof(tempFile), "%s.tmp", indexFile);
+  FILE *f = length > 0 && (size_t) length < sizeof(tempFile) ? fopen(tempFile, "wb") : NULL;
+  if (f == NULL)
+  {
+    LogError("Unable to open %s", tempFile);
+    return false;
+  }
+
+  bool isWritten = fwrite(&header, sizeof(header), 1, f) == 1 &&
+                   fwrite(scan->Entries, sizeof(RomLibraryEntry_t), scan->NumFiles, f) == scan->NumFiles;
+  for (u32_t i = 0; isWritten && i < scan->NumFiles; i++)
+  {
+    size_t length = strlen(scan->Files[i].Path) + 1;
+    isWritten = fwrite(scan->Files[i].Path, 1, length, f) == length;
+  }
+  if (fclose(f) != 0)
+  {
+    isWritten = false;
+  }
+
+  if (isWritten && rename(tempFile, indexFile) != 0)
+  {
+    // Windows doesn't replace existing files
+    remove(indexFile);
+    isWritten = rename(tempFile, indexFile) == 0;
+  }
+  if (!isWritten)
+  {
+    LogError("Unable to write %s", indexFile);
+    remove(tempFile);
+  }
+  return isWritten;
+}
+
+bool RomLibrary_Open(RomLibrary_t *library, const char *indexFile)
+{
+  memset(library, 0, sizeof(*library));
+  if (!MappedFile_OpenReadOnly(&library->File, indexFile))
+  {
+    return false;
+  }
+
+  const RomLibraryHeader_t *header = (const RomLibraryHeader_t*) library->File.Data;
+  size_t entriesSize = library->File.Size >= sizeof(*header) ? (size_t) header->NumEntries * sizeof(RomLibraryEntry_t) : 0;
+  if (library->File.Size < sizeof(*header) || memcmp(header->Magic, ROM_LIBRARY_MAGIC, sizeof(header->Magic)) != 0 ||
+      library->File.Size != sizeof(*header) + entriesSize + header->StringsSize ||
+      (header->StringsSize > 0 && library->File.Data[library->File.Size - 1] != '\0'))
+  {
+    LogError("%s is not a valid ROM library index", indexFile);
+    RomLibrary_Close(library);
+    return false;
+  }
+
+  library->Header = header;
+  library->Entries = (const RomLibraryEntry_t*) (library->File.Data + sizeof(*header));
+  library->Strings = (const char*) (library->File.Data + sizeof(*header) + entriesSize);
+  return true;
+}
+
+void RomLibrary_Close(RomLibrary_t *library)
+{
+  MappedFile_Close(&library->File);
+  memset(library, 0, sizeof(*library));
+}
+
+const char* RomLibrary_GetPath(const RomLibrary_t *library, const RomLibraryEntry_t *entry)
+{
+  return entry->PathOffset < library->Header->StringsSize ? &library->Strings[entry->PathOffset] : "";
+}
+
+const RomLibraryEntry_t* RomLibrary_Find(const RomLibrary_t *library, const char *path)
+{
+  u32_t low = 0;
+  u32_t high = library->Header->NumEntries;
+
+  while (low < high)
+  {
+    u32_t middle = low + (high - low) / 2;
+    int order = strcmp(RomLibrary_GetPath(library, &library->Entries[middle]), path);
+    if (order == 0)
+    {
+      return &library->Entries[middle];
+    }
+    else if (order < 0)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  return NULL;
+}
+
+bool RomLibrary_Scan(const char *directory, const char *indexFile, u32_t numThreads)
+{
+  Scan_t scan;
+  RomLibrary_t previous;
+  SDL_Thread *threads[MAX_THREADS];
+  u32_t startTicks = SDL_GetTicks();
+  bool isOk = false;
+
+  memset(&scan, 0, sizeof(scan));
+  scan.Directory = directory;
+  // A missing or broken index just means everything is read
+  FILE *existing = fopen(indexFile, "rb");
+  if (existing != NULL)
+  {
+    fclose(existing);
+    if (RomLibrary_Open(&previous, indexFile))
+    {
+      scan.Previous = &previous;
+    }
+  }
+
+  if (!AddDirectory(&scan, ""))
+  {
+    goto cleanup;
+  }
+  // Sorted paths make the index binary searchable
+  qsort(scan.Files, scan.NumFiles, sizeof(ScanFile_t), CompareFiles);
+
+  scan.Entries = calloc(scan.NumFiles > 0 ? scan.NumFiles : 1, sizeof(RomLibraryEntry_t));
+  if (scan.Entries == NULL)
+  {
+    LogError("Unable to allocate the ROM library index");
+    goto cleanup;
+  }
+
+  numThreads = numThreads < 1 ? 1 : numThreads > MAX_THREADS ? MAX_THREADS : numThreads;
+  u32_t numStarted = 0;
+  for (; numStarted < numThreads; numStarted++)
+  {
+    threads[numStarted] = SDL_CreateThread(ScanThread, "LibraryScan", &scan);
+    if (threads[numStarted] == NULL)
+    {
+      LogError("SDL_CreateThread failed: %s", SDL_GetError());
+      break;
+    }
+  }
+  if (numStarted == 0)
+  {
+    // Scan on this thread then
+    ScanThread(&scan);
+  }
+  for (u32_t i = 0; i < numStarted; i++)
+  {
+    SDL_WaitThread(threads[i], NULL);
+  }
+
+  // The previous index may be the file that gets replaced
+  if (scan.Previous != NULL)
+  {
+    RomLibrary_Close(&previous);
+    scan.Previous = NULL;
+  }
+  isOk = WriteIndex(&scan, indexFile);
+  if (isOk)
+  {
+    LogMessage("Indexed %u ROMs in %s, read %u, %u unchanged, took %u ms", scan.NumFiles, directory,
+               (u32_t) SDL_AtomicGet(&scan.NumRead), scan.NumFiles - (u32_t) SDL_AtomicGet(&scan.NumRead),
+               SDL_GetTicks() - startTicks);
+  }
+
+cleanup:
+  if (scan.Previous != NULL)
+  {
+    RomLibrary_Close(&previous);
+  }
+  for (u32_t i = 0; i < scan.NumFiles; i++)
+  {
+    free(scan.Files[i].Path);
+  }
+  free(scan.Files);
+  free(scan.Entries);
+  return isOk;
+}
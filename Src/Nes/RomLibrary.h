@@ -0,0 +1,67 @@
+/*
+ * RomLibrary.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_NES_ROMLIBRARY_H_
+#define SRC_NES_ROMLIBRARY_H_
+
+#include "Types.h"
+#include "MappedFile.h"
+#include "Sha1.h"
+
+// An index of all .nes files below a directory. The index file is used as is
+// after mapping it: a header, the entries sorted by path and then the path
+// strings. Rescanning reuses the entries of files with an unchanged size and
+// modification time, so only new and changed files are read.
+
+#define ROM_LIBRARY_MAGIC           "NESLIB01"
+#define ROM_LIBRARY_FLAG_VALID      (0x01)    // Header parsed, the other fields are filled in
+#define ROM_LIBRARY_FLAG_NES20      (0x02)
+#define ROM_LIBRARY_FLAG_BATTERY    (0x04)
+#define ROM_LIBRARY_FLAG_KNOWN      (0x08)    // Found in the ROM database
+
+typedef struct
+{
+  char Magic[8];
+  u32_t NumEntries;
+  u32_t StringsSize;
+} RomLibraryHeader_t;
+
+typedef struct
+{
+  u32_t PathOffset;       // Into the strings, zero terminated and relative to the library directory
+  u32_t Crc32;            // Of PRG and CHR ROM, like the ROM database
+  uint64_t Size;
+  int64_t ModifiedTime;   // Seconds since the epoch
+  u8_t Sha1[SHA1_DIGEST_SIZE];
+  u16_t MapperId;
+  u8_t Submapper;
+  u8_t Timing;            // INesTiming_t
+  u8_t Flags;             // ROM_LIBRARY_FLAG_*
+  u8_t Reserved[3];
+} RomLibraryEntry_t;
+
+typedef struct
+{
+  MappedFile_t File;
+  const RomLibraryHeader_t *Header;
+  const RomLibraryEntry_t *Entries;
+  const char *Strings;
+} RomLibrary_t;
+
+bool RomLibrary_Open(RomLibrary_t *library, const char *indexFile);
+
+void RomLibrary_Close(RomLibrary_t *library);
+
+const char* RomLibrary_GetPath(const RomLibrary_t *library, const RomLibraryEntry_t *entry);
+
+// Returns the entry for a path relative to the library directory, NULL if it isn't indexed
+const RomLibraryEntry_t* RomLibrary_Find(const RomLibrary_t *library, const char *path);
+
+// Scans directory on numThreads threads and (re)writes indexFile
+bool RomLibrary_Scan(const char *directory, const char *indexFile, u32_t numThreads);
+
+#endif /* SRC_NES_ROMLIBRARY_H_ */
@@ -0,0 +1,245 @@
+/*
+ * AudioCapture.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "AudioCapture.h"
+#include "log.h"
+#include <string.h>
+
+#define WAV_HEADER_SIZE   (44)
+
+static void PutLE16(uint8_t *p, uint16_t value)
+{
+  p[0] = (uint8_t) value;
+  p[1] = (uint8_t) (value >> 8);
+}
+
+static void PutLE32(uint8_t *p, uint32_t value)
+{
+  p[0] = (uint8_t) value;
+  p[1] = (uint8_t) (value >> 8);
+  p[2] = (uint8_t) (value >> 16);
+  p[3] = (uint8_t) (value >> 24);
+}
+
+static bool WriteWavHeader(FILE *file, uint32_t sampleRate, uint32_t numSamples)
+{
+  uint8_t header[WAV_HEADER_SIZE];
+  uint32_t dataSize = numSamples * sizeof(int16_t);
+
+  memcpy(&header[0], "RIFF", 4);
+  PutLE32(&header[4], 36 + dataSize);
+  memcpy(&header[8], "WAVE", 4);
+  memcpy(&header[12], "fmt ", 4);
+  PutLE32(&header[16], 16);                             // Format chunk size
+  PutLE16(&header[20], 1);                              // PCM
+  PutLE16(&header[22], 1);                              // Mono
+  PutLE32(&header[24], sampleRate);
+  PutLE32(&header[28], sampleRate * sizeof(int16_t));   // Bytes per second
+  PutLE16(&header[32], sizeof(int16_t));                // Block align
+  PutLE16(&header[34], 16);                             // Bits per sample
+  memcpy(&header[36], "data", 4);
+  PutLE32(&header[40], dataSize);
+
+  return fseek(file, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+static void WriteBlock(AudioCapture_t *capture, const AudioCaptureBlock_t *block)
+{
+  uint8_t bytes[AUDIO_CAPTURE_BLOCK_SAMPLES * sizeof(int16_t)];
+
+  // Files are always little endian, whatever the host is
+  for (uint32_t i = 0; i < block->NumSamples; i++)
+  {
+    PutLE16(&bytes[i * sizeof(int16_t)], (uint16_t) block->Samples[i]);
+  }
+
+  size_t numBytes = block->NumSamples * sizeof(int16_t);
+  if (!capture->WriteFailed && fwrite(bytes, 1, numBytes, capture->File) != numBytes)
+  {
+    LogError("Audio capture write failed, the rest of the capture is lost");
+    capture->WriteFailed = true;
+  }
+  if (!capture->WriteFailed)
+  {
+    capture->SamplesWritten += block->NumSamples;
+  }
+}
+
+static int WriterThread(void *data)
+{
+  AudioCapture_t *capture = data;
+  AudioCaptureBlock_t block;
+
+  for (;;)
+  {
+    SDL_SemWait(capture->BlocksAvailable);
+
+    while (SpscQueue_Pop(&capture->Queue, &block))
+    {
+      if (capture->IsBlocking)
+      {
+        SDL_SemPost(capture->BlocksTaken);
+      }
+      WriteBlock(capture, &block);
+    }
+
+    // Everything queued before the stop request has been written at this point
+    if (SDL_AtomicGet(&capture->IsStopping))
+    {
+      return 0;
+    }
+  }
+}
+
+static void QueuePending(AudioCapture_t *capture)
+{
+  bool isQueued = SpscQueue_Push(&capture->Queue, &capture->Pending);
+  while (!isQueued && capture->IsBlocking)
+  {
+    // Posts can be left over from blocks we didn't wait for, so try again after waking up
+    SDL_SemWait(capture->BlocksTaken);
+    isQueued = SpscQueue_Push(&capture->Queue, &capture->Pending);
+  }
+
+  if (isQueued)
+  {
+    SDL_SemPost(capture->BlocksAvailable);
+  }
+  else
+  {
+    SDL_AtomicIncRef(&capture->DroppedBlocks);
+  }
+  capture->Pending.NumSamples = 0;
+}
+
+bool AudioCapture_Start(AudioCapture_t *capture, const char *file, uint32_t sampleRate, AudioCaptureFormat_t format, bool isBlocking)
+{
+  memset(capture, 0, sizeof(*capture));
+  capture->Format = format;
+  capture->IsBlocking = isBlocking;
+  capture->SampleRate = sampleRate;
+
+  capture->File = fopen(file, "wb");
+  if (capture->File == NULL)
+  {
+    LogError("Unable to open audio capture file %s", file);
+    return false;
+  }
+
+  // Reserve room for the header, the sizes are only known when the capture stops
+  if (format == AUDIO_CAPTURE_FORMAT_WAV && !WriteWavHeader(capture->File, sampleRate, 0))
+  {
+    LogError("Unable to write audio capture file %s", file);
+    fclose(capture->File);
+    return false;
+  }
+
+  if (!SpscQueue_Initialize(&capture->Queue, sizeof(AudioCaptureBlock_t), AUDIO_CAPTURE_QUEUE_BLOCKS))
+  {
+    LogError("Unable to allocate the audio capture queue");
+    fclose(capture->File);
+    return false;
+  }
+
+  capture->BlocksAvailable = SDL_CreateSemaphore(0);
+  capture->BlocksTaken = SDL_CreateSemaphore(0);
+  if (capture->BlocksAvailable == NULL || capture->BlocksTaken == NULL)
+  {
+    LogError("SDL_CreateSemaphore failed: %s", SDL_GetError());
+    if (capture->BlocksAvailable != NULL)
+    {
+      SDL_DestroySemaphore(capture->BlocksAvailable);
+    }
+    if (capture->BlocksTaken != NULL)
+    {
+      SDL_DestroySemaphore(capture->BlocksTaken);
+    }
+    SpscQueue_Destroy(&capture->Queue);
+    fclose(capture->File);
+    return false;
+  }
+
+  capture->Thread = SDL_CreateThread(WriterThread, "Audio Capture", capture);
+  if (capture->Thread == NULL)
+  {
+    LogError("SDL_CreateThread failed: %s", SDL_GetError());
+    SDL_DestroySemaphore(capture->BlocksAvailable);
+    SDL_DestroySemaphore(capture->BlocksTaken);
+    SpscQueue_Destroy(&capture->Queue);
+    fclose(capture->File);
+    return false;
+  }
+
+  capture->IsActive = true;
+  return true;
+}
+
+void AudioCapture_Stop(AudioCapture_t *capture)
+{
+  if (!capture->IsActive)
+  {
+    return;
+  }
+
+  if (capture->Pending.NumSamples > 0)
+  {
+    QueuePending(capture);
+  }
+
+  // The writer drains the queue before it exits
+  SDL_AtomicSet(&capture->IsStopping, 1);
+  SDL_SemPost(capture->BlocksAvailable);
+  SDL_WaitThread(capture->Thread, NULL);
+
+  if (capture->Format == AUDIO_CAPTURE_FORMAT_WAV && !WriteWavHeader(capture->File, capture->SampleRate, capture->SamplesWritten))
+  {
+    LogError("Unable to finalize the audio capture header");
+  }
+  if (fclose(capture->File) != 0)
+  {
+    LogError("Unable to close the audio capture file");
+  }
+
+  LogMessage("Audio capture stopped, %u samples written, %u blocks dropped",
+             capture->SamplesWritten,
+             AudioCapture_GetDroppedBlocks(capture));
+
+  SDL_DestroySemaphore(capture->BlocksAvailable);
+  SDL_DestroySemaphore(capture->BlocksTaken);
+  SpscQueue_Destroy(&capture->Queue);
+  capture->File = NULL;
+  capture->IsActive = false;
+}
+
+void AudioCapture_Write(AudioCapture_t *capture, const int16_t *samples, uint32_t numSamples)
+{
+  if (!capture->IsActive)
+  {
+    return;
+  }
+
+  while (numSamples > 0)
+  {
+    uint32_t space = AUDIO_CAPTURE_BLOCK_SAMPLES - capture->Pending.NumSamples;
+    uint32_t count = numSamples < space ? numSamples : space;
+
+    memcpy(&capture->Pending.Samples[capture->Pending.NumSamples], samples, count * sizeof(int16_t));
+    capture->Pending.NumSamples += count;
+    samples += count;
+    numSamples -= count;
+
+    if (capture->Pending.NumSamples == AUDIO_CAPTURE_BLOCK_SAMPLES)
+    {
+      QueuePending(capture);
+    }
+  }
+}
+
+uint32_t AudioCapture_GetDroppedBlocks(AudioCapture_t *capture)
+{
+  return (uint32_t) SDL_AtomicGet(&capture->DroppedBlocks);
+}
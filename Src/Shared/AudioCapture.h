@@ -0,0 +1,62 @@
+/*
+ * AudioCapture.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_SHARED_AUDIOCAPTURE_H_
+#define SRC_SHARED_AUDIOCAPTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include "SpscQueue.h"
+
+#define AUDIO_CAPTURE_BLOCK_SAMPLES   (1024)    // Samples handed to the writer thread at once
+#define AUDIO_CAPTURE_QUEUE_BLOCKS    (64)      // Blocks that can be in flight, power of two
+
+typedef enum
+{
+  AUDIO_CAPTURE_FORMAT_WAV,     // 16 bit mono PCM with a RIFF header
+  AUDIO_CAPTURE_FORMAT_RAW,     // Headerless 16 bit mono little endian PCM
+} AudioCaptureFormat_t;
+
+typedef struct
+{
+  uint32_t NumSamples;
+  int16_t Samples[AUDIO_CAPTURE_BLOCK_SAMPLES];
+} AudioCaptureBlock_t;
+
+// Tees 16 bit mono audio into a file. The producer only fills blocks and queues
+// them, a writer thread does the file I/O. When the queue is full a block is
+// dropped and counted instead of waiting for the disk, unless the capture is
+// blocking. Then the producer waits, so nothing is lost.
+typedef struct
+{
+  SpscQueue_t Queue;
+  SDL_sem *BlocksAvailable;
+  SDL_sem *BlocksTaken;           // Posted by the writer for every block it takes, only when blocking
+  SDL_Thread *Thread;
+  SDL_atomic_t IsStopping;
+  SDL_atomic_t DroppedBlocks;
+  FILE *File;
+  AudioCaptureFormat_t Format;
+  bool IsBlocking;                // Wait for room in the queue instead of dropping a block
+  uint32_t SampleRate;
+  uint32_t SamplesWritten;        // Writer thread only until stopped
+  bool WriteFailed;               // Writer thread only until stopped
+  AudioCaptureBlock_t Pending;    // Producer only, block that is being filled
+  bool IsActive;                  // Producer only
+} AudioCapture_t;
+
+bool AudioCapture_Start(AudioCapture_t *capture, const char *file, uint32_t sampleRate, AudioCaptureFormat_t format, bool isBlocking);
+
+void AudioCapture_Stop(AudioCapture_t *capture);
+
+void AudioCapture_Write(AudioCapture_t *capture, const int16_t *samples, uint32_t numSamples);
+
+uint32_t AudioCapture_GetDroppedBlocks(AudioCapture_t *capture);
+
+#endif /* SRC_SHARED_AUDIOCAPTURE_H_ */
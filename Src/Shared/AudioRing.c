@@ -0,0 +1,154 @@
+/*
+ * AudioRing.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "AudioRing.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_RATE_DELTA        (0.005)     // Rate is adjusted by at most 0.5%, inaudible
+#define RATE_OFFSET_GAIN      (0.00002)   // Rate offset added per call at a full error
+#define FILL_SMOOTHING        (1.0 / 64)  // Weight of a new fill level in the average
+
+bool AudioRing_Initialize(AudioRing_t *ring, uint32_t capacity)
+{
+  memset(ring, 0, sizeof(*ring));
+
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+  {
+    LogError("Audio ring capacity %u is not a power of two", capacity);
+    return false;
+  }
+
+  ring->Buffer = calloc(capacity, sizeof(int16_t));
+  if (ring->Buffer == NULL)
+  {
+    LogError("Unable to allocate audio ring of %u samples", capacity);
+    return false;
+  }
+
+  ring->Capacity = capacity;
+  SDL_AtomicSet(&ring->Head, 0);
+  SDL_AtomicSet(&ring->Tail, 0);
+  SDL_AtomicSet(&ring->Underruns, 0);
+  SDL_AtomicSet(&ring->Overruns, 0);
+  return true;
+}
+
+void AudioRing_Destroy(AudioRing_t *ring)
+{
+  free(ring->Buffer);
+  ring->Buffer = NULL;
+  ring->Capacity = 0;
+}
+
+uint32_t AudioRing_Write(AudioRing_t *ring, const int16_t *samples, uint32_t numSamples)
+{
+  uint32_t head = (uint32_t) SDL_AtomicGet(&ring->Head);
+  uint32_t tail = (uint32_t) SDL_AtomicGet(&ring->Tail);
+  uint32_t space = ring->Capacity - (head - tail);
+
+  if (numSamples > space)
+  {
+    SDL_AtomicIncRef(&ring->Overruns);
+    numSamples = space;
+  }
+
+  // Copy in at most two parts, around the end of the buffer
+  uint32_t start = head & (ring->Capacity - 1);
+  uint32_t firstPart = ring->Capacity - start < numSamples ? ring->Capacity - start : numSamples;
+  memcpy(&ring->Buffer[start], samples, firstPart * sizeof(int16_t));
+  memcpy(ring->Buffer, &samples[firstPart], (numSamples - firstPart) * sizeof(int16_t));
+
+  // Publish the samples to the consumer
+  SDL_AtomicSet(&ring->Head, (int) (head + numSamples));
+  return numSamples;
+}
+
+void AudioRing_ReadS32(AudioRing_t *ring, int32_t *samples, uint32_t numSamples)
+{
+  uint32_t tail = (uint32_t) SDL_AtomicGet(&ring->Tail);
+  uint32_t head = (uint32_t) SDL_AtomicGet(&ring->Head);
+  uint32_t available = head - tail;
+  uint32_t numRead = numSamples < available ? numSamples : available;
+
+  for (uint32_t i = 0; i < numRead; i++)
+  {
+    samples[i] = (int32_t) ring->Buffer[(tail + i) & (ring->Capacity - 1)] << 16;
+  }
+
+  if (numRead > 0)
+  {
+    ring->LastSample = ring->Buffer[(tail + numRead - 1) & (ring->Capacity - 1)];
+    SDL_AtomicSet(&ring->Tail, (int) (tail + numRead));
+  }
+
+  if (numRead < numSamples)
+  {
+    // Hold the last level instead of dropping to 0, which would click
+    SDL_AtomicIncRef(&ring->Underruns);
+    for (uint32_t i = numRead; i < numSamples; i++)
+    {
+      samples[i] = (int32_t) ring->LastSample << 16;
+    }
+  }
+}
+
+uint32_t AudioRing_GetFill(AudioRing_t *ring)
+{
+  return (uint32_t) SDL_AtomicGet(&ring->Head) - (uint32_t) SDL_AtomicGet(&ring->Tail);
+}
+
+uint32_t AudioRing_GetUnderruns(AudioRing_t *ring)
+{
+  return (uint32_t) SDL_AtomicGet(&ring->Underruns);
+}
+
+uint32_t AudioRing_GetOverruns(AudioRing_t *ring)
+{
+  return (uint32_t) SDL_AtomicGet(&ring->Overruns);
+}
+
+double AudioRing_GetRateRatio(AudioRing_t *ring, uint32_t targetFill)
+{
+  // The producer writes in bursts, so steer on the average fill level instead
+  ring->AverageFill += (AudioRing_GetFill(ring) - ring->AverageFill) * FILL_SMOOTHING;
+
+  double error = (targetFill - ring->AverageFill) / targetFill;
+  if (error > 1.0)
+  {
+    error = 1.0;
+  }
+  else if (error < -1.0)
+  {
+    error = -1.0;
+  }
+
+  // A constant drift between the clocks would keep the fill away from the target,
+  // the offset slowly grows until it cancels the drift
+  ring->RateOffset += error * RATE_OFFSET_GAIN;
+  if (ring->RateOffset > MAX_RATE_DELTA)
+  {
+    ring->RateOffset = MAX_RATE_DELTA;
+  }
+  else if (ring->RateOffset < -MAX_RATE_DELTA)
+  {
+    ring->RateOffset = -MAX_RATE_DELTA;
+  }
+
+  // Below the target the producer makes a few more samples per second and vice versa
+  double delta = ring->RateOffset + error * MAX_RATE_DELTA;
+  if (delta > MAX_RATE_DELTA)
+  {
+    delta = MAX_RATE_DELTA;
+  }
+  else if (delta < -MAX_RATE_DELTA)
+  {
+    delta = -MAX_RATE_DELTA;
+  }
+  return 1.0 + delta;
+}
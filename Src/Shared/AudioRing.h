@@ -0,0 +1,47 @@
+/*
+ * AudioRing.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_SHARED_AUDIORING_H_
+#define SRC_SHARED_AUDIORING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+// Lock-free sample ring between the thread producing audio and the SDL audio
+// callback. The producer keeps the fill level near a target by nudging its
+// sample rate with AudioRing_GetRateRatio, so both sides never drift apart.
+typedef struct
+{
+  SDL_atomic_t Head;          // Total samples written, only written by the producer
+  SDL_atomic_t Tail;          // Total samples read, only written by the consumer
+  SDL_atomic_t Underruns;     // Reads that couldn't be filled completely
+  SDL_atomic_t Overruns;      // Writes that didn't fit completely
+  uint32_t Capacity;          // Power of two
+  int16_t *Buffer;
+  int16_t LastSample;         // Consumer only, held while underrunning
+  double AverageFill;         // Producer only, smoothed fill level for rate control
+  double RateOffset;          // Producer only, accumulated correction for the clock drift
+} AudioRing_t;
+
+bool AudioRing_Initialize(AudioRing_t *ring, uint32_t capacity);
+
+void AudioRing_Destroy(AudioRing_t *ring);
+
+uint32_t AudioRing_Write(AudioRing_t *ring, const int16_t *samples, uint32_t numSamples);
+
+void AudioRing_ReadS32(AudioRing_t *ring, int32_t *samples, uint32_t numSamples);
+
+uint32_t AudioRing_GetFill(AudioRing_t *ring);
+
+uint32_t AudioRing_GetUnderruns(AudioRing_t *ring);
+
+uint32_t AudioRing_GetOverruns(AudioRing_t *ring);
+
+double AudioRing_GetRateRatio(AudioRing_t *ring, uint32_t targetFill);
+
+#endif /* SRC_SHARED_AUDIORING_H_ */
@@ -0,0 +1,18 @@
+/*
+ * Crc32.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_SHARED_CRC32_H_
+#define SRC_SHARED_CRC32_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 as used by zip, PNG and ROM databases. Start with 0 and feed the
+// previous result back in to checksum data in parts.
+uint32_t Crc32_Update(uint32_t crc, const void *data, size_t size);
+
+#endif /* SRC_SHARED_CRC32_H_ */
@@ -0,0 +1,265 @@
+/*
+ * Deflate.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Deflate.h"
+#include "log.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define WINDOW_SIZE     (32768)
+#define HASH_BITS       (15)
+#define HASH_SIZE       (1 << HASH_BITS)
+#define MIN_MATCH       (3)
+#define MAX_MATCH       (258)
+#define MAX_CHAIN       (64)      // Candidates tried per position, trades speed for size
+#define NO_POSITION     (-1)
+
+static const uint16_t LENGTH_BASE[29] =
+{
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LENGTH_EXTRA[29] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t DISTANCE_BASE[30] =
+{
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t DISTANCE_EXTRA[30] =
+{
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+typedef struct
+{
+  uint8_t *Output;
+  size_t Capacity;
+  size_t Size;
+  uint32_t Bits;        // Pending bits, LSB first
+  uint8_t NumBits;
+  bool IsOverflowed;
+} BitWriter_t;
+
+static void PutBits(BitWriter_t *writer, uint32_t value, uint8_t numBits)
+{
+  writer->Bits |= value << writer->NumBits;
+  writer->NumBits += numBits;
+  while (writer->NumBits >= 8)
+  {
+    if (writer->Size < writer->Capacity)
+    {
+      writer->Output[writer->Size++] = (uint8_t) writer->Bits;
+    }
+    else
+    {
+      writer->IsOverflowed = true;
+    }
+    writer->Bits >>= 8;
+    writer->NumBits -= 8;
+  }
+}
+
+static void PutByte(BitWriter_t *writer, uint8_t value)
+{
+  PutBits(writer, value, 8);
+}
+
+// Huffman codes are stored starting at their most significant bit
+static void PutCode(BitWriter_t *writer, uint32_t code, uint8_t length)
+{
+  uint32_t reversed = 0;
+  for (uint8_t i = 0; i < length; i++)
+  {
+    reversed = (reversed << 1) | ((code >> i) & 1);
+  }
+  PutBits(writer, reversed, length);
+}
+
+static void PutSymbol(BitWriter_t *writer, uint16_t symbol)
+{
+  // Fixed literal/length code of RFC 1951 section 3.2.6
+  if (symbol < 144)
+  {
+    PutCode(writer, 0x30 + symbol, 8);
+  }
+  else if (symbol < 256)
+  {
+    PutCode(writer, 0x190 + (symbol - 144), 9);
+  }
+  else if (symbol < 280)
+  {
+    PutCode(writer, symbol - 256, 7);
+  }
+  else
+  {
+    PutCode(writer, 0xC0 + (symbol - 280), 8);
+  }
+}
+
+static void PutMatch(BitWriter_t *writer, uint16_t length, uint16_t distance)
+{
+  uint8_t lengthCode = 28;
+  while (LENGTH_BASE[lengthCode] > length)
+  {
+    lengthCode--;
+  }
+  PutSymbol(writer, 257 + lengthCode);
+  PutBits(writer, length - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+
+  uint8_t distanceCode = 29;
+  while (DISTANCE_BASE[distanceCode] > distance)
+  {
+    distanceCode--;
+  }
+  PutCode(writer, distanceCode, 5);
+  PutBits(writer, distance - DISTANCE_BASE[distanceCode], DISTANCE_EXTRA[distanceCode]);
+}
+
+static inline uint32_t Hash(const uint8_t *p)
+{
+  return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (HASH_SIZE - 1);
+}
+
+static uint32_t Adler32(const uint8_t *data, size_t size)
+{
+  uint32_t a = 1;
+  uint32_t b = 0;
+
+  while (size > 0)
+  {
+    // Largest block that can't overflow before the modulo
+    size_t block = size < 5552 ? size : 5552;
+    size -= block;
+    while (block-- > 0)
+    {
+      a += *data++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return (b << 16) | a;
+}
+
+size_t Deflate_GetBound(size_t inputSize)
+{
+  // Literals take at most 9 bits, plus zlib header, block header and checksum
+  return inputSize + inputSize / 8 + 16;
+}
+
+size_t Deflate_Compress(const uint8_t *input, size_t inputSize, uint8_t *output, size_t outputCapacity)
+{
+  int32_t *head = malloc(HASH_SIZE * sizeof(int32_t));
+  int32_t *previous = malloc(WINDOW_SIZE * sizeof(int32_t));
+  if (head == NULL || previous == NULL)
+  {
+    LogError("Unable to allocate deflate hash chains");
+    free(head);
+    free(previous);
+    return 0;
+  }
+  for (uint32_t i = 0; i < HASH_SIZE; i++)
+  {
+    head[i] = NO_POSITION;
+  }
+
+  BitWriter_t writer = { output, outputCapacity, 0, 0, 0, false };
+
+  // zlib header: deflate with a 32k window, no dictionary
+  PutByte(&writer, 0x78);
+  PutByte(&writer, 0x01);
+
+  // Everything goes in a single final block with fixed codes
+  PutBits(&writer, 1, 1);
+  PutBits(&writer, 1, 2);
+
+  size_t position = 0;
+  while (position < inputSize)
+  {
+    uint16_t bestLength = 0;
+    uint16_t bestDistance = 0;
+
+    if (position + MIN_MATCH <= inputSize)
+    {
+      size_t maxLength = inputSize - position < MAX_MATCH ? inputSize - position : MAX_MATCH;
+      int32_t candidate = head[Hash(&input[position])];
+      for (uint8_t chain = 0; chain < MAX_CHAIN && candidate != NO_POSITION; chain++)
+      {
+        size_t distance = position - (size_t) candidate;
+        if (distance > WINDOW_SIZE)
+        {
+          break;
+        }
+
+        uint16_t length = 0;
+        while (length < maxLength && input[candidate + length] == input[position + length])
+        {
+          length++;
+        }
+        if (length > bestLength)
+        {
+          bestLength = length;
+          bestDistance = (uint16_t) distance;
+          if (length == maxLength)
+          {
+            break;
+          }
+        }
+        candidate = previous[candidate & (WINDOW_SIZE - 1)];
+      }
+    }
+
+    size_t advance = 1;
+    if (bestLength >= MIN_MATCH)
+    {
+      PutMatch(&writer, bestLength, bestDistance);
+      advance = bestLength;
+    }
+    else
+    {
+      PutSymbol(&writer, input[position]);
+    }
+
+    // Every position that has a full hash joins its chain, also those inside a match
+    for (size_t end = position + advance; position < end; position++)
+    {
+      if (position + MIN_MATCH <= inputSize)
+      {
+        uint32_t hash = Hash(&input[position]);
+        previous[position & (WINDOW_SIZE - 1)] = head[hash];
+        head[hash] = (int32_t) position;
+      }
+    }
+  }
+
+  // End of block, then pad to a byte and append the checksum big endian
+  PutSymbol(&writer, 256);
+  if (writer.NumBits > 0)
+  {
+    PutBits(&writer, 0, 8 - writer.NumBits);
+  }
+  uint32_t adler = Adler32(input, inputSize);
+  PutByte(&writer, (uint8_t) (adler >> 24));
+  PutByte(&writer, (uint8_t) (adler >> 16));
+  PutByte(&writer, (uint8_t) (adler >> 8));
+  PutByte(&writer, (uint8_t) adler);
+
+  free(head);
+  free(previous);
+
+  if (writer.IsOverflowed)
+  {
+    LogError("Deflate output doesn't fit in %u bytes", (unsigned int) outputCapacity);
+    return 0;
+  }
+  return writer.Size;
+}
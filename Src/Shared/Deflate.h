@@ -0,0 +1,24 @@
+/*
+ * Deflate.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_SHARED_DEFLATE_H_
+#define SRC_SHARED_DEFLATE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Small zlib (RFC 1950) compressor. Greedy LZ77 matching over hash chains, the
+// matches are coded with the fixed Huffman codes of deflate (RFC 1951). Not as
+// tight as zlib, but long runs like those in NES screens compress very well.
+
+// Output capacity that is always enough for inputSize bytes
+size_t Deflate_GetBound(size_t inputSize);
+
+// Returns the size of the zlib stream in output, 0 on failure
+size_t Deflate_Compress(const uint8_t *input, size_t inputSize, uint8_t *output, size_t outputCapacity);
+
+#endif /* SRC_SHARED_DEFLATE_H_ */
@@ -0,0 +1,228 @@
+/*
+ * MappedFile.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "MappedFile.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+bool MappedFile_OpenReadOnly(MappedFile_t *file, const char *path)
+{
+  memset(file, 0, sizeof(*file));
+
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+  {
+    LogError("Unable to open file %s", path);
+    return false;
+  }
+
+  long size = -1;
+  if (fseek(f, 0, SEEK_END) == 0)
+  {
+    size = ftell(f);
+  }
+  if (size <= 0 || fseek(f, 0, SEEK_SET) != 0)
+  {
+    LogError("Unable to read file %s", path);
+    fclose(f);
+    return false;
+  }
+
+  file->Data = malloc((size_t) size);
+  if (file->Data == NULL || fread(file->Data, 1, (size_t) size, f) != (size_t) size)
+  {
+    LogError("Unable to read file %s", path);
+    free(file->Data);
+    file->Data = NULL;
+    fclose(f);
+    return false;
+  }
+  file->Size = (size_t) size;
+  fclose(f);
+  return true;
+}
+
+bool MappedFile_OpenWritable(MappedFile_t *file, const char *path, size_t size)
+{
+  memset(file, 0, sizeof(*file));
+
+  // A longer file is kept whole, it's written back completely
+  long fileSize = 0;
+  FILE *f = fopen(path, "rb");
+  if (f != NULL && fseek(f, 0, SEEK_END) == 0)
+  {
+    fileSize = ftell(f);
+  }
+  if (fileSize > 0 && (size_t) fileSize > size)
+  {
+    LogWarning("%s is larger than %zu bytes, keeping all %ld", path, size, fileSize);
+    size = (size_t) fileSize;
+  }
+
+  file->Data = calloc(1, size);
+  file->Path = malloc(strlen(path) + 1);
+  if (file->Data == NULL || file->Path == NULL)
+  {
+    LogError("Unable to allocate memory for %s", path);
+    if (f != NULL)
+    {
+      fclose(f);
+    }
+    MappedFile_Close(file);
+    return false;
+  }
+  strcpy(file->Path, path);
+  file->Size = size;
+
+  // A missing or short file just leaves the rest zeroed
+  if (f != NULL)
+  {
+    if (fseek(f, 0, SEEK_SET) == 0)
+    {
+      size_t bytesRead = fread(file->Data, 1, size, f);
+      (void) bytesRead;
+    }
+    fclose(f);
+  }
+  return MappedFile_Sync(file);
+}
+
+bool MappedFile_Sync(MappedFile_t *file)
+{
+  if (file->Path == NULL)
+  {
+    return true;
+  }
+
+  FILE *f = fopen(file->Path, "wb");
+  bool isWritten = f != NULL && fwrite(file->Data, 1, file->Size, f) == file->Size;
+  if (f != NULL && fclose(f) != 0)
+  {
+    isWritten = false;
+  }
+  if (!isWritten)
+  {
+    LogError("Unable to write %s", file->Path);
+  }
+  return isWritten;
+}
+
+void MappedFile_Close(MappedFile_t *file)
+{
+  free(file->Data);
+  free(file->Path);
+  memset(file, 0, sizeof(*file));
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool MappedFile_OpenReadOnly(MappedFile_t *file, const char *path)
+{
+  memset(file, 0, sizeof(*file));
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+  {
+    LogError("Unable to open file %s", path);
+    return false;
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) != 0 || status.st_size <= 0)
+  {
+    LogError("Unable to read file %s", path);
+    close(fd);
+    return false;
+  }
+
+  // The mapping stays valid after closing the descriptor
+  void *data = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+  {
+    LogError("Unable to map file %s", path);
+    return false;
+  }
+
+  file->Data = data;
+  file->Size = (size_t) status.st_size;
+  return true;
+}
+
+bool MappedFile_OpenWritable(MappedFile_t *file, const char *path, size_t size)
+{
+  memset(file, 0, sizeof(*file));
+
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+  {
+    LogError("Unable to open file %s", path);
+    return false;
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) != 0)
+  {
+    LogError("Unable to get the size of file %s", path);
+    close(fd);
+    return false;
+  }
+  if ((size_t) status.st_size > size)
+  {
+    // Never throw away data, the whole file is mapped instead
+    LogWarning("%s is larger than %zu bytes, keeping all %lld", path, size, (long long) status.st_size);
+    size = (size_t) status.st_size;
+  }
+  else if ((size_t) status.st_size < size && ftruncate(fd, (off_t) size) != 0)
+  {
+    LogError("Unable to extend file %s to %zu bytes", path, size);
+    close(fd);
+    return false;
+  }
+
+  void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+  {
+    LogError("Unable to map file %s", path);
+    return false;
+  }
+
+  file->Data = data;
+  file->Size = size;
+  return true;
+}
+
+bool MappedFile_Sync(MappedFile_t *file)
+{
+  if (file->Data != NULL && msync(file->Data, file->Size, MS_SYNC) != 0)
+  {
+    LogError("Unable to sync mapped file");
+    return false;
+  }
+  return true;
+}
+
+void MappedFile_Close(MappedFile_t *file)
+{
+  if (file->Data != NULL)
+  {
+    munmap(file->Data, file->Size);
+  }
+  memset(file, 0, sizeof(*file));
+}
+
+#endif
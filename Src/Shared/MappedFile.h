@@ -0,0 +1,41 @@
+/*
+ * MappedFile.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_SHARED_MAPPEDFILE_H_
+#define SRC_SHARED_MAPPEDFILE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A file mapped into memory. Read only mappings of the same file share their
+// pages between processes. Writes to a writable mapping end up in the file
+// without any explicit I/O, even when the process crashes. Without mmap
+// (Windows) the file is read into a heap buffer instead and written back by
+// MappedFile_Sync.
+typedef struct
+{
+  uint8_t *Data;          // NULL when nothing is mapped
+  size_t Size;
+#ifdef _WIN32
+  char *Path;             // Where to write back to, NULL when read only
+#endif
+} MappedFile_t;
+
+bool MappedFile_OpenReadOnly(MappedFile_t *file, const char *path);
+
+// Creates the file when needed. A shorter file is extended with zeroes, a longer
+// one is never shrunk and mapped whole, so Size can be larger than asked for.
+bool MappedFile_OpenWritable(MappedFile_t *file, const char *path, size_t size);
+
+// Waits until the writes are in the file, only needed to be sure before exiting
+bool MappedFile_Sync(MappedFile_t *file);
+
+// Safe to call on a file that isn't mapped
+void MappedFile_Close(MappedFile_t *file);
+
+#endif /* SRC_SHARED_MAPPEDFILE_H_ */
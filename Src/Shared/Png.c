@@ -0,0 +1,204 @@
+/*
+ * Png.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Png.h"
+#include "Deflate.h"
+#include "Crc32.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PALETTE_COLORS    (256)
+#define COLOR_HASH_SIZE       (1024)    // Power of two, well above the palette size
+#define NO_COLOR              (0xFFFFFFFF)
+
+typedef struct
+{
+  uint32_t Colors[MAX_PALETTE_COLORS];    // 0xRRGGBB
+  uint16_t NumColors;
+  uint32_t HashColors[COLOR_HASH_SIZE];   // Color per slot or NO_COLOR
+  uint8_t HashIndices[COLOR_HASH_SIZE];   // Palette index per slot
+} Palette_t;
+
+static inline uint32_t GetColor(const uint8_t *rgba, size_t pitch, uint16_t x, uint16_t y)
+{
+  const uint8_t *pixel = rgba + y * pitch + x * 4;
+  return ((uint32_t) pixel[0] << 16) | ((uint32_t) pixel[1] << 8) | pixel[2];
+}
+
+// Returns the palette index of color, adding it when needed. -1 if the palette is full.
+static int FindOrAddColor(Palette_t *palette, uint32_t color)
+{
+  uint32_t slot = (color * 2654435761u) >> 22;
+  while (palette->HashColors[slot] != NO_COLOR)
+  {
+    if (palette->HashColors[slot] == color)
+    {
+      return palette->HashIndices[slot];
+    }
+    slot = (slot + 1) & (COLOR_HASH_SIZE - 1);
+  }
+
+  if (palette->NumColors == MAX_PALETTE_COLORS)
+  {
+    return -1;
+  }
+  palette->HashColors[slot] = color;
+  palette->HashIndices[slot] = (uint8_t) palette->NumColors;
+  palette->Colors[palette->NumColors] = color;
+  return palette->NumColors++;
+}
+
+static void PutBE32(uint8_t *p, uint32_t value)
+{
+  p[0] = (uint8_t) (value >> 24);
+  p[1] = (uint8_t) (value >> 16);
+  p[2] = (uint8_t) (value >> 8);
+  p[3] = (uint8_t) value;
+}
+
+static bool WriteChunk(FILE *file, const char *type, const uint8_t *data, uint32_t size)
+{
+  uint8_t header[8];
+  uint8_t trailer[4];
+
+  PutBE32(header, size);
+  memcpy(&header[4], type, 4);
+  // The CRC covers the type and the data
+  uint32_t crc = Crc32_Update(0, type, 4);
+  crc = Crc32_Update(crc, data, size);
+  PutBE32(trailer, crc);
+
+  return fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+         fwrite(data, 1, size, file) == size &&
+         fwrite(trailer, 1, sizeof(trailer), file) == sizeof(trailer);
+}
+
+bool Png_Write(const char *path, const uint8_t *rgba, uint16_t width, uint16_t height, size_t pitch)
+{
+  static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  Palette_t *palette = malloc(sizeof(Palette_t));
+  uint8_t *indices = malloc((size_t) width * height);
+  uint8_t *scanlines = NULL;
+  uint8_t *compressed = NULL;
+  FILE *file = NULL;
+  bool isWritten = false;
+
+  if (palette == NULL || indices == NULL)
+  {
+    LogError("Unable to allocate PNG buffers");
+    goto cleanup;
+  }
+
+  // Index every pixel, gives up on the palette when there are too many colors
+  memset(palette->HashColors, 0xFF, sizeof(palette->HashColors));
+  palette->NumColors = 0;
+  bool isIndexed = true;
+  for (uint16_t y = 0; y < height && isIndexed; y++)
+  {
+    for (uint16_t x = 0; x < width; x++)
+    {
+      int index = FindOrAddColor(palette, GetColor(rgba, pitch, x, y));
+      if (index < 0)
+      {
+        isIndexed = false;
+        break;
+      }
+      indices[y * width + x] = (uint8_t) index;
+    }
+  }
+
+  uint8_t bitDepth = 8;
+  if (isIndexed)
+  {
+    bitDepth = palette->NumColors <= 2 ? 1 : palette->NumColors <= 4 ? 2 : palette->NumColors <= 16 ? 4 : 8;
+  }
+
+  // Every scanline starts with filter type 0, pixels are packed from the most significant bit
+  size_t rowSize = isIndexed ? ((size_t) width * bitDepth + 7) / 8 : (size_t) width * 3;
+  size_t scanlinesSize = (rowSize + 1) * height;
+  scanlines = calloc(scanlinesSize, 1);
+  if (scanlines == NULL)
+  {
+    LogError("Unable to allocate PNG buffers");
+    goto cleanup;
+  }
+  for (uint16_t y = 0; y < height; y++)
+  {
+    uint8_t *row = &scanlines[y * (rowSize + 1) + 1];
+    for (uint16_t x = 0; x < width; x++)
+    {
+      if (isIndexed)
+      {
+        uint32_t bit = (uint32_t) x * bitDepth;
+        row[bit / 8] |= indices[y * width + x] << (8 - bitDepth - bit % 8);
+      }
+      else
+      {
+        uint32_t color = GetColor(rgba, pitch, x, y);
+        row[x * 3 + 0] = (uint8_t) (color >> 16);
+        row[x * 3 + 1] = (uint8_t) (color >> 8);
+        row[x * 3 + 2] = (uint8_t) color;
+      }
+    }
+  }
+
+  size_t compressedCapacity = Deflate_GetBound(scanlinesSize);
+  compressed = malloc(compressedCapacity);
+  size_t compressedSize = compressed != NULL ? Deflate_Compress(scanlines, scanlinesSize, compressed, compressedCapacity) : 0;
+  if (compressedSize == 0)
+  {
+    LogError("Unable to compress PNG image data");
+    goto cleanup;
+  }
+
+  file = fopen(path, "wb");
+  if (file == NULL)
+  {
+    LogError("Unable to open %s", path);
+    goto cleanup;
+  }
+
+  uint8_t header[13];
+  PutBE32(&header[0], width);
+  PutBE32(&header[4], height);
+  header[8] = bitDepth;
+  header[9] = isIndexed ? 3 : 2;      // Color type palette or RGB
+  header[10] = 0;                     // Deflate
+  header[11] = 0;                     // Adaptive filtering
+  header[12] = 0;                     // Not interlaced
+
+  uint8_t colors[MAX_PALETTE_COLORS * 3];
+  for (uint16_t i = 0; isIndexed && i < palette->NumColors; i++)
+  {
+    colors[i * 3 + 0] = (uint8_t) (palette->Colors[i] >> 16);
+    colors[i * 3 + 1] = (uint8_t) (palette->Colors[i] >> 8);
+    colors[i * 3 + 2] = (uint8_t) palette->Colors[i];
+  }
+
+  isWritten = fwrite(SIGNATURE, 1, sizeof(SIGNATURE), file) == sizeof(SIGNATURE) &&
+              WriteChunk(file, "IHDR", header, sizeof(header)) &&
+              (!isIndexed || WriteChunk(file, "PLTE", colors, palette->NumColors * 3)) &&
+              WriteChunk(file, "IDAT", compressed, (uint32_t) compressedSize) &&
+              WriteChunk(file, "IEND", NULL, 0);
+  if (fclose(file) != 0)
+  {
+    isWritten = false;
+  }
+  if (!isWritten)
+  {
+    LogError("Unable to write %s", path);
+  }
+
+cleanup:
+  free(palette);
+  free(indices);
+  free(scanlines);
+  free(compressed);
+  return isWritten;
+}
@@ -0,0 +1,20 @@
+/*
+ * Png.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_SHARED_PNG_H_
+#define SRC_SHARED_PNG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Writes RGBA pixels (bytes in R, G, B, A order) to a PNG file, alpha is
+// dropped. Images with at most 256 colors become palette PNGs with the smallest
+// bit depth that fits, others are stored as RGB.
+bool Png_Write(const char *path, const uint8_t *rgba, uint16_t width, uint16_t height, size_t pitch);
+
+#endif /* SRC_SHARED_PNG_H_ */
@@ -0,0 +1,95 @@
+/*
+ * Profiler.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Profiler.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define OVERHEAD_SAMPLES    (1001)
+
+bool _isProfiling;
+ProfilerCounter_t _profilerCounters[NR_OF_PROFILER_SECTIONS];
+
+static const char *SECTION_NAMES[NR_OF_PROFILER_SECTIONS] =
+{
+    "cpu",
+    "ppu",
+    "apu",
+};
+
+// The tick rate isn't known up front, it's measured against the performance counter
+static uint64_t _startTicks;
+static uint64_t _stopTicks;
+static uint64_t _startCounter;
+static uint64_t _stopCounter;
+static uint64_t _overheadTicks;      // Measured by an empty sample
+
+static int CompareTicks(const void *a, const void *b)
+{
+  uint64_t ticksA = *(const uint64_t*) a;
+  uint64_t ticksB = *(const uint64_t*) b;
+  return ticksA < ticksB ? -1 : ticksA > ticksB;
+}
+
+// The median, a typical sample costs clearly more than the fastest one
+static uint64_t MeasureOverhead(void)
+{
+  uint64_t ticks[OVERHEAD_SAMPLES];
+  for (int i = 0; i < OVERHEAD_SAMPLES; i++)
+  {
+    uint64_t start = Profiler_GetTicks();
+    ticks[i] = Profiler_GetTicks() - start;
+  }
+  qsort(ticks, OVERHEAD_SAMPLES, sizeof(ticks[0]), CompareTicks);
+  return ticks[OVERHEAD_SAMPLES / 2];
+}
+
+void Profiler_Start(void)
+{
+  memset(_profilerCounters, 0, sizeof(_profilerCounters));
+  // Nested sections are entered together, so they start at different points
+  // to keep the time stamp reads of one out of the samples of the others
+  for (int i = 0; i < NR_OF_PROFILER_SECTIONS; i++)
+  {
+    _profilerCounters[i].Countdown = 1 + (i * 7) % PROFILER_SAMPLE_INTERVAL;
+  }
+  _overheadTicks = MeasureOverhead();
+  _startCounter = SDL_GetPerformanceCounter();
+  _startTicks = Profiler_GetTicks();
+  _isProfiling = true;
+}
+
+void Profiler_Stop(void)
+{
+  _isProfiling = false;
+  _stopTicks = Profiler_GetTicks();
+  _stopCounter = SDL_GetPerformanceCounter();
+}
+
+double Profiler_GetElapsedSeconds(void)
+{
+  return (double) (_stopCounter - _startCounter) / SDL_GetPerformanceFrequency();
+}
+
+double Profiler_GetSeconds(ProfilerSection_t section)
+{
+  const ProfilerCounter_t *counter = &_profilerCounters[section];
+  if (counter->NumSamples == 0 || _stopTicks == _startTicks)
+  {
+    return 0.0;
+  }
+
+  uint64_t overhead = counter->NumSamples * _overheadTicks;
+  uint64_t sampledTicks = counter->SampledTicks > overhead ? counter->SampledTicks - overhead : 0;
+  double ticks = (double) sampledTicks * counter->NumCalls / counter->NumSamples;
+  return ticks / (_stopTicks - _startTicks) * Profiler_GetElapsedSeconds();
+}
+
+const char* Profiler_GetName(ProfilerSection_t section)
+{
+  return SECTION_NAMES[section];
+}
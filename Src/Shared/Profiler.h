@@ -0,0 +1,105 @@
+/*
+ * Profiler.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_SHARED_PROFILER_H_
+#define SRC_SHARED_PROFILER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+// Sampling profiler for the emulation sections. Only one in every
+// PROFILER_SAMPLE_INTERVAL calls of a section is timed, with the time stamp
+// counter where there is one. The time of the other calls is estimated from
+// the samples. While stopped a section costs a load and a branch. Sections may
+// be nested, each one is timed on its own. Only use from the emulation thread.
+// A sample costs two time stamp reads, so a section has to take well more than
+// that per call. Parts of a PPU dot don't, the PPU is only timed as a whole.
+
+#define PROFILER_SAMPLE_INTERVAL    (61)    // Prime, so samples don't lock onto the 341 dot scanline
+#define PROFILER_MAX_SAMPLE_TICKS   (100000) // Longer samples were preempted, they're left out
+
+typedef enum
+{
+  PROFILER_SECTION_CPU,
+  PROFILER_SECTION_PPU,
+  PROFILER_SECTION_APU,
+  NR_OF_PROFILER_SECTIONS
+} ProfilerSection_t;
+
+typedef struct
+{
+  uint64_t NumCalls;
+  uint64_t NumSamples;
+  uint64_t SampledTicks;
+  uint64_t Start;             // Of the sample in progress
+  uint32_t Countdown;         // Calls until the next sample
+  bool IsSampling;
+} ProfilerCounter_t;
+
+extern bool _isProfiling;
+extern ProfilerCounter_t _profilerCounters[NR_OF_PROFILER_SECTIONS];
+
+static inline uint64_t Profiler_GetTicks(void)
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+  return __rdtsc();
+#else
+  return SDL_GetPerformanceCounter();
+#endif
+}
+
+static inline void Profiler_Begin(ProfilerSection_t section)
+{
+  if (_isProfiling)
+  {
+    ProfilerCounter_t *counter = &_profilerCounters[section];
+    counter->NumCalls++;
+    if (--counter->Countdown == 0)
+    {
+      counter->Countdown = PROFILER_SAMPLE_INTERVAL;
+      counter->IsSampling = true;
+      counter->Start = Profiler_GetTicks();
+    }
+  }
+}
+
+static inline void Profiler_End(ProfilerSection_t section)
+{
+  ProfilerCounter_t *counter = &_profilerCounters[section];
+  if (counter->IsSampling)
+  {
+    // A preempted sample would be extrapolated to every call in its interval
+    uint64_t ticks = Profiler_GetTicks() - counter->Start;
+    if (ticks < PROFILER_MAX_SAMPLE_TICKS)
+    {
+      counter->SampledTicks += ticks;
+      counter->NumSamples++;
+    }
+    counter->IsSampling = false;
+  }
+}
+
+// Clears the counters and starts sampling
+void Profiler_Start(void);
+
+void Profiler_Stop(void);
+
+// Estimated time spent in a section between start and stop
+double Profiler_GetSeconds(ProfilerSection_t section);
+
+// Time between start and stop
+double Profiler_GetElapsedSeconds(void);
+
+const char* Profiler_GetName(ProfilerSection_t section);
+
+#endif /* SRC_SHARED_PROFILER_H_ */
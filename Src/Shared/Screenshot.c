@@ -0,0 +1,136 @@
+/*
+ * Screenshot.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Screenshot.h"
+#include "Png.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static SDL_Thread *_thread;
+static SDL_sem *_requestAvailable;
+static SDL_atomic_t _isBusy;            // Set while the worker owns the request
+static SDL_atomic_t _isStopping;
+
+// The request, written by the caller only while _isBusy is clear
+static uint8_t *_pixels;
+static size_t _pixelsCapacity;
+static uint16_t _width;
+static uint16_t _height;
+static char _fileName[64];
+
+static int ScreenshotThread(void *data)
+{
+  for (;;)
+  {
+    SDL_SemWait(_requestAvailable);
+    if (SDL_AtomicGet(&_isStopping))
+    {
+      return 0;
+    }
+
+    if (Png_Write(_fileName, _pixels, _width, _height, (size_t) _width * 4))
+    {
+      LogMessage("Saved screenshot to %s", _fileName);
+    }
+    else
+    {
+      LogError("Failed to save screenshot to %s", _fileName);
+    }
+    SDL_AtomicSet(&_isBusy, 0);
+  }
+}
+
+static bool Start(void)
+{
+  _requestAvailable = SDL_CreateSemaphore(0);
+  if (_requestAvailable == NULL)
+  {
+    LogError("SDL_CreateSemaphore failed: %s", SDL_GetError());
+    return false;
+  }
+
+  SDL_AtomicSet(&_isStopping, 0);
+  _thread = SDL_CreateThread(ScreenshotThread, "Screenshot", NULL);
+  if (_thread == NULL)
+  {
+    LogError("SDL_CreateThread failed: %s", SDL_GetError());
+    SDL_DestroySemaphore(_requestAvailable);
+    _requestAvailable = NULL;
+    return false;
+  }
+  return true;
+}
+
+bool Screenshot_Save(const SDL_Surface *surface, uint32_t frameNumber)
+{
+  if (_thread == NULL && !Start())
+  {
+    return false;
+  }
+
+  if (!SDL_AtomicCAS(&_isBusy, 0, 1))
+  {
+    LogError("Still saving the previous screenshot");
+    return false;
+  }
+
+  size_t size = (size_t) surface->w * surface->h * 4;
+  if (size > _pixelsCapacity)
+  {
+    uint8_t *pixels = realloc(_pixels, size);
+    if (pixels == NULL)
+    {
+      LogError("Unable to allocate the screenshot buffer");
+      SDL_AtomicSet(&_isBusy, 0);
+      return false;
+    }
+    _pixels = pixels;
+    _pixelsCapacity = size;
+  }
+
+  _width = (uint16_t) surface->w;
+  _height = (uint16_t) surface->h;
+  for (uint16_t y = 0; y < _height; y++)
+  {
+    memcpy(&_pixels[(size_t) y * _width * 4], (const uint8_t*) surface->pixels + (size_t) y * surface->pitch, (size_t) _width * 4);
+  }
+
+  time_t now = time(NULL);
+  struct tm *local = localtime(&now);
+  size_t length = strftime(_fileName, sizeof(_fileName), "screenshot-%Y%m%d-%H%M%S", local);
+  snprintf(&_fileName[length], sizeof(_fileName) - length, "-f%06u.png", frameNumber);
+
+  SDL_SemPost(_requestAvailable);
+  return true;
+}
+
+void Screenshot_Stop(void)
+{
+  if (_thread == NULL)
+  {
+    return;
+  }
+
+  // Let a screenshot in progress finish first
+  while (SDL_AtomicGet(&_isBusy))
+  {
+    SDL_Delay(1);
+  }
+  SDL_AtomicSet(&_isStopping, 1);
+  SDL_SemPost(_requestAvailable);
+  SDL_WaitThread(_thread, NULL);
+  _thread = NULL;
+
+  SDL_DestroySemaphore(_requestAvailable);
+  _requestAvailable = NULL;
+  free(_pixels);
+  _pixels = NULL;
+  _pixelsCapacity = 0;
+}
@@ -0,0 +1,27 @@
+/*
+ * Screenshot.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_SHARED_SCREENSHOT_H_
+#define SRC_SHARED_SCREENSHOT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+// Saves screenshots as PNG on a worker thread. Saving only copies the pixels,
+// encoding and writing happen on the worker. One screenshot can be in progress
+// at a time, a new one is refused until the previous is written. Files are
+// named screenshot-<date>-<time>-f<frame>.png. Not thread safe, only call from
+// one thread.
+
+// The surface has to be SDL_PIXELFORMAT_RGBA32
+bool Screenshot_Save(const SDL_Surface *surface, uint32_t frameNumber);
+
+// Waits for a screenshot in progress and stops the worker
+void Screenshot_Stop(void);
+
+#endif /* SRC_SHARED_SCREENSHOT_H_ */
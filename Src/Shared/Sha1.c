@@ -0,0 +1,143 @@
+/*
+ * Sha1.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Sha1.h"
+#include <string.h>
+
+static inline uint32_t RotateLeft(uint32_t value, uint8_t bits)
+{
+  return (value << bits) | (value >> (32 - bits));
+}
+
+static void ProcessBlock(uint32_t state[5], const uint8_t *block)
+{
+  uint32_t w[80];
+
+  for (uint8_t i = 0; i < 16; i++)
+  {
+    w[i] = ((uint32_t) block[i * 4] << 24) | ((uint32_t) block[i * 4 + 1] << 16) | ((uint32_t) block[i * 4 + 2] << 8) | block[i * 4 + 3];
+  }
+  for (uint8_t i = 16; i < 80; i++)
+  {
+    w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+  }
+
+  uint32_t a = state[0];
+  uint32_t b = state[1];
+  uint32_t c = state[2];
+  uint32_t d = state[3];
+  uint32_t e = state[4];
+
+  for (uint8_t i = 0; i < 80; i++)
+  {
+    uint32_t f;
+    uint32_t k;
+    if (i < 20)
+    {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999;
+    }
+    else if (i < 40)
+    {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1;
+    }
+    else if (i < 60)
+    {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDC;
+    }
+    else
+    {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6;
+    }
+
+    uint32_t temp = RotateLeft(a, 5) + f + e + k + w[i];
+    e = d;
+    d = c;
+    c = RotateLeft(b, 30);
+    b = a;
+    a = temp;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+void Sha1_Initialize(Sha1_t *sha1)
+{
+  sha1->State[0] = 0x67452301;
+  sha1->State[1] = 0xEFCDAB89;
+  sha1->State[2] = 0x98BADCFE;
+  sha1->State[3] = 0x10325476;
+  sha1->State[4] = 0xC3D2E1F0;
+  sha1->Size = 0;
+}
+
+void Sha1_Update(Sha1_t *sha1, const void *data, size_t size)
+{
+  const uint8_t *bytes = data;
+  size_t used = sha1->Size % 64;
+
+  sha1->Size += size;
+
+  // Complete a partial block first, then whole blocks straight from the input
+  if (used > 0)
+  {
+    size_t fill = 64 - used < size ? 64 - used : size;
+    memcpy(&sha1->Block[used], bytes, fill);
+    bytes += fill;
+    size -= fill;
+    if (used + fill < 64)
+    {
+      return;
+    }
+    ProcessBlock(sha1->State, sha1->Block);
+  }
+  while (size >= 64)
+  {
+    ProcessBlock(sha1->State, bytes);
+    bytes += 64;
+    size -= 64;
+  }
+  memcpy(sha1->Block, bytes, size);
+}
+
+void Sha1_Finish(Sha1_t *sha1, uint8_t digest[SHA1_DIGEST_SIZE])
+{
+  uint64_t bits = sha1->Size * 8;
+  uint8_t padding[72] = { 0x80 };
+  size_t used = sha1->Size % 64;
+  // Pad to 56 bytes in the last block, then the length big endian
+  size_t paddingSize = used < 56 ? 56 - used : 120 - used;
+
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    padding[paddingSize + i] = (uint8_t) (bits >> (56 - i * 8));
+  }
+  Sha1_Update(sha1, padding, paddingSize + 8);
+
+  for (uint8_t i = 0; i < 5; i++)
+  {
+    digest[i * 4 + 0] = (uint8_t) (sha1->State[i] >> 24);
+    digest[i * 4 + 1] = (uint8_t) (sha1->State[i] >> 16);
+    digest[i * 4 + 2] = (uint8_t) (sha1->State[i] >> 8);
+    digest[i * 4 + 3] = (uint8_t) sha1->State[i];
+  }
+}
+
+void Sha1_Calculate(const void *data, size_t size, uint8_t digest[SHA1_DIGEST_SIZE])
+{
+  Sha1_t sha1;
+  Sha1_Initialize(&sha1);
+  Sha1_Update(&sha1, data, size);
+  Sha1_Finish(&sha1, digest);
+}
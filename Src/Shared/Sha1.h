@@ -0,0 +1,33 @@
+/*
+ * Sha1.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_SHARED_SHA1_H_
+#define SRC_SHARED_SHA1_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA1_DIGEST_SIZE    (20)
+
+// SHA-1, only meant for identifying files like ROM databases do
+typedef struct
+{
+  uint32_t State[5];
+  uint64_t Size;          // Total bytes fed in so far
+  uint8_t Block[64];      // Partial block waiting for more data
+} Sha1_t;
+
+void Sha1_Initialize(Sha1_t *sha1);
+
+void Sha1_Update(Sha1_t *sha1, const void *data, size_t size);
+
+void Sha1_Finish(Sha1_t *sha1, uint8_t digest[SHA1_DIGEST_SIZE]);
+
+// Digest of a single buffer
+void Sha1_Calculate(const void *data, size_t size, uint8_t digest[SHA1_DIGEST_SIZE]);
+
+#endif /* SRC_SHARED_SHA1_H_ */
@@ -8,13 +8,20 @@
 
 #include <SDL2/SDL.h>
 #include "log.h"
+#include "SpscQueue.h"
+#include "Trace.h"
 #include <stdio.h>
+
+#define EVENT_QUEUE_CAPACITY    (256)   // Events that can be waiting for the emulation thread
+
 typedef struct
 {
   int windowWidth;
   int windowHeight;
   const char* windowTitle;
   int targetFrameTime_ms;
+  uint32_t updateRateNumerator;     // Updates per second as a fraction
+  uint32_t updateRateDenominator;
   SharedSDL_PreStart preStart;
   SharedSDL_Update update;
   SharedSDL_Draw draw;
@@ -22,18 +29,18 @@ typedef struct
   SharedSDL_GetAudioSamples getAudioSamples;
 } ControlBlock_t;
 
-uint64_t _perfTimerStack[NR_OF_PERF_COUNTERS];
-uint64_t _perfTimerAccum[NR_OF_PERF_COUNTERS];
-uint32_t _perfTimerCount[NR_OF_PERF_COUNTERS];
-unsigned int _perfTimerStackIndex;
-
 static SDL_AudioDeviceID _audioDevice;
 static SDL_AudioSpec _audioSpec;
 
 static ControlBlock_t _controlBlock;
 
+static SpscQueue_t _eventQueue;     // Events from the SDL thread to the emulation thread
+static SDL_atomic_t _isRunning;     // Cleared by either thread to stop both
+
 static void AudioCallback(void *userdata, uint8_t *stream, int len);
 
+static int EmulationThread(void *data);
+
 void SharedSDL_Initialize(int windowWidth,
                           int windowHeight,
                           const char* windowTitle,
@@ -52,6 +59,14 @@ void SharedSDL_Initialize(int windowWidth,
   _controlBlock.userEventHandler = eventHandler;
   _controlBlock.getAudioSamples = audioCallback;
   _controlBlock.targetFrameTime_ms = 16;
+  _controlBlock.updateRateNumerator = 60;
+  _controlBlock.updateRateDenominator = 1;
+}
+
+void SharedSDL_SetUpdateRate(uint32_t numerator, uint32_t denominator)
+{
+  _controlBlock.updateRateNumerator = numerator;
+  _controlBlock.updateRateDenominator = denominator;
 }
 
 int SharedSDL_Start()
@@ -90,7 +105,7 @@ int SharedSDL_Start()
   want.freq = 44100;
   want.format = AUDIO_S32;
   want.channels = 1;
-  want.samples = 1024;
+  want.samples = 256;
   want.callback = AudioCallback;
 
   _audioDevice = SDL_OpenAudioDevice(NULL, 0, &want, &_audioSpec, 0);
@@ -107,16 +122,29 @@ int SharedSDL_Start()
     _controlBlock.preStart();
   }
 
+  if (!SpscQueue_Initialize(&_eventQueue, sizeof(SDL_Event), EVENT_QUEUE_CAPACITY))
+  {
+    goto close_audio_on_error;
+  }
+
   SDL_Event event;
-  bool run = true;
-  float deltaTime = 1.0 / 60;
+  SDL_Thread *emulationThread;
   uint32_t frameStartTicks;
-  uint32_t frameEndTicks;
   uint32_t frameTickDuration;
 
   LogMessage("PerfCounterFrequency = %lu", SDL_GetPerformanceFrequency());
 
-  while (run)
+  // Update runs on its own thread, this thread only handles events and presents
+  SDL_AtomicSet(&_isRunning, 1);
+  emulationThread = SDL_CreateThread(EmulationThread, "Emulation", NULL);
+  if (emulationThread == NULL)
+  {
+    LogError("Unable to create emulation thread, Error: %s", SDL_GetError());
+    goto destroy_queue_on_error;
+  }
+
+  Trace_NameThread("Main");
+  while (SDL_AtomicGet(&_isRunning))
   {
     frameStartTicks = SDL_GetTicks();
 
@@ -125,22 +153,15 @@ int SharedSDL_Start()
       switch (event.type)
       {
       case SDL_QUIT:
-        run = false;
+        SDL_AtomicSet(&_isRunning, 0);
         break;
       default:
         break;
       }
-      if (_controlBlock.userEventHandler != NULL)
-      {
-        _controlBlock.userEventHandler(&event);
-      }
-    }
-
-    if (_controlBlock.update != NULL)
-    {
-      if (false == _controlBlock.update(deltaTime))
+      // Handled on the emulation thread
+      if (!SpscQueue_Push(&_eventQueue, &event))
       {
-        run = false;
+        LogWarning("Event queue full, dropping event %u", event.type);
       }
     }
 
@@ -148,42 +169,90 @@ int SharedSDL_Start()
 
     if (_controlBlock.draw != NULL)
     {
+      Trace_Begin("draw");
       _controlBlock.draw(windowSurface);
+      Trace_End("draw");
     }
 
-    frameEndTicks = SDL_GetTicks();
-    frameTickDuration = frameEndTicks - frameStartTicks;
+    Trace_Begin("present");
+    SDL_UpdateWindowSurface(window);
+    Trace_End("present");
+
+    frameTickDuration = SDL_GetTicks() - frameStartTicks;
     if (frameTickDuration < _controlBlock.targetFrameTime_ms)
     {
-      deltaTime = _controlBlock.targetFrameTime_ms / 1000.0;
+      Trace_Begin("delay");
       SDL_Delay(_controlBlock.targetFrameTime_ms - frameTickDuration);
+      Trace_End("delay");
     }
-    else
+  }
+
+  SDL_WaitThread(emulationThread, NULL);
+  destroy_queue_on_error:
+  SpscQueue_Destroy(&_eventQueue);
+  close_audio_on_error:
+  SDL_CloseAudioDevice(_audioDevice);
+  close_window_on_error:
+  SDL_DestroyWindow(window);
+  quit_on_error:
+  SDL_Quit();
+
+  return 0;
+}
+
+static int EmulationThread(void *data)
+{
+  SDL_Event event;
+  const uint64_t frequency = SDL_GetPerformanceFrequency();
+  const double period = (double) frequency * _controlBlock.updateRateDenominator / _controlBlock.updateRateNumerator;
+  float deltaTime = period / frequency;
+  double deadline = SDL_GetPerformanceCounter();
+  uint64_t now;
+
+  Trace_NameThread("Emulation");
+  while (SDL_AtomicGet(&_isRunning))
+  {
+    while (SpscQueue_Pop(&_eventQueue, &event))
     {
-      deltaTime = frameTickDuration / 1000.0;
+      if (_controlBlock.userEventHandler != NULL)
+      {
+        _controlBlock.userEventHandler(&event);
+      }
     }
 
-    SDL_UpdateWindowSurface(window);
-
-#if ENABLE_PERF_TIMING
-    for(uint_fast8_t i = 0; i < NR_OF_PERF_COUNTERS; i++)
+    if (_controlBlock.update != NULL)
     {
-      printf("%I64u, ", _perfTimerAccum[i]);
-      SharedSDL_ResetTiming(i);
+      if (false == _controlBlock.update(deltaTime))
+      {
+        SDL_AtomicSet(&_isRunning, 0);
+      }
     }
 
-    printf("\n");
-#endif
+    // Updates are paced on an absolute deadline, so oversleeping one update is
+    // made up by the next and the average rate is exact. The audio is produced
+    // at this rate and only corrected by a fraction of a percent.
+    deadline += period;
+    now = SDL_GetPerformanceCounter();
+    if (now < deadline)
+    {
+      deltaTime = period / frequency;
+      Trace_Begin("delay");
+      SDL_Delay((uint32_t) ((deadline - now) * 1000 / frequency));
+      Trace_End("delay");
+    }
+    else
+    {
+      // Running behind by more than an update, don't try to catch up
+      deltaTime = (now - deadline + period) / frequency;
+      if (now - deadline > period)
+      {
+        deadline = now;
+      }
+    }
 
     fflush(stdout);
   }
 
-  SDL_CloseAudioDevice(_audioDevice);
-  close_window_on_error:
-  SDL_DestroyWindow(window);
-  quit_on_error:
-  SDL_Quit();
-
   return 0;
 }
 
@@ -197,36 +266,10 @@ void SharedSDL_StartAudio()
   SDL_PauseAudioDevice(_audioDevice, 0);
 }
 
-#if ENABLE_PERF_TIMING
-void SharedSDL_BeginTiming(unsigned int index)
-{
-  _perfTimerStack[index] = SDL_GetPerformanceCounter();
-}
-
-void SharedSDL_EndTiming(unsigned int index)
+int SharedSDL_GetAudioSampleRate()
 {
-  uint64_t delta = SDL_GetPerformanceCounter() - _perfTimerStack[index];
-  _perfTimerAccum[index] += delta;
-  _perfTimerCount[index]++;
-}
-
-void SharedSDL_ResetTiming(unsigned int index)
-{
-  _perfTimerAccum[index] = 0;
-  _perfTimerCount[index] = 0;
-}
-
-void SharedSDL_PrintTiming(unsigned int index, const char *name)
-{
-  uint64_t avg = 0;
-  if (_perfTimerCount[index] != 0)
-  {
-    avg = _perfTimerAccum[index] / _perfTimerCount[index];
-  }
-
-  LogMessage("[%s] Avg: %lu Total: %lu", name, avg, _perfTimerAccum[index]);
+  return _audioSpec.freq;
 }
-#endif
 
 SDL_Surface* SharedSDL_LoadImage(const char* filepath)
 {
@@ -241,5 +284,8 @@ SDL_Surface* SharedSDL_LoadImage(const char* filepath)
 
 static void AudioCallback(void *userdata, uint8_t *stream, int len)
 {
+  Trace_NameThread("Audio");
+  Trace_Begin("audio callback");
   _controlBlock.getAudioSamples(_audioDevice, (int32_t*) stream, len / sizeof(int32_t), _audioSpec.freq);
+  Trace_End("audio callback");
 }
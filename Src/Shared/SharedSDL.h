@@ -11,22 +11,9 @@
 #include <stdbool.h>
 #include <SDL2/SDL.h>
 
-#define ENABLE_PERF_TIMING      (0)
-
-typedef enum
-{
-  PERF_INDEX_PPU,
-  PERF_INDEX_CPU,
-  PERF_INDEX_EMULATE,
-  PERF_INDEX_PPU_BG_FETCH,
-  PERF_INDEX_PPU_SPRITE_EVAL,
-  PERF_INDEX_PPU_SPRITE_FETCH,
-  PERF_INDEX_PPU_ORDERING,
-  PERF_INDEX_PPU_INCREMENTS,
-  PERF_INDEX_PPU_PIXEL_OUT,
-  NR_OF_PERF_COUNTERS
-} PerfIndex_t;
-
+// PreStart and Draw are called on the main SDL thread. Update and the event
+// handler are called on a separate emulation thread, events are forwarded to it
+// through a queue. Draw must only use data published by Update for that reason.
 typedef void (*SharedSDL_PreStart)(void);
 typedef bool (*SharedSDL_Update)(float);
 typedef void (*SharedSDL_Draw)(SDL_Surface*);
@@ -42,29 +29,17 @@ void SharedSDL_Initialize(int windowWidth,
                           SharedSDL_EventHandler eventHandler,
                           SharedSDL_GetAudioSamples audioCallback);
 
+// Rate the emulation thread calls Update at, 60 per second unless set
+void SharedSDL_SetUpdateRate(uint32_t numerator, uint32_t denominator);
+
 int SharedSDL_Start();
 
 void SharedSDL_StopAudio();
 
 void SharedSDL_StartAudio();
 
-SDL_Surface* SharedSDL_LoadImage(const char* filepath);
-
-#if ENABLE_PERF_TIMING
-void SharedSDL_BeginTiming(unsigned int index);
+int SharedSDL_GetAudioSampleRate();
 
-void SharedSDL_EndTiming(unsigned int index);
-
-void SharedSDL_ResetTiming(unsigned int index);
-
-void SharedSDL_PrintTiming(unsigned int index, const char *name);
-#else
-#define SharedSDL_BeginTiming(index)
-
-#define SharedSDL_EndTiming(index)
-
-#define SharedSDL_ResetTiming(index)
+SDL_Surface* SharedSDL_LoadImage(const char* filepath);
 
-#define SharedSDL_PrintTiming(index, name)
-#endif
 #endif /* SRC_SHARED_SHAREDSDL_H_ */
@@ -0,0 +1,82 @@
+/*
+ * SpscQueue.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "SpscQueue.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool SpscQueue_Initialize(SpscQueue_t *queue, size_t elementSize, uint32_t capacity)
+{
+  memset(queue, 0, sizeof(*queue));
+
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+  {
+    LogError("Queue capacity %u is not a power of two", capacity);
+    return false;
+  }
+
+  queue->Buffer = malloc(elementSize * capacity);
+  if (queue->Buffer == NULL)
+  {
+    LogError("Unable to allocate queue of %u elements", capacity);
+    return false;
+  }
+
+  queue->Capacity = capacity;
+  queue->ElementSize = elementSize;
+  SDL_AtomicSet(&queue->Head, 0);
+  SDL_AtomicSet(&queue->Tail, 0);
+  return true;
+}
+
+void SpscQueue_Destroy(SpscQueue_t *queue)
+{
+  free(queue->Buffer);
+  queue->Buffer = NULL;
+  queue->Capacity = 0;
+}
+
+bool SpscQueue_Push(SpscQueue_t *queue, const void *element)
+{
+  // Head and Tail run freely and wrap around, only their difference matters
+  uint32_t head = (uint32_t) SDL_AtomicGet(&queue->Head);
+  uint32_t tail = (uint32_t) SDL_AtomicGet(&queue->Tail);
+
+  if (head - tail >= queue->Capacity)
+  {
+    // Full
+    return false;
+  }
+
+  memcpy(queue->Buffer + (head & (queue->Capacity - 1)) * queue->ElementSize, element, queue->ElementSize);
+  // Publish the element, the atomic store orders it after the copy
+  SDL_AtomicSet(&queue->Head, (int) (head + 1));
+  return true;
+}
+
+bool SpscQueue_Pop(SpscQueue_t *queue, void *element)
+{
+  uint32_t tail = (uint32_t) SDL_AtomicGet(&queue->Tail);
+  uint32_t head = (uint32_t) SDL_AtomicGet(&queue->Head);
+
+  if (head == tail)
+  {
+    // Empty
+    return false;
+  }
+
+  memcpy(element, queue->Buffer + (tail & (queue->Capacity - 1)) * queue->ElementSize, queue->ElementSize);
+  // Release the slot back to the producer
+  SDL_AtomicSet(&queue->Tail, (int) (tail + 1));
+  return true;
+}
+
+uint32_t SpscQueue_GetCount(SpscQueue_t *queue)
+{
+  return (uint32_t) SDL_AtomicGet(&queue->Head) - (uint32_t) SDL_AtomicGet(&queue->Tail);
+}
@@ -0,0 +1,37 @@
+/*
+ * SpscQueue.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_SHARED_SPSCQUEUE_H_
+#define SRC_SHARED_SPSCQUEUE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+// Lock-free queue for exactly one producer thread and one consumer thread.
+// Elements are copied in and out, the capacity must be a power of two.
+typedef struct
+{
+  SDL_atomic_t Head;      // Index of the next element to write, only written by the producer
+  SDL_atomic_t Tail;      // Index of the next element to read, only written by the consumer
+  uint32_t Capacity;      // Number of elements that fit in the queue
+  size_t ElementSize;     // Size of a single element in bytes
+  uint8_t *Buffer;        // Storage for Capacity elements
+} SpscQueue_t;
+
+bool SpscQueue_Initialize(SpscQueue_t *queue, size_t elementSize, uint32_t capacity);
+
+void SpscQueue_Destroy(SpscQueue_t *queue);
+
+bool SpscQueue_Push(SpscQueue_t *queue, const void *element);
+
+bool SpscQueue_Pop(SpscQueue_t *queue, void *element);
+
+uint32_t SpscQueue_GetCount(SpscQueue_t *queue);
+
+#endif /* SRC_SHARED_SPSCQUEUE_H_ */
@@ -0,0 +1,160 @@
+/*
+ * Trace.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "Trace.h"
+#include "log.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RING_SIZE       (65536)     // Events per thread, power of two
+#define MAX_THREADS     (16)
+#define UNSAFE_EVENTS   (1024)      // Oldest events of a full ring that the writer may be overwriting
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+typedef struct
+{
+  const char *Name;
+  uint64_t Time;                // Performance counter
+  char Phase;                   // 'B' or 'E'
+} TraceEvent_t;
+
+typedef struct
+{
+  TraceEvent_t Events[RING_SIZE];
+  SDL_atomic_t NumEvents;       // Written ones, only the owning thread writes
+  const char *ThreadName;
+  int ThreadIndex;
+} TraceRing_t;
+
+volatile bool _isTracing;
+
+static TraceRing_t *_rings[MAX_THREADS];
+static SDL_atomic_t _numRings;
+static uint64_t _startTime;
+
+static THREAD_LOCAL TraceRing_t *_threadRing;
+static THREAD_LOCAL const char *_threadName;
+
+// Rings live until the process exits, a reader may look at them at any time
+static TraceRing_t* CreateRing(void)
+{
+  int index = SDL_AtomicAdd(&_numRings, 1);
+  if (index >= MAX_THREADS)
+  {
+    SDL_AtomicAdd(&_numRings, -1);
+    return NULL;
+  }
+
+  TraceRing_t *ring = calloc(1, sizeof(TraceRing_t));
+  if (ring == NULL)
+  {
+    return NULL;
+  }
+  ring->ThreadName = _threadName;
+  ring->ThreadIndex = index + 1;
+  SDL_AtomicSetPtr((void**) &_rings[index], ring);
+  return ring;
+}
+
+void Trace_Record(const char *name, char phase)
+{
+  TraceRing_t *ring = _threadRing;
+  if (ring == NULL)
+  {
+    ring = CreateRing();
+    if (ring == NULL)
+    {
+      return;
+    }
+    _threadRing = ring;
+  }
+
+  unsigned int index = (unsigned int) SDL_AtomicGet(&ring->NumEvents);
+  TraceEvent_t *event = &ring->Events[index & (RING_SIZE - 1)];
+  event->Name = name;
+  event->Time = SDL_GetPerformanceCounter();
+  event->Phase = phase;
+  // Publishes the event to a reader
+  SDL_AtomicSet(&ring->NumEvents, (int) (index + 1));
+}
+
+void Trace_NameThread(const char *name)
+{
+  _threadName = name;
+  if (_threadRing != NULL)
+  {
+    _threadRing->ThreadName = name;
+  }
+}
+
+void Trace_Start(void)
+{
+  if (_startTime == 0)
+  {
+    _startTime = SDL_GetPerformanceCounter();
+  }
+  _isTracing = true;
+}
+
+void Trace_Stop(void)
+{
+  _isTracing = false;
+}
+
+bool Trace_Write(const char *file)
+{
+  FILE *out = fopen(file, "w");
+  if (out == NULL)
+  {
+    LogError("Unable to open %s", file);
+    return false;
+  }
+
+  double microsecondsPerTick = 1e6 / SDL_GetPerformanceFrequency();
+  unsigned int numWritten = 0;
+  int numRings = SDL_AtomicGet(&_numRings);
+  fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"NES\"}}");
+  for (int i = 0; i < numRings && i < MAX_THREADS; i++)
+  {
+    TraceRing_t *ring = SDL_AtomicGetPtr((void**) &_rings[i]);
+    if (ring == NULL)
+    {
+      continue;
+    }
+    if (ring->ThreadName != NULL)
+    {
+      fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+              ring->ThreadIndex, ring->ThreadName);
+    }
+
+    unsigned int end = (unsigned int) SDL_AtomicGet(&ring->NumEvents);
+    unsigned int begin = end > RING_SIZE ? end - RING_SIZE + UNSAFE_EVENTS : 0;
+    for (unsigned int e = begin; e != end; e++)
+    {
+      const TraceEvent_t *event = &ring->Events[e & (RING_SIZE - 1)];
+      fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+              event->Name, event->Phase, ring->ThreadIndex, (event->Time - _startTime) * microsecondsPerTick);
+      numWritten++;
+    }
+  }
+  fprintf(out, "\n]}\n");
+
+  if (fclose(out) != 0)
+  {
+    LogError("Unable to write %s", file);
+    return false;
+  }
+  LogMessage("Wrote %u trace events to %s", numWritten, file);
+  return true;
+}
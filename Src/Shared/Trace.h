@@ -0,0 +1,49 @@
+/*
+ * Trace.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_SHARED_TRACE_H_
+#define SRC_SHARED_TRACE_H_
+
+#include <stdbool.h>
+
+// Records begin and end events for a timeline of what every thread is doing,
+// written in the Chrome trace format for chrome://tracing and Perfetto. Every
+// thread writes into a ring of its own, so recording takes no locks and the
+// oldest events are overwritten. While stopped an event site costs a single
+// branch. Event names must be string literals, only the pointer is kept.
+
+extern volatile bool _isTracing;
+
+void Trace_Record(const char *name, char phase);
+
+static inline void Trace_Begin(const char *name)
+{
+  if (_isTracing)
+  {
+    Trace_Record(name, 'B');
+  }
+}
+
+static inline void Trace_End(const char *name)
+{
+  if (_isTracing)
+  {
+    Trace_Record(name, 'E');
+  }
+}
+
+// Name shown for the calling thread, a string literal as well
+void Trace_NameThread(const char *name);
+
+void Trace_Start(void);
+
+void Trace_Stop(void);
+
+// Writes the events in the rings so far, recording can go on meanwhile
+bool Trace_Write(const char *file);
+
+#endif /* SRC_SHARED_TRACE_H_ */
@@ -0,0 +1,48 @@
+/*
+ * TripleBuffer.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "TripleBuffer.h"
+
+void TripleBuffer_Initialize(TripleBuffer_t *buffer)
+{
+  buffer->BackIndex = 0;
+  SDL_AtomicSet(&buffer->State, 1);
+  buffer->FrontIndex = 2;
+}
+
+int TripleBuffer_GetBackIndex(const TripleBuffer_t *buffer)
+{
+  return buffer->BackIndex;
+}
+
+void TripleBuffer_Publish(TripleBuffer_t *buffer)
+{
+  // Swap back and middle, the old middle is free to be overwritten since the
+  // consumer only ever reads the front buffer
+  int previous = SDL_AtomicSet(&buffer->State, buffer->BackIndex | TRIPLE_BUFFER_NEW_FLAG);
+  buffer->BackIndex = previous & 0x03;
+}
+
+int TripleBuffer_GetFrontIndex(TripleBuffer_t *buffer, bool *isNew)
+{
+  bool hasNewFrame = (SDL_AtomicGet(&buffer->State) & TRIPLE_BUFFER_NEW_FLAG) != 0;
+
+  if (hasNewFrame)
+  {
+    // Swap front and middle, if the producer published again in the meantime
+    // we simply get that even newer frame
+    int previous = SDL_AtomicSet(&buffer->State, buffer->FrontIndex);
+    buffer->FrontIndex = previous & 0x03;
+  }
+
+  if (isNew != NULL)
+  {
+    *isNew = hasNewFrame;
+  }
+
+  return buffer->FrontIndex;
+}
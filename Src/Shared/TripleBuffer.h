@@ -0,0 +1,35 @@
+/*
+ * TripleBuffer.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_SHARED_TRIPLEBUFFER_H_
+#define SRC_SHARED_TRIPLEBUFFER_H_
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+#define TRIPLE_BUFFER_NEW_FLAG    (0x04)    // Set in State when the middle buffer holds an unread frame
+
+// Lock-free triple buffer index bookkeeping for one producer and one consumer.
+// The caller owns the three buffers, this only hands out which one to use:
+// the producer always has a back buffer to write, the consumer always has a
+// complete front buffer to read and neither ever waits for the other.
+typedef struct
+{
+  SDL_atomic_t State;   // Index of the middle buffer, plus TRIPLE_BUFFER_NEW_FLAG
+  int BackIndex;        // Buffer being written, only used by the producer
+  int FrontIndex;       // Buffer being read, only used by the consumer
+} TripleBuffer_t;
+
+void TripleBuffer_Initialize(TripleBuffer_t *buffer);
+
+int TripleBuffer_GetBackIndex(const TripleBuffer_t *buffer);
+
+void TripleBuffer_Publish(TripleBuffer_t *buffer);
+
+int TripleBuffer_GetFrontIndex(TripleBuffer_t *buffer, bool *isNew);
+
+#endif /* SRC_SHARED_TRIPLEBUFFER_H_ */
@@ -0,0 +1,324 @@
+/*
+ * VideoCapture.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "VideoCapture.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define popen   _popen
+#define pclose  _pclose
+#define PIPE_MODE   "wb"
+#else
+#define PIPE_MODE   "w"
+#endif
+
+typedef struct
+{
+  uint32_t BufferIndex;         // Pool buffer holding the pixels
+  uint32_t FrameNumber;         // Relative to the first captured frame
+} VideoFrame_t;
+
+static inline uint8_t ToY(int r, int g, int b)
+{
+  // BT.601 studio range, 8 bit fixed point
+  return (uint8_t) (((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static inline uint8_t ToU(int r, int g, int b)
+{
+  return (uint8_t) (((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static inline uint8_t ToV(int r, int g, int b)
+{
+  return (uint8_t) (((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+static void ConvertToY4M(VideoCapture_t *capture, const uint8_t *rgba)
+{
+  uint16_t width = capture->Width;
+  uint16_t height = capture->Height;
+  uint16_t chromaWidth = (width + 1) / 2;
+  uint16_t chromaHeight = (height + 1) / 2;
+  uint8_t *yPlane = capture->Output + 6;    // After "FRAME\n"
+  uint8_t *uPlane = yPlane + width * height;
+  uint8_t *vPlane = uPlane + chromaWidth * chromaHeight;
+
+  for (uint32_t i = 0; i < (uint32_t) width * height; i++)
+  {
+    yPlane[i] = ToY(rgba[i * 4 + 0], rgba[i * 4 + 1], rgba[i * 4 + 2]);
+  }
+
+  // Chroma is averaged over blocks of 2x2 pixels
+  for (uint16_t cy = 0; cy < chromaHeight; cy++)
+  {
+    for (uint16_t cx = 0; cx < chromaWidth; cx++)
+    {
+      int r = 0;
+      int g = 0;
+      int b = 0;
+      int count = 0;
+      for (uint16_t y = cy * 2; y < cy * 2 + 2 && y < height; y++)
+      {
+        for (uint16_t x = cx * 2; x < cx * 2 + 2 && x < width; x++)
+        {
+          const uint8_t *pixel = &rgba[((uint32_t) y * width + x) * 4];
+          r += pixel[0];
+          g += pixel[1];
+          b += pixel[2];
+          count++;
+        }
+      }
+      uPlane[cy * chromaWidth + cx] = ToU(r / count, g / count, b / count);
+      vPlane[cy * chromaWidth + cx] = ToV(r / count, g / count, b / count);
+    }
+  }
+}
+
+static void WriteOutput(VideoCapture_t *capture)
+{
+  if (!capture->WriteFailed && fwrite(capture->Output, 1, capture->OutputSize, capture->File) != capture->OutputSize)
+  {
+    LogError("Video capture write failed, the rest of the capture is lost");
+    capture->WriteFailed = true;
+  }
+}
+
+static void WriteFrame(VideoCapture_t *capture, const VideoFrame_t *frame)
+{
+  // Repeat the last frame for frames that never arrived, keeps the frame rate constant
+  while (capture->FramesWritten > 0 && capture->NextFrameNumber < frame->FrameNumber)
+  {
+    WriteOutput(capture);
+    capture->FramesRepeated++;
+    capture->NextFrameNumber++;
+  }
+
+  const uint8_t *pixels = capture->Pool + (size_t) frame->BufferIndex * capture->Width * capture->Height * 4;
+  if (capture->Format == VIDEO_CAPTURE_FORMAT_Y4M)
+  {
+    ConvertToY4M(capture, pixels);
+  }
+  else
+  {
+    memcpy(capture->Output, pixels, capture->OutputSize);
+  }
+
+  // The buffer can be reused as soon as it has been converted
+  SpscQueue_Push(&capture->FreeBuffers, &frame->BufferIndex);
+  if (capture->IsBlocking)
+  {
+    SDL_SemPost(capture->BuffersFreed);
+  }
+
+  WriteOutput(capture);
+  capture->FramesWritten++;
+  capture->NextFrameNumber = frame->FrameNumber + 1;
+}
+
+static int WriterThread(void *data)
+{
+  VideoCapture_t *capture = data;
+  VideoFrame_t frame;
+
+  for (;;)
+  {
+    SDL_SemWait(capture->FramesAvailable);
+
+    while (SpscQueue_Pop(&capture->FilledFrames, &frame))
+    {
+      WriteFrame(capture, &frame);
+    }
+
+    if (SDL_AtomicGet(&capture->IsStopping))
+    {
+      return 0;
+    }
+  }
+}
+
+static void CloseTarget(VideoCapture_t *capture)
+{
+  int result = capture->IsPipe ? pclose(capture->File) : fclose(capture->File);
+  if (result != 0)
+  {
+    LogError("Closing the video capture target failed");
+  }
+  capture->File = NULL;
+}
+
+static void FreeResources(VideoCapture_t *capture)
+{
+  if (capture->FramesAvailable != NULL)
+  {
+    SDL_DestroySemaphore(capture->FramesAvailable);
+  }
+  if (capture->BuffersFreed != NULL)
+  {
+    SDL_DestroySemaphore(capture->BuffersFreed);
+  }
+  SpscQueue_Destroy(&capture->FreeBuffers);
+  SpscQueue_Destroy(&capture->FilledFrames);
+  free(capture->Pool);
+  free(capture->Output);
+  capture->Pool = NULL;
+  capture->Output = NULL;
+}
+
+bool VideoCapture_Start(VideoCapture_t *capture,
+                        const char *target,
+                        uint16_t width,
+                        uint16_t height,
+                        uint32_t frameRateNumerator,
+                        uint32_t frameRateDenominator,
+                        VideoCaptureFormat_t format,
+                        bool isBlocking)
+{
+  memset(capture, 0, sizeof(*capture));
+  capture->Format = format;
+  capture->IsBlocking = isBlocking;
+  capture->Width = width;
+  capture->Height = height;
+  capture->FrameRateNumerator = frameRateNumerator;
+  capture->FrameRateDenominator = frameRateDenominator;
+
+  // Everything is allocated up front, capturing a frame never allocates
+  size_t frameSize = (size_t) width * height * 4;
+  if (format == VIDEO_CAPTURE_FORMAT_Y4M)
+  {
+    capture->OutputSize = 6 + (size_t) width * height + 2 * (size_t) ((width + 1) / 2) * ((height + 1) / 2);
+  }
+  else
+  {
+    capture->OutputSize = frameSize;
+  }
+  capture->Pool = malloc(frameSize * VIDEO_CAPTURE_POOL_FRAMES);
+  capture->Output = malloc(capture->OutputSize);
+  capture->FramesAvailable = SDL_CreateSemaphore(0);
+  capture->BuffersFreed = SDL_CreateSemaphore(0);
+  if (capture->Pool == NULL || capture->Output == NULL || capture->FramesAvailable == NULL || capture->BuffersFreed == NULL ||
+      !SpscQueue_Initialize(&capture->FreeBuffers, sizeof(uint32_t), VIDEO_CAPTURE_POOL_FRAMES) ||
+      !SpscQueue_Initialize(&capture->FilledFrames, sizeof(VideoFrame_t), VIDEO_CAPTURE_POOL_FRAMES))
+  {
+    LogError("Unable to allocate the video capture buffers");
+    FreeResources(capture);
+    return false;
+  }
+  for (uint32_t i = 0; i < VIDEO_CAPTURE_POOL_FRAMES; i++)
+  {
+    SpscQueue_Push(&capture->FreeBuffers, &i);
+  }
+  if (format == VIDEO_CAPTURE_FORMAT_Y4M)
+  {
+    memcpy(capture->Output, "FRAME\n", 6);
+  }
+
+  // A target starting with | is a command that gets the stream on its stdin
+  capture->IsPipe = target[0] == '|';
+  capture->File = capture->IsPipe ? popen(target + 1, PIPE_MODE) : fopen(target, "wb");
+  if (capture->File == NULL)
+  {
+    LogError("Unable to open video capture target %s", target);
+    FreeResources(capture);
+    return false;
+  }
+
+  if (format == VIDEO_CAPTURE_FORMAT_Y4M &&
+      fprintf(capture->File, "YUV4MPEG2 W%u H%u F%u:%u Ip A1:1 C420jpeg\n", width, height, frameRateNumerator, frameRateDenominator) < 0)
+  {
+    LogError("Unable to write video capture target %s", target);
+    CloseTarget(capture);
+    FreeResources(capture);
+    return false;
+  }
+
+  capture->Thread = SDL_CreateThread(WriterThread, "Video Capture", capture);
+  if (capture->Thread == NULL)
+  {
+    LogError("SDL_CreateThread failed: %s", SDL_GetError());
+    CloseTarget(capture);
+    FreeResources(capture);
+    return false;
+  }
+
+  capture->IsActive = true;
+  return true;
+}
+
+void VideoCapture_Stop(VideoCapture_t *capture)
+{
+  if (!capture->IsActive)
+  {
+    return;
+  }
+
+  // The writer drains the queue before it exits
+  SDL_AtomicSet(&capture->IsStopping, 1);
+  SDL_SemPost(capture->FramesAvailable);
+  SDL_WaitThread(capture->Thread, NULL);
+
+  CloseTarget(capture);
+  LogMessage("Video capture stopped, %u frames written, %u repeated, %u dropped",
+             capture->FramesWritten + capture->FramesRepeated,
+             capture->FramesRepeated,
+             VideoCapture_GetDroppedFrames(capture));
+
+  FreeResources(capture);
+  capture->IsActive = false;
+}
+
+void VideoCapture_SubmitFrame(VideoCapture_t *capture, const SDL_Surface *surface, uint32_t frameNumber)
+{
+  if (!capture->IsActive)
+  {
+    return;
+  }
+
+  if (!capture->HasFirstFrame)
+  {
+    capture->FirstFrameNumber = frameNumber;
+    capture->HasFirstFrame = true;
+  }
+  else if (frameNumber - capture->FirstFrameNumber < capture->NextSubmitNumber)
+  {
+    // Already have this frame, nothing was emulated since
+    return;
+  }
+  capture->NextSubmitNumber = frameNumber - capture->FirstFrameNumber + 1;
+
+  uint32_t bufferIndex;
+  while (!SpscQueue_Pop(&capture->FreeBuffers, &bufferIndex))
+  {
+    if (!capture->IsBlocking)
+    {
+      // Writer is behind, it repeats the previous frame in place of this one
+      SDL_AtomicIncRef(&capture->DroppedFrames);
+      return;
+    }
+    // Posts can be left over from buffers we didn't wait for, so check again after waking up
+    SDL_SemWait(capture->BuffersFreed);
+  }
+
+  uint8_t *pixels = capture->Pool + (size_t) bufferIndex * capture->Width * capture->Height * 4;
+  for (uint16_t y = 0; y < capture->Height; y++)
+  {
+    memcpy(&pixels[(size_t) y * capture->Width * 4],
+           (const uint8_t*) surface->pixels + (size_t) y * surface->pitch,
+           (size_t) capture->Width * 4);
+  }
+
+  VideoFrame_t frame = { bufferIndex, frameNumber - capture->FirstFrameNumber };
+  SpscQueue_Push(&capture->FilledFrames, &frame);
+  SDL_SemPost(capture->FramesAvailable);
+}
+
+uint32_t VideoCapture_GetDroppedFrames(VideoCapture_t *capture)
+{
+  return (uint32_t) SDL_AtomicGet(&capture->DroppedFrames);
+}
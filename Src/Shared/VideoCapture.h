@@ -0,0 +1,77 @@
+/*
+ * VideoCapture.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_SHARED_VIDEOCAPTURE_H_
+#define SRC_SHARED_VIDEOCAPTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include "SpscQueue.h"
+
+#define VIDEO_CAPTURE_POOL_FRAMES   (8)   // Preallocated frame buffers, power of two
+
+typedef enum
+{
+  VIDEO_CAPTURE_FORMAT_Y4M,     // YUV4MPEG2 with 4:2:0 BT.601 frames
+  VIDEO_CAPTURE_FORMAT_RGBA,    // Headerless RGBA frames, one after the other
+} VideoCaptureFormat_t;
+
+// Streams frames to a file, stdout ("-") or a command ("|ffmpeg ..."). Frames
+// are copied into a fixed pool of buffers and written by a separate thread. If
+// no buffer is free the frame is dropped, or when blocking the emulation waits
+// for one so every frame is written. The output has a constant frame rate,
+// gaps in the frame numbers are filled by repeating the previous frame so the
+// output stays in sync with audio captured over the same frames.
+typedef struct
+{
+  SpscQueue_t FreeBuffers;      // Buffer indices the emulation can fill, writer to emulation
+  SpscQueue_t FilledFrames;     // Frames waiting to be written, emulation to writer
+  SDL_sem *FramesAvailable;
+  SDL_sem *BuffersFreed;        // Only posted when blocking
+  SDL_Thread *Thread;
+  SDL_atomic_t IsStopping;
+  SDL_atomic_t DroppedFrames;
+  FILE *File;
+  bool IsPipe;
+  VideoCaptureFormat_t Format;
+  bool IsBlocking;              // Wait for a free buffer instead of dropping the frame
+  uint16_t Width;
+  uint16_t Height;
+  uint32_t FrameRateNumerator;
+  uint32_t FrameRateDenominator;
+  uint8_t *Pool;                // VIDEO_CAPTURE_POOL_FRAMES frames of Width * Height RGBA pixels
+  uint8_t *Output;              // Writer only, last frame in output format
+  size_t OutputSize;
+  uint32_t NextFrameNumber;     // Writer only, frame number the next written frame gets
+  uint32_t FramesWritten;       // Writer only until stopped
+  uint32_t FramesRepeated;      // Writer only until stopped
+  bool WriteFailed;             // Writer only until stopped
+  uint32_t FirstFrameNumber;    // Emulation only, frame number at the start of the capture
+  uint32_t NextSubmitNumber;    // Emulation only, relative number of the next new frame
+  bool HasFirstFrame;           // Emulation only
+  bool IsActive;                // Emulation only
+} VideoCapture_t;
+
+bool VideoCapture_Start(VideoCapture_t *capture,
+                        const char *target,
+                        uint16_t width,
+                        uint16_t height,
+                        uint32_t frameRateNumerator,
+                        uint32_t frameRateDenominator,
+                        VideoCaptureFormat_t format,
+                        bool isBlocking);
+
+void VideoCapture_Stop(VideoCapture_t *capture);
+
+// The surface has to be SDL_PIXELFORMAT_RGBA32 and at least width x height
+void VideoCapture_SubmitFrame(VideoCapture_t *capture, const SDL_Surface *surface, uint32_t frameNumber);
+
+uint32_t VideoCapture_GetDroppedFrames(VideoCapture_t *capture);
+
+#endif /* SRC_SHARED_VIDEOCAPTURE_H_ */
@@ -0,0 +1,109 @@
+/*
+ * XxHash64.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#include "XxHash64.h"
+#include <string.h>
+
+#define PRIME1  (0x9E3779B185EBCA87ull)
+#define PRIME2  (0xC2B2AE3D27D4EB4Full)
+#define PRIME3  (0x165667B19E3779F9ull)
+#define PRIME4  (0x85EBCA77C2B2AE63ull)
+#define PRIME5  (0x27D4EB2F165667C5ull)
+
+static inline uint64_t RotateLeft(uint64_t value, unsigned int bits)
+{
+  return (value << bits) | (value >> (64 - bits));
+}
+
+// Unaligned little endian loads, compile to a single move on x86
+static inline uint64_t Read64(const uint8_t *p)
+{
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint32_t Read32(const uint8_t *p)
+{
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint64_t Round(uint64_t accumulator, uint64_t input)
+{
+  accumulator += input * PRIME2;
+  accumulator = RotateLeft(accumulator, 31);
+  return accumulator * PRIME1;
+}
+
+static inline uint64_t MergeRound(uint64_t hash, uint64_t accumulator)
+{
+  hash ^= Round(0, accumulator);
+  return hash * PRIME1 + PRIME4;
+}
+
+uint64_t XxHash64_Calculate(const void *data, size_t size, uint64_t seed)
+{
+  const uint8_t *p = data;
+  const uint8_t *end = p + size;
+  uint64_t hash;
+
+  if (size >= 32)
+  {
+    // Four independent lanes, the multiplies of one stripe overlap in the pipeline
+    uint64_t lane1 = seed + PRIME1 + PRIME2;
+    uint64_t lane2 = seed + PRIME2;
+    uint64_t lane3 = seed;
+    uint64_t lane4 = seed - PRIME1;
+    const uint8_t *limit = end - 32;
+    do
+    {
+      lane1 = Round(lane1, Read64(p));
+      lane2 = Round(lane2, Read64(p + 8));
+      lane3 = Round(lane3, Read64(p + 16));
+      lane4 = Round(lane4, Read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    hash = RotateLeft(lane1, 1) + RotateLeft(lane2, 7) + RotateLeft(lane3, 12) + RotateLeft(lane4, 18);
+    hash = MergeRound(hash, lane1);
+    hash = MergeRound(hash, lane2);
+    hash = MergeRound(hash, lane3);
+    hash = MergeRound(hash, lane4);
+  }
+  else
+  {
+    hash = seed + PRIME5;
+  }
+  hash += (uint64_t) size;
+
+  for (; p + 8 <= end; p += 8)
+  {
+    hash ^= Round(0, Read64(p));
+    hash = RotateLeft(hash, 27) * PRIME1 + PRIME4;
+  }
+  if (p + 4 <= end)
+  {
+    hash ^= (uint64_t) Read32(p) * PRIME1;
+    hash = RotateLeft(hash, 23) * PRIME2 + PRIME3;
+    p += 4;
+  }
+  for (; p < end; p++)
+  {
+    hash ^= *p * PRIME5;
+    hash = RotateLeft(hash, 11) * PRIME1;
+  }
+
+  // Avalanche
+  hash ^= hash >> 33;
+  hash *= PRIME2;
+  hash ^= hash >> 29;
+  hash *= PRIME3;
+  hash ^= hash >> 32;
+  return hash;
+}
@@ -0,0 +1,20 @@
+/*
+ * XxHash64.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: wouter
+ */
+
+#ifndef SRC_SHARED_XXHASH64_H_
+#define SRC_SHARED_XXHASH64_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// XXH64, gives the same results as the reference implementation. Not a
+// cryptographic hash, meant to detect changes in large buffers quickly. Data
+// in parts can be hashed by passing the previous result as the seed, which
+// gives a different value than hashing the whole at once.
+uint64_t XxHash64_Calculate(const void *data, size_t size, uint64_t seed);
+
+#endif /* SRC_SHARED_XXHASH64_H_ */
@@ -3,6 +3,18 @@
 #include <string.h>
 #include "log.h"
 
+static FILE* _stream;
+
+static FILE* GetStream(void)
+{
+    return _stream != NULL ? _stream : stdout;
+}
+
+void LogSetStream(FILE* stream)
+{
+    _stream = stream;
+}
+
 void LogMessage(const char* format, ...)
 {
     const char* prefix = "[I]  ";
@@ -16,7 +28,7 @@ void LogMessage(const char* format, ...)
 
     va_list args;
     va_start(args, format);
-    vprintf(newFormat, args);
+    vfprintf(GetStream(), newFormat, args);
     va_end(args);
 }
 void LogWarning(const char* format, ...)
@@ -32,7 +44,7 @@ void LogWarning(const char* format, ...)
 
     va_list args;
     va_start(args, format);
-    vprintf(newFormat, args);
+    vfprintf(GetStream(), newFormat, args);
     va_end(args);
 }
 void LogError(const char* format, ...)
@@ -48,6 +60,6 @@ void LogError(const char* format, ...)
 
     va_list args;
     va_start(args, format);
-    vprintf(newFormat, args);
+    vfprintf(GetStream(), newFormat, args);
     va_end(args);
 }
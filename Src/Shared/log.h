@@ -1,6 +1,11 @@
 #ifndef FNI_LOG_H
 #define FNI_LOG_H
 
+#include <stdio.h>
+
+// Logs go to stdout unless set otherwise, NULL goes back to stdout
+void LogSetStream(FILE* stream);
+
 void LogMessage(const char* format, ...);
 void LogWarning(const char* format, ...);
 void LogError(const char* format, ...);
@@ -8,10 +8,26 @@
 #include <SDL2/SDL.h>
 #include "SharedSDL.h"
 #include "Text.h"
+#include "TripleBuffer.h"
+#include "AudioRing.h"
+#include "AudioCapture.h"
+#include "VideoCapture.h"
+#include "Screenshot.h"
+#include "Profiler.h"
+#include "Trace.h"
+#include "Png.h"
+#include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 #include "log.h"
 #include "Nes/NES.h"
 #include "Nes/INesLoader.h"
@@ -21,6 +37,12 @@
 #include "Nes/Palette.h"
 #include "Nes/Controllers.h"
 #include "Nes/APU.h"
+#include "Nes/PPURenderer.h"
+#include "Nes/RomLibrary.h"
+#include "Nes/Movie.h"
+#include "Nes/FrameHash.h"
+#include "Nes/Metrics.h"
+#include "Nes/Debugger.h"
 
 static void Initialize(void);
 
@@ -32,6 +54,16 @@ static void Event(SDL_Event* event);
 
 static void AudioCallback(SDL_AudioDeviceID device, int32_t *samples, uint32_t numSamples, uint32_t sampleRate);
 
+static int RunHeadless(void);
+
+static int RunIndexer(void);
+
+static int RunThumbnails(void);
+
+static int RunBenchmark(void);
+
+static void StopMetrics(void);
+
 #define HALF_MEM_WINDOW_SIZE  7
 #define MEM2_WINDOW_SIZE      16
 
@@ -59,9 +91,65 @@ static void AudioCallback(SDL_AudioDeviceID device, int32_t *samples, uint32_t n
 #define MEMORY_VIEW_ROWS    8
 #define MEMORY_VIEW_CHARS_PER_ROW   ((MEMORY_VIEW_COLUMNS - 1) * 3 + 2 + 6)
 
+#define AUDIO_RING_SAMPLES  4096        // Samples that fit between the APU and the audio callback
+#define AUDIO_LATENCY_MS    30          // Fill level of the audio ring that is aimed for
+#define FAST_FORWARD_FRAMES 4           // Frames emulated per update while fast forwarding, only the last is rendered
+#define CAPTURE_FILE_NAME   "capture.wav"   // Audio capture toggled with the W key
+#define VIDEO_CAPTURE_FILE_NAME   "capture.y4m"   // Video capture toggled with the V key
+#define TRACE_FILE_NAME     "trace.json"    // Trace written with the T key
+#define NES_FRAME_RATE_NUMERATOR    39375000    // NTSC frame rate is 39375000 / 655171 = 60.0988 Hz
+#define NES_FRAME_RATE_DENOMINATOR  655171
+#define HEADLESS_SAMPLE_RATE  44100     // Audio sample rate without an audio device
+#define HEADLESS_FRAMES     600         // Frames run in headless mode when not given
+#define LIBRARY_INDEX_FILE_NAME   "library.idx"   // Index written in the library directory by --index
+#define THUMBNAIL_DIRECTORY_NAME  "thumbnails"    // Below the library directory, written by --thumbnails
+#define THUMBNAIL_SCALE     2           // Thumbnails are the NES screen downscaled by this factor
+#define MAX_START_PRESSES   8           // Scripted Start presses given with --press-start
+#define START_PRESS_FRAMES  5           // Frames Start is held down for a scripted press
+#define BENCHMARK_FRAMES    300         // Frames run per benchmark workload when not given
+
 #define OAM_VIEW_ENTRIES    22
 #define OAM_VIEW_CHARS_PER_ROW  25
 
+// A fixed piece of work for the benchmark, the ROM runs with the movie input
+typedef struct
+{
+  const char *Name;
+  const char *RomFile;
+  const char *MovieFile;        // NULL to run without input
+} BenchmarkWorkload_t;
+
+// What one run of a benchmark workload did
+typedef struct
+{
+  u32_t NumFrames;
+  double Seconds;
+  unsigned int NumInstructions;
+  unsigned int NumDots;
+  bool IsKilled;
+} BenchmarkPass_t;
+
+static const BenchmarkWorkload_t BENCHMARK_WORKLOADS[] =
+{
+    { "nestest", "Resources/nestest.nes", NULL },
+    { "nestest_movie", "Resources/nestest.nes", "Resources/movies/nestest.fm2" },
+    { "all_instrs", "Resources/instr_test-v5/all_instrs.nes", NULL },
+    { "instr_timing", "Resources/instr_timing/instr_timing.nes", NULL },
+    { "cpu_timing_test", "Resources/cpu_timing_test6/cpu_timing_test.nes", NULL },
+    { "cpu_interrupts", "Resources/cpu_interrupts_v2/cpu_interrupts.nes", NULL },
+    { "apu_test", "Resources/apu_test/apu_test.nes", NULL },
+    { "ppu_vbl_nmi", "Resources/ppu_vbl_nmi/ppu_vbl_nmi.nes", NULL },
+    { "ppu_sprite_hit", "Resources/ppu_sprite_hit/ppu_sprite_hit.nes", NULL },
+    { "oam_stress", "Resources/oam_stress/oam_stress.nes", NULL },
+    { "nmi_sync", "Resources/nmi_sync/demo_ntsc.nes", NULL },
+    { "ntsc_torture", "Resources/ntsc_torture.nes", NULL },
+    { "palette_ram", "Resources/palette_ram.nes", NULL },
+    { "sprite_ram", "Resources/sprite_ram.nes", NULL },
+    { "vram_access", "Resources/vram_access.nes", NULL },
+    { "vbl_clear_time", "Resources/vbl_clear_time.nes", NULL },
+    { "power_up_palette", "Resources/power_up_palette.nes", NULL },
+};
+
 typedef enum
 {
   DETAIL_MODE_CPU,
@@ -70,49 +158,360 @@ typedef enum
   NR_OF_DETAIL_MODES,
 } DetailMode_t;
 
+// Everything Draw shows, written by Update on the emulation thread and handed
+// over to the SDL thread through a triple buffer
+typedef struct
+{
+  SDL_Surface *Screen;          // Copy of the NES screen output
+  SDL_Surface *PatternTable;    // Pattern table view, valid if PatternTableIndex < 2
+  u8_t PatternTableIndex;
+  u8_t Palette[32];             // Palette RAM contents
+  DetailMode_t DetailMode;
+  bool IsRunning;
+  char StatusBar[STATUS_BAR_CHARS_PER_ROW * STATUS_BAR_ROWS + 1];
+  char MemText[HALF_MEM_WINDOW_SIZE * 2 + 1][128];
+  char MemoryView[MEMORY_VIEW_CHARS_PER_ROW * MEMORY_VIEW_ROWS + 1];
+  char OamView[OAM_VIEW_ENTRIES * OAM_VIEW_CHARS_PER_ROW + 1];
+} FrameView_t;
+
+// Command line options
+typedef struct
+{
+  const char *RomFile;          // ROM to load, NULL for the built in default
+  const char *WavFile;          // Capture audio to this file from the start, .raw for headerless PCM
+  const char *VideoTarget;      // Capture video to this file or "|command" from the start, .rgba for raw frames
+  const char *MovieFile;        // Play back controller input from this .fm2 movie
+  const char *RecordFile;       // Record controller input to this .fm2 movie
+  const char *TraceFile;        // Trace from the start and write it to this file on exit
+  const char *MetricsAddress;   // Serve metrics on this loopback port or unix:path
+  const char *HashFile;         // Write the hashes of every frame to this file in headless mode
+  const char *CompareFiles[2];  // Compare two hash files and exit
+  bool IsHeadless;              // Run without window or audio device
+  bool IsDeferred;              // Compose pixels on the renderer thread in headless mode
+  u32_t NumFrames;              // Frames to run in headless mode, 0 for the default or the movie length
+  const char *LibraryDirectory; // Index the ROMs in this directory and exit
+  const char *BenchmarkFile;    // Run the benchmark and append the results to this CSV file, - for stdout
+  const char *ThumbnailDirectory; // Write thumbnails for the ROMs in this directory and exit
+  u32_t NumThreads;             // Threads for batch work, 0 for one per CPU
+  u32_t StartPresses[MAX_START_PRESSES];  // Frames at which Start is pressed while making thumbnails
+  u8_t NumStartPresses;
+} Options_t;
+
 static Font_t _font;
-static char _statusBarBuffer[STATUS_BAR_CHARS_PER_ROW * STATUS_BAR_ROWS + 1];
 static char _textBuffer[128];
-static char _memTextBuffer[HALF_MEM_WINDOW_SIZE * 2 + 1][128];
-static char _memoryViewBuffer[MEMORY_VIEW_CHARS_PER_ROW * MEMORY_VIEW_ROWS + 1];
-static char _oamViewBuffer[OAM_VIEW_ENTRIES * OAM_VIEW_CHARS_PER_ROW + 1];
+static FrameView_t _frameViews[3];
+static TripleBuffer_t _frameViewBuffer;
 static Mapper_t _mapper;
 static bool _stepKeyWasPressed;
 static bool _frameStepKeyWasPressed;
 static bool _runKeyWasPressed;
 static bool _statusKeyWasPressed;
 static bool _run;
+static bool _fastForward;
 static bool _screenshotWasPressed;
+static bool _deferKeyWasPressed;
+static bool _captureKeyWasPressed;
+static bool _videoKeyWasPressed;
+static bool _traceKeyWasPressed;
+static bool _breakpointKeyWasPressed;
 static DetailMode_t _detailMode;
 static char _lastLoadedFileName[512];
 static SDL_Surface *_ppuRenderSurface;
 static u8_t _patternTableDrawIndex = 2;
-static SDL_Surface *_ppuPatternTableSurfaces[2];
 
 static bool _controller1Buttons[NR_OF_NES_BUTTONS];
 
+static AudioRing_t _audioRing;
+static int _audioSampleRate;
+static uint32_t _audioTargetFill;
+static AudioCapture_t _audioCapture;
+static VideoCapture_t _videoCapture;
+
+static Movie_t _movie;
+
+static Options_t _options;
+static MetricsInstance_t *_metrics;     // Of this process, NULL without --metrics
+
+static bool ParseOptions(int argc, char* argv[], Options_t *options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--headless") == 0)
+    {
+      options->IsHeadless = true;
+    }
+    else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+    {
+      options->NumFrames = (u32_t) strtoul(argv[++i], NULL, 10);
+    }
+    else if (strcmp(argv[i], "--wav") == 0 && i + 1 < argc)
+    {
+      options->WavFile = argv[++i];
+    }
+    else if (strcmp(argv[i], "--video") == 0 && i + 1 < argc)
+    {
+      options->VideoTarget = argv[++i];
+    }
+    else if (strcmp(argv[i], "--movie") == 0 && i + 1 < argc)
+    {
+      options->MovieFile = argv[++i];
+    }
+    else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+    {
+      options->RecordFile = argv[++i];
+    }
+    else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+    {
+      options->TraceFile = argv[++i];
+    }
+    else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+    {
+      options->MetricsAddress = argv[++i];
+    }
+    else if (strcmp(argv[i], "--break") == 0 && i + 1 < argc)
+    {
+      Debugger_SetBreakpoint((u16_t) strtoul(argv[++i], NULL, 16), true);
+    }
+    else if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc)
+    {
+      if (!Debugger_AddWatchpointFromString(argv[++i]))
+      {
+        return false;
+      }
+    }
+    else if (strcmp(argv[i], "--break-on") == 0 && i + 1 < argc)
+    {
+      i++;
+      u8_t interrupts = strcmp(argv[i], "nmi") == 0 ? DEBUGGER_INTERRUPT_NMI :
+                        strcmp(argv[i], "irq") == 0 ? DEBUGGER_INTERRUPT_IRQ : 0;
+      if (interrupts == 0)
+      {
+        LogError("Can only break on nmi or irq, not %s", argv[i]);
+        return false;
+      }
+      Debugger_SetBreakOnInterrupts(_debuggerInterrupts | interrupts);
+    }
+    else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc)
+    {
+      options->HashFile = argv[++i];
+    }
+    else if (strcmp(argv[i], "--compare") == 0 && i + 2 < argc)
+    {
+      options->CompareFiles[0] = argv[++i];
+      options->CompareFiles[1] = argv[++i];
+    }
+    else if (strcmp(argv[i], "--deferred") == 0)
+    {
+      options->IsDeferred = true;
+    }
+    else if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc)
+    {
+      options->BenchmarkFile = argv[++i];
+    }
+    else if (strcmp(argv[i], "--index") == 0 && i + 1 < argc)
+    {
+      options->LibraryDirectory = argv[++i];
+    }
+    else if (strcmp(argv[i], "--thumbnails") == 0 && i + 1 < argc)
+    {
+      options->ThumbnailDirectory = argv[++i];
+    }
+    else if (strcmp(argv[i], "--press-start") == 0 && i + 1 < argc && options->NumStartPresses < MAX_START_PRESSES)
+    {
+      options->StartPresses[options->NumStartPresses++] = (u32_t) strtoul(argv[++i], NULL, 10);
+    }
+    else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+    {
+      options->NumThreads = (u32_t) strtoul(argv[++i], NULL, 10);
+    }
+    else if (argv[i][0] != '-' && options->RomFile == NULL)
+    {
+      options->RomFile = argv[i];
+    }
+    else
+    {
+      LogError("Unknown option %s", argv[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
 int main(int argc, char* argv[])
 {
   int sdlReturnCode;
 
+  if (!ParseOptions(argc, argv, &_options))
+  {
+    LogMessage("Usage: %s [rom] [--headless] [--frames n] [--wav file] [--video file|\"|command\"] [--movie file.fm2] [--record file.fm2] [--trace file.json] [--metrics port|unix:path]", argv[0]);
+    LogMessage("       %s rom --headless [--movie file.fm2] [--hash file] [--deferred]", argv[0]);
+    LogMessage("       %s [rom] [--headless] [--break address]... [--watch cpu|ppu:start[-end]:rwx]... [--break-on nmi|irq]...", argv[0]);
+    LogMessage("       %s --compare hashfile hashfile", argv[0]);
+    LogMessage("       %s [rom [--movie file.fm2]] --benchmark file.csv|- [--frames n]", argv[0]);
+    LogMessage("       %s --index directory [--threads n]", argv[0]);
+    LogMessage("       %s --thumbnails directory [--frames n] [--press-start frame]... [--threads n] [--metrics port|unix:path]", argv[0]);
+    return -1;
+  }
+
+  if (_options.CompareFiles[0] != NULL)
+  {
+    return FrameHash_Compare(_options.CompareFiles[0], _options.CompareFiles[1]) ? 0 : 1;
+  }
+
+  if (_options.BenchmarkFile != NULL)
+  {
+    return RunBenchmark();
+  }
+
+  if (_options.LibraryDirectory != NULL)
+  {
+    return RunIndexer();
+  }
+
+  if (_options.ThumbnailDirectory != NULL)
+  {
+    return RunThumbnails();
+  }
+
+  if (_options.TraceFile != NULL)
+  {
+    Trace_Start();
+  }
+
+  if (_options.IsHeadless)
+  {
+    return RunHeadless();
+  }
+
   SharedSDL_Initialize(WINDOW_WIDTH, WINDOW_HEIGHT, "My Nes Emulator Thingy", Initialize, Update, Draw, Event, AudioCallback);
+  SharedSDL_SetUpdateRate(NES_FRAME_RATE_NUMERATOR, NES_FRAME_RATE_DENOMINATOR);
   sdlReturnCode = SharedSDL_Start();
 
+  // The emulation thread is gone, nothing produces samples or frames anymore
+  AudioCapture_Stop(&_audioCapture);
+  VideoCapture_Stop(&_videoCapture);
+  Screenshot_Stop();
+  Mapper_Teardown(&_mapper);
+  if (_options.RecordFile != NULL)
+  {
+    Movie_Save(&_movie, _options.RecordFile, _lastLoadedFileName);
+  }
+  Movie_Free(&_movie);
+  if (_options.TraceFile != NULL)
+  {
+    Trace_Write(_options.TraceFile);
+  }
+  StopMetrics();
+
   return sdlReturnCode;
 }
 
+static bool StartMetrics(u32_t numInstances)
+{
+  if (_options.MetricsAddress == NULL)
+  {
+    return true;
+  }
+  if (!Metrics_Initialize(numInstances))
+  {
+    return false;
+  }
+  if (!Metrics_StartServer(_options.MetricsAddress))
+  {
+    Metrics_Destroy();
+    return false;
+  }
+  _metrics = Metrics_GetInstance(0);
+  Metrics_ResetBaseline(_metrics);
+  return true;
+}
+
+static void StopMetrics(void)
+{
+  if (_metrics != NULL)
+  {
+    Metrics_StopServer();
+    Metrics_Destroy();
+    _metrics = NULL;
+  }
+}
+
 static bool HandleButton(u8_t controller, NESButton_t button)
 {
   return _controller1Buttons[button];
 }
 
-static void DrawPalettes(Bus_t *bus, SDL_Surface *surface, int startX, int startY)
+static bool HandleMovieButton(u8_t controller, NESButton_t button)
+{
+  return Movie_IsPressed(&_movie, controller, button);
+}
+
+// Loads the movie to play back, ROMs loaded afterwards start from a fixed state
+static bool StartMovie(void)
+{
+  if (_options.MovieFile != NULL && !Movie_Load(&_movie, _options.MovieFile))
+  {
+    return false;
+  }
+  if (_options.MovieFile != NULL || _options.RecordFile != NULL)
+  {
+    // Battery backed RAM would differ between runs
+    INesLoader_SetSaveFileEnabled(false);
+  }
+  return true;
+}
+
+// Latches the movie input for the next frame, or records the buttons for it.
+// While recording the game sees the recorded state, even when keys change mid frame.
+static void BeginMovieFrame(void)
+{
+  if (_options.MovieFile != NULL)
+  {
+    Movie_AdvanceFrame(&_movie);
+  }
+  else if (_options.RecordFile != NULL)
+  {
+    u8_t buttons = 0;
+    for (u8_t i = 0; i < NR_OF_NES_BUTTONS; i++)
+    {
+      buttons |= _controller1Buttons[i] << i;
+    }
+    Movie_Record(&_movie, buttons, 0);
+  }
+}
+
+// Emulates the rest of the frame, false when the debugger stopped it halfway.
+// The movie only advances when a new frame starts.
+static bool RunFrame(void)
+{
+  static bool isFrameStarted;
+
+  if (!isFrameStarted)
+  {
+    BeginMovieFrame();
+  }
+  NES_TickUntilFrameComplete();
+  isFrameStarted = _isDebuggerBreak;
+  return !_isDebuggerBreak;
+}
+
+static void LogBreak(void)
+{
+  CPU_t *cpu = NES_GetCPU();
+  char text[64];
+
+  Debugger_FormatBreak(text, sizeof(text));
+  LogMessage("%s, frame %u, PC:%04X A:%02X X:%02X Y:%02X S:%02X P:%02X", text, NES_GetPPU()->FrameCount,
+             cpu->PC, cpu->A, cpu->X, cpu->Y, cpu->S, cpu->P);
+}
+
+static void DrawPalettes(const u8_t *palette, SDL_Surface *surface, int startX, int startY)
 {
   // Draw all palette entries
   u8_t r;
   u8_t g;
   u8_t b;
-  u16_t address = 0x3F00;
+  u16_t address = 0;
   SDL_Rect rect;
   SDL_Rect bgRect;
 
@@ -130,7 +529,7 @@ static void DrawPalettes(Bus_t *bus, SDL_Surface *surface, int startX, int start
     SDL_FillRect(surface, &bgRect, SDL_MapRGB(surface->format, 255, 255, 255));
     for (int c = 0; c < 4; c++)
     {
-      u8_t paletteValue = Bus_ReadFromPPU(bus, address + c);
+      u8_t paletteValue = palette[address + c];
       Palette_GetRGB(paletteValue, &r, &g, &b);
       SDL_FillRect(surface, &rect, SDL_MapRGB(surface->format, r, g, b));
       rect.x += rect.w;
@@ -180,18 +579,608 @@ static void DrawPatternTable(Bus_t *bus, u16_t tableStart, SDL_Surface *surface)
   PPU_SetRenderSurface(_ppuRenderSurface);
 }
 
-static float _globalTime_s;
+// Blocking captures slow the emulation down to the writer instead of losing data
+static bool StartAudioCapture(const char *fileName, u32_t sampleRate, bool isBlocking)
+{
+  size_t length = strlen(fileName);
+  AudioCaptureFormat_t format = AUDIO_CAPTURE_FORMAT_WAV;
+  if (length >= 4 && strcmp(&fileName[length - 4], ".raw") == 0)
+  {
+    format = AUDIO_CAPTURE_FORMAT_RAW;
+  }
+
+  if (!AudioCapture_Start(&_audioCapture, fileName, sampleRate, format, isBlocking))
+  {
+    return false;
+  }
+  LogMessage("Capturing audio to %s", fileName);
+  return true;
+}
+
+static bool StartVideoCapture(const char *target, bool isBlocking)
+{
+  size_t length = strlen(target);
+  VideoCaptureFormat_t format = VIDEO_CAPTURE_FORMAT_Y4M;
+  if (length >= 5 && strcmp(&target[length - 5], ".rgba") == 0)
+  {
+    format = VIDEO_CAPTURE_FORMAT_RGBA;
+  }
+
+  if (!VideoCapture_Start(&_videoCapture, target, NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT,
+                          NES_FRAME_RATE_NUMERATOR, NES_FRAME_RATE_DENOMINATOR, format, isBlocking))
+  {
+    return false;
+  }
+  LogMessage("Capturing video to %s", target);
+  return true;
+}
+
+static void HandleApuSamples(const int16_t *samples, u32_t numSamples)
+{
+  AudioCapture_Write(&_audioCapture, samples, numSamples);
+  AudioRing_Write(&_audioRing, samples, numSamples);
+
+  // Emulation and audio device clocks drift apart, slightly resample to stay near the target
+  double ratio = AudioRing_GetRateRatio(&_audioRing, _audioTargetFill);
+  APU_SetSampleRate(NES_GetAPU(), _audioSampleRate * ratio);
+}
 
 static void AudioCallback(SDL_AudioDeviceID device, int32_t *samples, uint32_t numSamples, uint32_t sampleRate)
 {
-  float dt = 1 / (float) sampleRate;
-  float globalTime_s = _globalTime_s;
-  for (uint32_t i = 0; i < numSamples; i++)
+  AudioRing_ReadS32(&_audioRing, samples, numSamples);
+}
+
+static bool StartSystem(const char *romFile)
+{
+  const char *paletteFile = "Resources/ntscpalette.pal";
+  CPU_t *cpu;
+
+  NES_Initialize();
+  if (!INesLoader_Load(romFile, &_mapper))
+  {
+    return false;
+  }
+  strncpy(_lastLoadedFileName, romFile, sizeof(_lastLoadedFileName) - 1);
+  Bus_SetMapper(NES_GetBus(), &_mapper);
+
+  Palette_LoadFrom(paletteFile);
+
+  // Run first instruction
+  cpu = NES_GetCPU();
+  CPU_Reset(cpu);
+  //cpu->PC = 0xC000; // nestest.nes auto mode
+  NES_TickClock();
+  NES_TickUntilCPUComplete();
+  if (_metrics != NULL)
+  {
+    Metrics_ResetBaseline(_metrics);
+  }
+  return true;
+}
+
+static void HandleHeadlessSamples(const int16_t *samples, u32_t numSamples)
+{
+  AudioCapture_Write(&_audioCapture, samples, numSamples);
+}
+
+// Emulates a fixed number of frames as fast as possible, without window or audio device
+static int RunHeadless(void)
+{
+  if (_options.RomFile == NULL)
+  {
+    LogError("Headless mode needs a ROM file");
+    return -1;
+  }
+  if (!StartMovie())
+  {
+    return -1;
+  }
+  Trace_NameThread("Emulation");
+  if (!StartSystem(_options.RomFile))
+  {
+    LogError("Unable to load NES ROM %s", _options.RomFile);
+    return -1;
+  }
+  if (!StartMetrics(1))
+  {
+    return -1;
+  }
+  if (_options.MovieFile != NULL)
+  {
+    Controllers_SetButtonHandler(0, HandleMovieButton);
+    Controllers_SetButtonHandler(1, HandleMovieButton);
+  }
+
+  if (_options.VideoTarget != NULL || _options.HashFile != NULL)
+  {
+    _ppuRenderSurface = SDL_CreateRGBSurfaceWithFormat(0, NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+    PPU_SetRenderSurface(_ppuRenderSurface);
+    if (_options.IsDeferred)
+    {
+      PPU_SetDeferredRendering(NES_GetPPU(), true);
+    }
+  }
+  else
+  {
+    // Nobody looks at the picture
+    PPU_SetSkipOutput(NES_GetPPU(), true);
+  }
+  // Every emulated frame has to end up in the capture, runs have to be reproducible
+  if (_options.VideoTarget != NULL && !StartVideoCapture(_options.VideoTarget, true))
+  {
+    return -1;
+  }
+
+  FILE *hashFile = NULL;
+  if (_options.HashFile != NULL)
+  {
+    hashFile = fopen(_options.HashFile, "w");
+    if (hashFile == NULL)
+    {
+      LogError("Unable to open %s", _options.HashFile);
+      return -1;
+    }
+  }
+
+  APU_SetSampleRate(NES_GetAPU(), HEADLESS_SAMPLE_RATE);
+  APU_SetSampleHandler(NES_GetAPU(), HandleHeadlessSamples);
+  if (_options.WavFile != NULL && !StartAudioCapture(_options.WavFile, HEADLESS_SAMPLE_RATE, true))
+  {
+    return -1;
+  }
+
+  u32_t numFrames = _options.NumFrames;
+  if (numFrames == 0)
+  {
+    numFrames = _options.MovieFile != NULL ? _movie.NumFrames : HEADLESS_FRAMES;
+  }
+
+  CPU_t *cpu = NES_GetCPU();
+  u32_t frame;
+  uint64_t startCounter = SDL_GetPerformanceCounter();
+  for (frame = 0; frame < numFrames && !cpu->IsKilled; frame++)
+  {
+    uint64_t frameCounter = SDL_GetPerformanceCounter();
+    Trace_Begin("emulate");
+    // Without anyone to continue, breaks are logged and emulation goes on
+    while (!RunFrame())
+    {
+      LogBreak();
+      Debugger_Continue();
+    }
+    Trace_End("emulate");
+    if (_metrics != NULL)
+    {
+      Metrics_UpdateFrame(_metrics, SDL_GetPerformanceCounter() - frameCounter);
+    }
+    PPURenderer_Flush();
+    VideoCapture_SubmitFrame(&_videoCapture, _ppuRenderSurface, NES_GetPPU()->FrameCount);
+    if (hashFile != NULL)
+    {
+      FrameHash_t hash;
+      FrameHash_Calculate(_ppuRenderSurface, &hash);
+      FrameHash_Write(hashFile, frame, &hash);
+    }
+  }
+  double seconds = (double) (SDL_GetPerformanceCounter() - startCounter) / SDL_GetPerformanceFrequency();
+
+  PPURenderer_Stop();
+  if (hashFile != NULL && fclose(hashFile) != 0)
+  {
+    LogError("Unable to write %s", _options.HashFile);
+  }
+
+  AudioCapture_Stop(&_audioCapture);
+  VideoCapture_Stop(&_videoCapture);
+  Mapper_Teardown(&_mapper);
+  Movie_Free(&_movie);
+  if (_options.TraceFile != NULL)
+  {
+    Trace_Write(_options.TraceFile);
+  }
+  StopMetrics();
+  LogMessage("Ran %u frames in %.3f s, %.1f frames/s%s", frame, seconds, seconds > 0 ? frame / seconds : 0.0,
+             cpu->IsKilled ? ", CPU was killed" : "");
+  return 0;
+}
+
+static int RunIndexer(void)
+{
+  char indexFile[1024];
+  u32_t numThreads = _options.NumThreads != 0 ? _options.NumThreads : (u32_t) SDL_GetCPUCount();
+
+  snprintf(indexFile, sizeof(indexFile), "%s/%s", _options.LibraryDirectory, LIBRARY_INDEX_FILE_NAME);
+  return RomLibrary_Scan(_options.LibraryDirectory, indexFile, numThreads) ? 0 : -1;
+}
+
+static u32_t _thumbnailFrame;
+
+static bool HandleScriptedButton(u8_t controller, NESButton_t button)
+{
+  if (button != NES_BUTTON_START)
+  {
+    return false;
+  }
+  for (u8_t i = 0; i < _options.NumStartPresses; i++)
+  {
+    // Wraps around for frames before the press
+    if (_thumbnailFrame - _options.StartPresses[i] < START_PRESS_FRAMES)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Boots a ROM, runs it for the requested frames and saves the last one downscaled
+static bool RenderThumbnail(const char *romFile, const char *pngFile)
+{
+  static u8_t pixels[(NES_SCREEN_WIDTH / THUMBNAIL_SCALE) * (NES_SCREEN_HEIGHT / THUMBNAIL_SCALE) * 4];
+  const u16_t width = NES_SCREEN_WIDTH / THUMBNAIL_SCALE;
+  const u16_t height = NES_SCREEN_HEIGHT / THUMBNAIL_SCALE;
+
+  if (!StartSystem(romFile))
+  {
+    LogError("Unable to load NES ROM %s", romFile);
+    return false;
+  }
+  if (_ppuRenderSurface == NULL)
+  {
+    _ppuRenderSurface = SDL_CreateRGBSurfaceWithFormat(0, NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+  }
+  PPU_SetRenderSurface(_ppuRenderSurface);
+  Controllers_SetButtonHandler(0, HandleScriptedButton);
+
+  // Only the last frame is rendered
+  PPU_t *ppu = NES_GetPPU();
+  CPU_t *cpu = NES_GetCPU();
+  u32_t numFrames = _options.NumFrames != 0 ? _options.NumFrames : HEADLESS_FRAMES;
+  for (_thumbnailFrame = 0; _thumbnailFrame < numFrames && !cpu->IsKilled; _thumbnailFrame++)
+  {
+    uint64_t frameCounter = SDL_GetPerformanceCounter();
+    PPU_SetSkipOutput(ppu, _thumbnailFrame + 1 < numFrames);
+    NES_TickUntilFrameComplete();
+    if (_metrics != NULL)
+    {
+      Metrics_UpdateFrame(_metrics, SDL_GetPerformanceCounter() - frameCounter);
+    }
+  }
+  Mapper_Teardown(&_mapper);
+  if (cpu->IsKilled)
+  {
+    LogError("CPU was killed after %u frames of %s", _thumbnailFrame, romFile);
+    return false;
+  }
+
+  // Box filter, every thumbnail pixel is the average of the screen pixels it covers
+  const u8_t *screen = _ppuRenderSurface->pixels;
+  for (u16_t y = 0; y < height; y++)
+  {
+    for (u16_t x = 0; x < width; x++)
+    {
+      u8_t *pixel = &pixels[(y * width + x) * 4];
+      for (u8_t c = 0; c < 3; c++)
+      {
+        u32_t sum = 0;
+        for (u8_t sy = 0; sy < THUMBNAIL_SCALE; sy++)
+        {
+          for (u8_t sx = 0; sx < THUMBNAIL_SCALE; sx++)
+          {
+            sum += screen[(y * THUMBNAIL_SCALE + sy) * _ppuRenderSurface->pitch + (x * THUMBNAIL_SCALE + sx) * 4 + c];
+          }
+        }
+        pixel[c] = (u8_t) (sum / (THUMBNAIL_SCALE * THUMBNAIL_SCALE));
+      }
+      pixel[3] = 0xFF;
+    }
+  }
+  return Png_Write(pngFile, pixels, width, height, (size_t) width * 4);
+}
+
+#ifndef _WIN32
+// Frees the worker slot of the process, the slot picks its metrics instance
+static bool WaitForThumbnailProcess(pid_t *workers, u32_t numWorkers)
+{
+  int status;
+  pid_t pid = wait(&status);
+  for (u32_t i = 0; pid > 0 && i < numWorkers; i++)
   {
-    samples[i] = SDL_sinf(880.0f * 2* 3.14159f * globalTime_s) *(INT32_MAX / 2);
-    globalTime_s += dt;
+    if (workers[i] == pid)
+    {
+      workers[i] = 0;
+    }
   }
-  _globalTime_s = globalTime_s;
+  return pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+#endif
+
+// The emulator core is a single console, so every ROM runs in its own forked
+// process. Without fork the ROMs are run one after the other.
+static int RunThumbnails(void)
+{
+  const char *directory = _options.ThumbnailDirectory;
+  u32_t numWorkers = _options.NumThreads != 0 ? _options.NumThreads : (u32_t) SDL_GetCPUCount();
+  u32_t numWritten = 0;
+  u32_t numFailed = 0;
+  u32_t numRunning = 0;
+  char path[1024];
+  RomLibrary_t library;
+
+  snprintf(path, sizeof(path), "%s/%s", directory, LIBRARY_INDEX_FILE_NAME);
+  if (!RomLibrary_Scan(directory, path, numWorkers) || !RomLibrary_Open(&library, path))
+  {
+    return -1;
+  }
+
+  snprintf(path, sizeof(path), "%s/%s", directory, THUMBNAIL_DIRECTORY_NAME);
+#ifdef _WIN32
+  int result = mkdir(path);
+#else
+  int result = mkdir(path, 0755);
+#endif
+  if (result != 0 && errno != EEXIST)
+  {
+    LogError("Unable to create %s", path);
+    RomLibrary_Close(&library);
+    return -1;
+  }
+
+  // One metrics instance per worker slot, children write to the instance of their slot
+  if (!StartMetrics(numWorkers))
+  {
+    RomLibrary_Close(&library);
+    return -1;
+  }
+#ifndef _WIN32
+  pid_t *workers = calloc(numWorkers, sizeof(pid_t));
+  if (workers == NULL)
+  {
+    LogError("Unable to allocate %u workers", numWorkers);
+    StopMetrics();
+    RomLibrary_Close(&library);
+    return -1;
+  }
+#endif
+
+  // Running a game for a while shouldn't touch its saves, nor stop at a break
+  INesLoader_SetSaveFileEnabled(false);
+  Debugger_Reset();
+
+  for (u32_t i = 0; i < library.Header->NumEntries; i++)
+  {
+    const RomLibraryEntry_t *entry = &library.Entries[i];
+    char romFile[1024];
+    char pngFile[1024];
+    struct stat status;
+
+    if ((entry->Flags & ROM_LIBRARY_FLAG_VALID) == 0)
+    {
+      continue;
+    }
+    // Named after the ROM contents, so an existing thumbnail is up to date
+    int pngLength = snprintf(pngFile, sizeof(pngFile), "%s/%08X.png", path, entry->Crc32);
+    int romLength = snprintf(romFile, sizeof(romFile), "%s/%s", directory, RomLibrary_GetPath(&library, entry));
+    if (pngLength < 0 || (size_t) pngLength >= sizeof(pngFile) ||
+        romLength < 0 || (size_t) romLength >= sizeof(romFile))
+    {
+      LogError("Path of %s or its thumbnail is too long", RomLibrary_GetPath(&library, entry));
+      numFailed++;
+      continue;
+    }
+    if (stat(pngFile, &status) == 0)
+    {
+      continue;
+    }
+
+#ifdef _WIN32
+    if (RenderThumbnail(romFile, pngFile))
+    {
+      numWritten++;
+    }
+    else
+    {
+      numFailed++;
+    }
+#else
+    if (numRunning == numWorkers)
+    {
+      if (WaitForThumbnailProcess(workers, numWorkers))
+      {
+        numWritten++;
+      }
+      else
+      {
+        numFailed++;
+      }
+      numRunning--;
+    }
+
+    // Buffered output would otherwise be written by parent and child
+    u32_t slot = 0;
+    while (workers[slot] != 0)
+    {
+      slot++;
+    }
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+      if (_metrics != NULL)
+      {
+        _metrics = Metrics_GetInstance(slot);
+      }
+      // _exit skips the stdio buffers, the child's log lines would be lost
+      int exitCode = RenderThumbnail(romFile, pngFile) ? 0 : 1;
+      fflush(stdout);
+      fflush(stderr);
+      _exit(exitCode);
+    }
+    if (pid < 0)
+    {
+      LogError("Unable to start a process for %s", romFile);
+      numFailed++;
+      continue;
+    }
+    workers[slot] = pid;
+    numRunning++;
+#endif
+  }
+
+  for (; numRunning > 0; numRunning--)
+  {
+#ifndef _WIN32
+    if (WaitForThumbnailProcess(workers, numWorkers))
+    {
+      numWritten++;
+    }
+    else
+    {
+      numFailed++;
+    }
+#endif
+  }
+
+#ifndef _WIN32
+  free(workers);
+#endif
+  StopMetrics();
+  RomLibrary_Close(&library);
+  LogMessage("Wrote %u thumbnails to %s, %u failed", numWritten, path, numFailed);
+  return numFailed == 0 ? 0 : -1;
+}
+
+// Runs the workload from power on, with or without sampling the profiler
+static bool RunBenchmarkPass(const BenchmarkWorkload_t *workload, u32_t numFrames, bool isProfiled,
+                             BenchmarkPass_t *pass)
+{
+  if (workload->MovieFile != NULL && !Movie_Load(&_movie, workload->MovieFile))
+  {
+    return false;
+  }
+  if (!StartSystem(workload->RomFile))
+  {
+    LogError("Unable to load NES ROM %s", workload->RomFile);
+    Movie_Free(&_movie);
+    return false;
+  }
+  PPU_SetRenderSurface(_ppuRenderSurface);
+  Controllers_SetButtonHandler(0, HandleMovieButton);
+  Controllers_SetButtonHandler(1, HandleMovieButton);
+  APU_SetSampleRate(NES_GetAPU(), HEADLESS_SAMPLE_RATE);
+
+  CPU_t *cpu = NES_GetCPU();
+  PPU_t *ppu = NES_GetPPU();
+  unsigned int startInstructions = cpu->InstructionCount;
+  unsigned int startDots = ppu->CycleCount;
+
+  uint64_t startCounter = SDL_GetPerformanceCounter();
+  if (isProfiled)
+  {
+    Profiler_Start();
+  }
+  for (pass->NumFrames = 0; pass->NumFrames < numFrames && !cpu->IsKilled; pass->NumFrames++)
+  {
+    Movie_AdvanceFrame(&_movie);
+    NES_TickUntilFrameComplete();
+  }
+  if (isProfiled)
+  {
+    Profiler_Stop();
+  }
+  pass->Seconds = (double) (SDL_GetPerformanceCounter() - startCounter) / SDL_GetPerformanceFrequency();
+  pass->NumInstructions = cpu->InstructionCount - startInstructions;
+  pass->NumDots = ppu->CycleCount - startDots;
+  pass->IsKilled = cpu->IsKilled;
+
+  Mapper_Teardown(&_mapper);
+  Movie_Free(&_movie);
+  return true;
+}
+
+static bool RunBenchmarkWorkload(const BenchmarkWorkload_t *workload, u32_t numFrames, FILE *out)
+{
+  BenchmarkPass_t timed;
+  BenchmarkPass_t sampled;
+
+  // Sampling slows down every section a bit, so the speed comes from a run without it
+  if (!RunBenchmarkPass(workload, numFrames, false, &timed) ||
+      !RunBenchmarkPass(workload, numFrames, true, &sampled))
+  {
+    return false;
+  }
+
+  double nsPerInstruction = timed.Seconds * 1e9 / timed.NumInstructions;
+  double nsPerDot = timed.Seconds * 1e9 / timed.NumDots;
+  fprintf(out, "%lld,%s,%u,%.6f,%.2f,%.3f,%.3f", (long long) time(NULL), workload->Name, timed.NumFrames,
+          timed.Seconds, timed.NumFrames / timed.Seconds, nsPerInstruction, nsPerDot);
+  // Shares of the sampled run, the sections don't overlap so they add up to at most 100
+  for (int i = 0; i < NR_OF_PROFILER_SECTIONS; i++)
+  {
+    fprintf(out, ",%.2f", 100.0 * Profiler_GetSeconds(i) / Profiler_GetElapsedSeconds());
+  }
+  fputc('\n', out);
+  LogMessage("%-18s %8.1f frames/s %7.2f ns/instruction %6.2f ns/dot%s", workload->Name,
+             timed.NumFrames / timed.Seconds, nsPerInstruction, nsPerDot, timed.IsKilled ? ", CPU was killed" : "");
+  return true;
+}
+
+// Runs fixed workloads as fast as possible and writes a CSV row per workload,
+// with the time per instruction and dot and the share of every profiler section
+static int RunBenchmark(void)
+{
+  u32_t numFrames = _options.NumFrames != 0 ? _options.NumFrames : BENCHMARK_FRAMES;
+  bool isStdout = strcmp(_options.BenchmarkFile, "-") == 0;
+  FILE *out = isStdout ? stdout : fopen(_options.BenchmarkFile, "a");
+  if (out == NULL)
+  {
+    LogError("Unable to open %s", _options.BenchmarkFile);
+    return -1;
+  }
+  // Measures the emulator as shipped, breaks would stop the frames halfway
+  Debugger_Reset();
+  if (isStdout)
+  {
+    // Only the CSV goes to stdout
+    LogSetStream(stderr);
+  }
+
+  // A new file starts with the column names
+  if (isStdout || ftell(out) == 0)
+  {
+    fprintf(out, "time,workload,frames,seconds,frames_per_second,ns_per_instruction,ns_per_dot");
+    for (int i = 0; i < NR_OF_PROFILER_SECTIONS; i++)
+    {
+      fprintf(out, ",%s_percent", Profiler_GetName(i));
+    }
+    fputc('\n', out);
+  }
+
+  // Rendered like the window does, but nothing is saved
+  INesLoader_SetSaveFileEnabled(false);
+  _ppuRenderSurface = SDL_CreateRGBSurfaceWithFormat(0, NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+
+  u32_t numFailed = 0;
+  if (_options.RomFile != NULL)
+  {
+    const char *name = strrchr(_options.RomFile, '/');
+    BenchmarkWorkload_t workload = { name != NULL ? name + 1 : _options.RomFile, _options.RomFile, _options.MovieFile };
+    numFailed += !RunBenchmarkWorkload(&workload, numFrames, out);
+  }
+  else
+  {
+    for (size_t i = 0; i < sizeof(BENCHMARK_WORKLOADS) / sizeof(BENCHMARK_WORKLOADS[0]); i++)
+    {
+      numFailed += !RunBenchmarkWorkload(&BENCHMARK_WORKLOADS[i], numFrames, out);
+    }
+  }
+
+  if (!isStdout && fclose(out) != 0)
+  {
+    LogError("Unable to write %s", _options.BenchmarkFile);
+    return -1;
+  }
+  return numFailed == 0 ? 0 : -1;
 }
 
 static void Initialize()
@@ -224,39 +1213,52 @@ static void Initialize()
   //const char *romFile = "Resources/cpu_timing_test6/cpu_timing_test.nes";
   //const char *romFile = "Resources/cpu_interrupts_v2/rom_singles/2-nmi_and_brk.nes";
   //const char *romFile = "Resources/ntsc_torture.nes";
-  const char *paletteFile = "Resources/ntscpalette.pal";
-  Bus_t *bus;
-  CPU_t *cpu;
-  NES_Initialize();
-  if (INesLoader_Load(romFile, &_mapper))
+  if (_options.RomFile != NULL)
   {
-    strncpy(_lastLoadedFileName, romFile, sizeof(_lastLoadedFileName));
-    bus = NES_GetBus();
-    Bus_SetMapper(bus, &_mapper);
+    romFile = _options.RomFile;
   }
-  else
+  if (!StartMovie() || !StartSystem(romFile) || !StartMetrics(1))
   {
     LogError("Unable to load NES ROM, do not run system!");
     exit(-1);
   }
 
-  Palette_LoadFrom(paletteFile);
-
   _ppuRenderSurface = SDL_CreateRGBSurfaceWithFormat(0, NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
   PPU_SetRenderSurface(_ppuRenderSurface);
 
-  _ppuPatternTableSurfaces[0] = SDL_CreateRGBSurfaceWithFormat(0, 16 * 8, 16 * 8, 32, SDL_PIXELFORMAT_RGBA32);
-  _ppuPatternTableSurfaces[1] = SDL_CreateRGBSurfaceWithFormat(0, 16 * 8, 16 * 8, 32, SDL_PIXELFORMAT_RGBA32);
+  for (int i = 0; i < 3; i++)
+  {
+    _frameViews[i].Screen = SDL_CreateRGBSurfaceWithFormat(0, NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+    _frameViews[i].PatternTable = SDL_CreateRGBSurfaceWithFormat(0, 16 * 8, 16 * 8, 32, SDL_PIXELFORMAT_RGBA32);
+    _frameViews[i].PatternTableIndex = 2;
+  }
+  TripleBuffer_Initialize(&_frameViewBuffer);
 
-  // Hook up controllers to SDL
-  Controllers_SetButtonHandler(0, HandleButton);
+  // Hook up controllers to SDL, or to the movie when playing back or recording
+  if (_options.MovieFile != NULL || _options.RecordFile != NULL)
+  {
+    Controllers_SetButtonHandler(0, HandleMovieButton);
+    Controllers_SetButtonHandler(1, HandleMovieButton);
+  }
+  else
+  {
+    Controllers_SetButtonHandler(0, HandleButton);
+  }
 
-  // Run first instruction
-  cpu = NES_GetCPU();
-  CPU_Reset(cpu);
-  //cpu->PC = 0xC000; // nestest.nes auto mode
-  NES_TickClock();
-  NES_TickUntilCPUComplete();
+  // Synthesized audio goes to the audio callback
+  _audioSampleRate = SharedSDL_GetAudioSampleRate();
+  _audioTargetFill = _audioSampleRate * AUDIO_LATENCY_MS / 1000;
+  AudioRing_Initialize(&_audioRing, AUDIO_RING_SAMPLES);
+  APU_SetSampleRate(NES_GetAPU(), _audioSampleRate);
+  APU_SetSampleHandler(NES_GetAPU(), HandleApuSamples);
+  if (_options.WavFile != NULL)
+  {
+    StartAudioCapture(_options.WavFile, _audioSampleRate, false);
+  }
+  if (_options.VideoTarget != NULL)
+  {
+    StartVideoCapture(_options.VideoTarget, false);
+  }
 
   Text_LoadFont(&_font, "Resources/monofont.bmp", FONT_SIZE, FONT_SIZE);
 }
@@ -299,6 +1301,10 @@ static void Event(SDL_Event* event)
     {
       _controller1Buttons[NES_BUTTON_RIGHT] = keyDown;
     }
+    else if (event->key.keysym.sym == SDLK_TAB)
+    {
+      _fastForward = keyDown;
+    }
   }
 
   if (event->type == SDL_KEYDOWN)
@@ -323,6 +1329,26 @@ static void Event(SDL_Event* event)
     {
       _screenshotWasPressed = true;
     }
+    else if (event->key.keysym.sym == SDLK_d)
+    {
+      _deferKeyWasPressed = true;
+    }
+    else if (event->key.keysym.sym == SDLK_w)
+    {
+      _captureKeyWasPressed = true;
+    }
+    else if (event->key.keysym.sym == SDLK_v)
+    {
+      _videoKeyWasPressed = true;
+    }
+    else if (event->key.keysym.sym == SDLK_t)
+    {
+      _traceKeyWasPressed = true;
+    }
+    else if (event->key.keysym.sym == SDLK_b)
+    {
+      _breakpointKeyWasPressed = true;
+    }
     else if (event->key.keysym.sym == SDLK_p)
     {
       _patternTableDrawIndex++;
@@ -379,21 +1405,6 @@ static void FormatInstruction(CPU_t *cpu, char* textBuffer)
   //LogMessage(textBuffer);
 }
 
-static bool WriteSurfaceToFile(SDL_Surface *surface, const char *path)
-{
-  FILE* file = fopen(path, "wb");
-  if (NULL == file)
-  {
-    return false;
-  }
-
-  fwrite(surface->pixels, surface->format->BytesPerPixel, surface->h * surface->w, file);
-
-  fclose(file);
-
-  return true;
-}
-
 static bool Update(float deltaTime)
 {
   CPU_t *cpu;
@@ -406,17 +1417,28 @@ static bool Update(float deltaTime)
   ppu = NES_GetPPU();
   apu = bus->APU;
 
+  FrameView_t *view = &_frameViews[TripleBuffer_GetBackIndex(&_frameViewBuffer)];
+
   instr = InstructionTable_GetInstruction(cpu->Instruction);
 
-  // First row: Meta info
+  // First row: Meta info, or why the debugger stopped
   const char* firstRowTemplate = "Map: %02X File: %-*s";
-  snprintf(_statusBarBuffer,
-           STATUS_BAR_CHARS_PER_ROW + 1,
-           firstRowTemplate,
-           _mapper.MapperId,
-           STATUS_BAR_CHARS_PER_ROW,
-           _lastLoadedFileName
-           );
+  if (_isDebuggerBreak)
+  {
+    char breakText[STATUS_BAR_CHARS_PER_ROW + 1];
+    Debugger_FormatBreak(breakText, sizeof(breakText));
+    snprintf(view->StatusBar, STATUS_BAR_CHARS_PER_ROW + 1, "%-*s", STATUS_BAR_CHARS_PER_ROW, breakText);
+  }
+  else
+  {
+    snprintf(view->StatusBar,
+             STATUS_BAR_CHARS_PER_ROW + 1,
+             firstRowTemplate,
+             _mapper.MapperId,
+             STATUS_BAR_CHARS_PER_ROW,
+             _lastLoadedFileName
+             );
+  }
 
   if (_statusKeyWasPressed)
   {
@@ -429,7 +1451,7 @@ static bool Update(float deltaTime)
   {
   case DETAIL_MODE_CPU:
   {
-    snprintf(&_statusBarBuffer[STATUS_BAR_CHARS_PER_ROW],
+    snprintf(&view->StatusBar[STATUS_BAR_CHARS_PER_ROW],
             STATUS_BAR_CHARS_PER_ROW + 1,
             "%04X: %3s %3s A:%02X X:%02X Y:%02X S:%02X P:%02X, C:%010d",
             cpu->InstructionPC,
@@ -447,7 +1469,7 @@ static bool Update(float deltaTime)
   case DETAIL_MODE_PPU:
   {
     // Second row: PPU status
-    snprintf(&_statusBarBuffer[STATUS_BAR_CHARS_PER_ROW],
+    snprintf(&view->StatusBar[STATUS_BAR_CHARS_PER_ROW],
             STATUS_BAR_CHARS_PER_ROW + 1,
             "H:%03d V:%03d CTRL:%02X STAT:%02X MASK:%02X FRAME:%d",
             ppu->HCount,
@@ -462,12 +1484,15 @@ static bool Update(float deltaTime)
   case DETAIL_MODE_APU:
   {
     // Second row: APU status
-    snprintf(&_statusBarBuffer[STATUS_BAR_CHARS_PER_ROW],
+    snprintf(&view->StatusBar[STATUS_BAR_CHARS_PER_ROW],
             STATUS_BAR_CHARS_PER_ROW + 1,
-            "CNT:%08u S:%02X F:%02X",
-            apu->HalfClockCounter,
-            apu->Status.currentValue,
-            apu->FrameCounter.currentValue
+            "SEQ:%8d S:%02X F:%02X AUD:%4u U:%u O:%u",
+            (int) apu->FrameSequenceCycle,
+            apu->Status,
+            apu->FrameCounter,
+            AudioRing_GetFill(&_audioRing),
+            AudioRing_GetUnderruns(&_audioRing),
+            AudioRing_GetOverruns(&_audioRing)
             );
     break;
   }
@@ -483,7 +1508,7 @@ static bool Update(float deltaTime)
     u8_t memData = Bus_ReadFromCPU(bus, memAddress);
     if (i == HALF_MEM_WINDOW_SIZE)
     {
-      sprintf(_memTextBuffer[i],
+      sprintf(view->MemText[i],
               "%04X: %02X <",
               memAddress,
               memData
@@ -491,7 +1516,7 @@ static bool Update(float deltaTime)
     }
     else
     {
-      sprintf(_memTextBuffer[i],
+      sprintf(view->MemText[i],
               "%04X: %02X",
               memAddress,
               memData
@@ -502,19 +1527,19 @@ static bool Update(float deltaTime)
   }
 
   memAddress = 0x6000;
-  memset(_memoryViewBuffer, 0, sizeof(_memoryViewBuffer));
+  memset(view->MemoryView, 0, sizeof(view->MemoryView));
   for (int i = 0; i < MEMORY_VIEW_ROWS; i++)
   {
-    snprintf(_memoryViewBuffer + strlen(_memoryViewBuffer),
-             sizeof(_memoryViewBuffer) - strlen(_memoryViewBuffer),
+    snprintf(view->MemoryView + strlen(view->MemoryView),
+             sizeof(view->MemoryView) - strlen(view->MemoryView),
              "%04X:",
              memAddress
              );
     for (int j = 0; j < MEMORY_VIEW_COLUMNS; j++)
     {
       u8_t memData = Bus_ReadFromCPU(bus, memAddress);
-      snprintf(_memoryViewBuffer + strlen(_memoryViewBuffer),
-               sizeof(_memoryViewBuffer) - strlen(_memoryViewBuffer),
+      snprintf(view->MemoryView + strlen(view->MemoryView),
+               sizeof(view->MemoryView) - strlen(view->MemoryView),
                " %02X",
                memData
                );
@@ -522,15 +1547,15 @@ static bool Update(float deltaTime)
     }
   }
 
-  memset(_oamViewBuffer, 0, sizeof(_oamViewBuffer));
+  memset(view->OamView, 0, sizeof(view->OamView));
   for (int i = 0; i < OAM_VIEW_ENTRIES; i++)
   {
     OAMEntry_t *entry;
 
     entry = &(ppu->OAM[i]);
 
-    snprintf(_oamViewBuffer + strlen(_oamViewBuffer),
-             sizeof(_oamViewBuffer) - strlen(_oamViewBuffer),
+    snprintf(view->OamView + strlen(view->OamView),
+             sizeof(view->OamView) - strlen(view->OamView),
              "%02d: %3d %3d T:0x%02X A:0x%02X",
              i,
              entry->X,
@@ -540,6 +1565,64 @@ static bool Update(float deltaTime)
              );
   }
 
+  if (_deferKeyWasPressed)
+  {
+    // Compose pixels on the renderer thread from the next frame onwards
+    PPU_SetDeferredRendering(ppu, !ppu->DeferRendering);
+    LogMessage("Deferred rendering %s", ppu->DeferRendering ? "enabled" : "disabled");
+    _deferKeyWasPressed = false;
+  }
+
+  if (_captureKeyWasPressed)
+  {
+    // Samples are produced on this thread, so start and stop are safe here
+    if (_audioCapture.IsActive)
+    {
+      AudioCapture_Stop(&_audioCapture);
+    }
+    else
+    {
+      StartAudioCapture(CAPTURE_FILE_NAME, _audioSampleRate, false);
+    }
+    _captureKeyWasPressed = false;
+  }
+
+  if (_videoKeyWasPressed)
+  {
+    if (_videoCapture.IsActive)
+    {
+      VideoCapture_Stop(&_videoCapture);
+    }
+    else
+    {
+      StartVideoCapture(VIDEO_CAPTURE_FILE_NAME, false);
+    }
+    _videoKeyWasPressed = false;
+  }
+
+  if (_traceKeyWasPressed)
+  {
+    // The first press starts tracing, later ones write what the rings hold
+    if (_isTracing)
+    {
+      Trace_Write(TRACE_FILE_NAME);
+    }
+    else
+    {
+      Trace_Start();
+      LogMessage("Tracing, press T again to write %s", TRACE_FILE_NAME);
+    }
+    _traceKeyWasPressed = false;
+  }
+
+  if (_breakpointKeyWasPressed)
+  {
+    bool isSet = !Debugger_IsBreakpoint(cpu->PC);
+    Debugger_SetBreakpoint(cpu->PC, isSet);
+    LogMessage("Breakpoint at $%04X %s", cpu->PC, isSet ? "set" : "cleared");
+    _breakpointKeyWasPressed = false;
+  }
+
   if (_runKeyWasPressed)
   {
     _run = !_run;
@@ -547,6 +1630,7 @@ static bool Update(float deltaTime)
 
     if (_run)
     {
+      Debugger_Continue();
       SharedSDL_StartAudio();
     }
     else
@@ -557,6 +1641,7 @@ static bool Update(float deltaTime)
 
   if (_stepKeyWasPressed)
   {
+    Debugger_Continue();
     if (cpu->CyclesLeftForInstruction == 0)
     {
       NES_TickClock();
@@ -567,45 +1652,74 @@ static bool Update(float deltaTime)
 
   if (_frameStepKeyWasPressed)
   {
-    NES_TickUntilFrameComplete();
+    Debugger_Continue();
+    RunFrame();
     _frameStepKeyWasPressed = false;
   }
 
-  SharedSDL_BeginTiming(PERF_INDEX_EMULATE);
+  Trace_Begin("emulate");
   if (_run)
   {
-    // Realtime-ish speed
-    NES_TickUntilFrameComplete();
+    // Realtime-ish speed, when fast forwarding only the last frame is rendered
+    u8_t numFrames = _fastForward ? FAST_FORWARD_FRAMES : 1;
+    for (u8_t i = 0; i < numFrames && !cpu->IsKilled && !_isDebuggerBreak; i++)
+    {
+      uint64_t frameCounter = SDL_GetPerformanceCounter();
+      PPU_SetSkipOutput(ppu, i + 1 < numFrames);
+      if (RunFrame() && _metrics != NULL)
+      {
+        Metrics_UpdateFrame(_metrics, SDL_GetPerformanceCounter() - frameCounter);
+      }
+    }
     if (cpu->IsKilled)
     {
       _run = false;
     }
+    if (_isDebuggerBreak)
+    {
+      LogBreak();
+      _run = false;
+      SharedSDL_StopAudio();
+    }
+  }
+  Trace_End("emulate");
+  if (_metrics != NULL)
+  {
+    Metrics_SetAudioUnderruns(_metrics, AudioRing_GetUnderruns(&_audioRing));
   }
-  SharedSDL_EndTiming(PERF_INDEX_EMULATE);
+
+  // When stepping the renderer can still be busy with the last lines
+  PPURenderer_Flush();
+
+  // Only takes frames that weren't captured yet, skipped frames are repeated by the writer
+  VideoCapture_SubmitFrame(&_videoCapture, _ppuRenderSurface, ppu->FrameCount);
 
   FormatInstruction(cpu, _textBuffer);
 
   // Draw pattern tables AFTER rendering
   if (_patternTableDrawIndex < 2)
   {
-    DrawPatternTable(bus, _patternTableDrawIndex * 0x1000, _ppuPatternTableSurfaces[_patternTableDrawIndex]);
+    DrawPatternTable(bus, _patternTableDrawIndex * 0x1000, view->PatternTable);
   }
 
-  // Write screenshot to file after rendering
+  // Take screenshot after rendering, it is encoded and written in the background
   if (_screenshotWasPressed)
   {
-    const char* fileName = "screenshot.raw";
-    if (WriteSurfaceToFile(_ppuRenderSurface, fileName))
-    {
-      LogMessage("Saved screenshot to %s", fileName);
-    }
-    else
-    {
-      LogError("Failed to save screenshot to %s", fileName);
-    }
+    Screenshot_Save(_ppuRenderSurface, ppu->FrameCount);
     _screenshotWasPressed = false;
   }
 
+  // Hand everything over to Draw
+  SDL_memcpy(view->Screen->pixels, _ppuRenderSurface->pixels, _ppuRenderSurface->h * _ppuRenderSurface->pitch);
+  for (u8_t i = 0; i < sizeof(view->Palette); i++)
+  {
+    view->Palette[i] = Bus_ReadFromPPU(bus, 0x3F00 + i);
+  }
+  view->PatternTableIndex = _patternTableDrawIndex;
+  view->DetailMode = _detailMode;
+  view->IsRunning = _run;
+  TripleBuffer_Publish(&_frameViewBuffer);
+
   return true;
 }
 
@@ -616,10 +1730,12 @@ static void Draw(SDL_Surface* surface)
 {
   SDL_Rect nesInternalRect;
   SDL_Rect nesScreenRect;
+  char fpsBuffer[16];
+  FrameView_t *view = &_frameViews[TripleBuffer_GetFrontIndex(&_frameViewBuffer, NULL)];
 
   // Nes screen output
-  nesInternalRect.w = _ppuRenderSurface->w;
-  nesInternalRect.h = _ppuRenderSurface->h;
+  nesInternalRect.w = view->Screen->w;
+  nesInternalRect.h = view->Screen->h;
   nesInternalRect.x = 0;
   nesInternalRect.y = 0;
   nesScreenRect.w = NES_SCREEN_WIDTH * NES_SCREEN_SCALE;
@@ -628,18 +1744,18 @@ static void Draw(SDL_Surface* surface)
   nesScreenRect.y = STATUS_BAR_HEIGHT;
   //color = SDL_MapRGB(surface->format, 0xFF, 0x00, 0x00);
   //SDL_FillRect(surface, &nesScreenRect, color);
-  SDL_BlitScaled(_ppuRenderSurface, &nesInternalRect, surface, &nesScreenRect);
+  SDL_BlitScaled(view->Screen, &nesInternalRect, surface, &nesScreenRect);
 
   // Status bar
-  Text_DrawStringWrapping(surface, _statusBarBuffer, 0, 0, STATUS_BAR_CHARS_PER_ROW, &_font);
+  Text_DrawStringWrapping(surface, view->StatusBar, 0, 0, STATUS_BAR_CHARS_PER_ROW, &_font);
 
   // Debug view
-  if ((_detailMode == DETAIL_MODE_CPU) || (_detailMode == DETAIL_MODE_APU))
+  if ((view->DetailMode == DETAIL_MODE_CPU) || (view->DetailMode == DETAIL_MODE_APU))
   {
     // Memory view
     Text_DrawString(surface, "Memory view", nesScreenRect.w, STATUS_BAR_HEIGHT, &_font);
     Text_DrawStringWrapping(surface,
-                             _memoryViewBuffer,
+                             view->MemoryView,
                              nesScreenRect.w,
                              STATUS_BAR_HEIGHT + _font.GlyphHeight,
                              MEMORY_VIEW_CHARS_PER_ROW,
@@ -649,7 +1765,7 @@ static void Draw(SDL_Surface* surface)
     for (int i = 0; i < HALF_MEM_WINDOW_SIZE * 2 + 1; i++)
     {
       Text_DrawString(surface,
-                      _memTextBuffer[i],
+                      view->MemText[i],
                       nesScreenRect.w,
                       STATUS_BAR_HEIGHT + _font.GlyphHeight * (i + 3 + MEMORY_VIEW_ROWS),
                       &_font);
@@ -660,7 +1776,7 @@ static void Draw(SDL_Surface* surface)
     // OAM view
     Text_DrawString(surface, "OAM view", nesScreenRect.w, STATUS_BAR_HEIGHT, &_font);
     Text_DrawStringWrapping(surface,
-                            _oamViewBuffer,
+                            view->OamView,
                             nesScreenRect.w,
                             STATUS_BAR_HEIGHT + _font.GlyphHeight,
                             OAM_VIEW_CHARS_PER_ROW,
@@ -668,7 +1784,7 @@ static void Draw(SDL_Surface* surface)
   }
 
   // Pattern table output
-  if (_patternTableDrawIndex < 2)
+  if (view->PatternTableIndex < 2)
   {
     SDL_Rect srcRect =
     {
@@ -685,16 +1801,16 @@ static void Draw(SDL_Surface* surface)
         y: STATUS_BAR_HEIGHT
     };
 
-    SDL_BlitScaled(_ppuPatternTableSurfaces[_patternTableDrawIndex], &srcRect,
+    SDL_BlitScaled(view->PatternTable, &srcRect,
                     surface, &dstRect);
   }
 
   // Palette output
-  DrawPalettes(NES_GetBus(), surface, nesScreenRect.w, FONT_SIZE * 29 + 3);
+  DrawPalettes(view->Palette, surface, nesScreenRect.w, FONT_SIZE * 29 + 3);
 
   // Debug: state
-  Text_DrawString(surface, _run ? "Run" : "Stop", 0, surface->h - _font.GlyphHeight, &_font);
-  Text_DrawString(surface, "- P: Pattern, Space: Step, F: 1 Frame, R: Run, S: Status", 5 * _font.GlyphWidth, surface->h - _font.GlyphHeight, &_font);
+  Text_DrawString(surface, view->IsRunning ? "Run" : "Stop", 0, surface->h - _font.GlyphHeight, &_font);
+  Text_DrawString(surface, "P:Pattern Spc:Step F:Frame R:Run Tab:Fast D:Defer S:Status", 5 * _font.GlyphWidth, surface->h - _font.GlyphHeight, &_font);
 
   // Debug: FPS
   if (0 == performanceCounterFrequency)
@@ -704,8 +1820,9 @@ static void Draw(SDL_Surface* surface)
 
   uint64_t perfCounter = SDL_GetPerformanceCounter();
   u32_t fps = performanceCounterFrequency / (perfCounter - prevPerformanceCounter);
-  snprintf(_statusBarBuffer, sizeof(_statusBarBuffer), "FPS: %u", fps);
-  Text_DrawString(surface, _statusBarBuffer, 0, surface->h - 2 * _font.GlyphHeight, &_font);
+  snprintf(fpsBuffer, sizeof(fpsBuffer), "FPS: %u", fps);
+  Text_DrawString(surface, fpsBuffer, 0, surface->h - 2 * _font.GlyphHeight, &_font);
+  Text_DrawString(surface, "F12:Shot W:Wav V:Video T:Trace", 12 * _font.GlyphWidth, surface->h - 2 * _font.GlyphHeight, &_font);
   prevPerformanceCounter = perfCounter;
 }
 